@@ -0,0 +1,80 @@
+// benchDateTable.cpp: times FinDate::jdn2mdy with and without the date
+// table against the algorithm that FinDate used before (see
+// benchDateTable.R for how to build and run this).
+
+#include <ctime>
+
+#include <cxxPack.hpp>
+
+// The jdn2mdy() algorithm used before the table was added.
+static cxxPack::DateMDY legacyJdn2mdy(int jdn) {
+    int jul = jdn + 32044;
+    int g = jul/146097;
+    int dg = jul % 146097;
+    int c = (dg/36524 + 1)*3/4;
+    int dc = dg - c*36524;
+    int b = dc/1461;
+    int db = dc % 1461;
+    int a = (db/365 + 1)*3/4;
+    int da = db - a*365;
+    int y = g*400 + c*100 + b*4 + a;
+    int m = (da*5 + 308)/153 - 2;
+    int d = da - (m + 4)*153 /5 + 122;
+    y = y - 4800 + (m + 2)/12;
+    m = (m + 2) % 12 + 1;
+    d = d + 1;
+    return cxxPack::DateMDY(m,d,y);
+}
+
+typedef cxxPack::DateMDY (*Decompose)(int);
+
+// Returns nanoseconds per call. The checksum keeps the compiler from
+// discarding the work.
+static double timeIt(Decompose f, const std::vector<int>& jdns, int reps,
+		     long& checksum) {
+    std::clock_t start = std::clock();
+    for(int r = 0; r < reps; ++r)
+	for(int i = 0; i < (int)jdns.size(); ++i) {
+	    cxxPack::DateMDY mdy = f(jdns[i]);
+	    checksum += mdy.month + mdy.day + mdy.year;
+	}
+    double secs = (double)(std::clock() - start)/CLOCKS_PER_SEC;
+    return 1.0e9*secs/((double)reps*jdns.size());
+}
+
+/**
+ * Decomposes n pseudo-random dates in 1950-2100 reps times with each
+ * method and returns the time per call in nanoseconds (legacy algorithm,
+ * arithmetic fallback, table lookup).
+ */
+RcppExport SEXP benchDateTable(SEXP n_, SEXP reps_) {
+    BEGIN_RCPP
+    int n = Rcpp::as<int>(n_);
+    int reps = Rcpp::as<int>(reps_);
+
+    int first = cxxPack::FinDate::mdy2jdn(1, 1, 1950);
+    int span = cxxPack::FinDate::mdy2jdn(12, 31, 2100) - first + 1;
+    std::vector<int> jdns(n);
+    unsigned int seed = 12345;
+    for(int i = 0; i < n; ++i) {
+	seed = seed*1103515245 + 12345;
+	jdns[i] = first + (int)((seed >> 8) % span);
+    }
+
+    long check1 = 0, check2 = 0, check3 = 0;
+    double legacy = timeIt(legacyJdn2mdy, jdns, reps, check1);
+    cxxPack::FinDate::useDateTable(false);
+    double arith = timeIt(cxxPack::FinDate::jdn2mdy, jdns, reps, check2);
+    cxxPack::FinDate::useDateTable(true);
+    double table = timeIt(cxxPack::FinDate::jdn2mdy, jdns, reps, check3);
+    cxxPack::FinDate::useDateTable(false);
+    if(check1 != check2 || check1 != check3)
+	throw std::range_error("benchDateTable: methods disagree");
+
+    Rcpp::NumericVector nsPerCall(3);
+    nsPerCall[0] = legacy;
+    nsPerCall[1] = arith;
+    nsPerCall[2] = table;
+    return nsPerCall;
+    END_RCPP
+}
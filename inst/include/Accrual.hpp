@@ -0,0 +1,118 @@
+// Accrual.hpp: accrued interest over portfolios of coupon schedules
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ACCRUAL_HPP
+#define ACCRUAL_HPP
+
+#include <vector>
+
+#include <FinEnum.hpp>
+#include <FinDate.hpp>
+#include <Calendar.hpp>
+#include <Schedule.hpp>
+
+namespace cxxPack {
+
+/**
+ * Accrued interest for a portfolio of fixed coupon instruments. Each
+ * instrument is an increasing list of accrual dates (julian day numbers,
+ * usually the adjusted dates of a Schedule) with an annual coupon rate,
+ * a coupon frequency, a day count convention and an accrual convention.
+ * For a valuation date v the current period k is the one with
+ * dates[k] <= v < dates[k+1] (found by binary search), and the accrued
+ * interest per unit of notional is
+ *
+ * - Standard:          coupon/frequency * frac[k] * days(dates[k], v)
+ *                                        / days(dates[k], dates[k+1])
+ * - YearFraction:      coupon * yearFrac(dates[k], v)
+ * - YearFractionPlus1: coupon * yearFrac(dates[k], v, 1), counting both
+ *                      ends of the accrual period (some Italian bonds)
+ *
+ * where frac[k] is 1 except for the odd first or last period of a
+ * Schedule, where it is the fraction of a regular coupon the period pays
+ * (see Schedule::couponFractions()), and days() and yearFrac() are FinDate::diffDays() and
+ * FinDate::yearFrac() for the instrument's day count convention (BUS/252
+ * uses the instrument's calendar). A valuation date before the first
+ * date or on or after the last date is not in any period: its period is
+ * -1 and its accrued interest is 0.
+ *
+ * The schedules of all instruments are kept in one array, and the
+ * results are written to arrays provided by the caller, instrument by
+ * instrument. When the package is compiled with OpenMP the instruments
+ * are processed in parallel. Calendars must outlive the engine.
+ */
+class AccrualEngine {
+
+    std::vector<int> dates;   // accrual dates of all instruments
+    std::vector<int> offsets; // instrument i uses dates[offsets[i],offsets[i+1])
+    std::vector<double> periodFrac; // coupon fraction of the period at each date
+    std::vector<double> coupon;
+    std::vector<int> frequency;
+    std::vector<FinEnum::DayCountConvention> dc;
+    std::vector<FinEnum::AccrualConvention> conv;
+    std::vector<const Calendar*> cal;
+
+    void accrueRange(int i, const int* valDates, int nVal,
+		     double* accrued, int* period) const;
+
+public:
+
+    AccrualEngine() : offsets(1, 0) {}
+
+    /**
+     * Add an instrument with the n accrual dates in dates (n >= 2,
+     * strictly increasing). Returns the index of the instrument.
+     */
+    int add(const int* dates, int n, double coupon, int frequency,
+	    FinEnum::DayCountConvention dc,
+	    FinEnum::AccrualConvention conv = FinEnum::Standard,
+	    const Calendar& cal = Calendar::get("WeekendsOnly"));
+
+    /**
+     * Add an instrument that accrues over the adjusted dates of schedule,
+     * using its frequency, day count convention and calendar, with its
+     * odd periods prorated as in BondEngine.
+     */
+    int add(const Schedule& schedule, double coupon,
+	    FinEnum::AccrualConvention conv = FinEnum::Standard);
+
+    int numInstruments() const { return coupon.size(); }
+    int numDates(int i) const { return offsets[i+1] - offsets[i]; }
+    const int* getDates(int i) const { return &dates[offsets[i]]; }
+
+    /**
+     * Accrued interest of every instrument at each of the nVal valuation
+     * dates: accrued[i*nVal + j] for instrument i and valDates[j], with
+     * the index of the accrual period in period[i*nVal + j] (period may
+     * be null).
+     */
+    void accrue(const int* valDates, int nVal, double* accrued,
+		int* period = 0) const;
+
+    /**
+     * Accrued interest of instrument i at valDates[i] (one valuation or
+     * settlement date per instrument, numInstruments() of them).
+     */
+    void accrueEach(const int* valDates, double* accrued,
+		    int* period = 0) const;
+
+    std::vector<double> accrue(const std::vector<int>& valDates) const;
+    std::vector<double> accrueEach(const std::vector<int>& valDates) const;
+};
+
+} // end cxxPack namespace
+
+#endif
@@ -19,6 +19,7 @@
 
 #include <Rcpp.h>
 #include <FinDate.hpp>
+#include <FinDatetime.hpp>
 
 namespace cxxPack {
 
@@ -82,6 +83,22 @@ private:
     std::vector<RcppDatetime> vec;
 };
 
+// Same as CDatetimeVector but with nanosecond resolution (and exact
+// comparisons) on the C++ side.
+class CFinDatetimeVector {
+public:
+    CFinDatetimeVector(Rcpp::NumericVector nv);
+    inline int size() { return vec.size(); }
+    inline FinDatetime& operator()(int i) { 
+	if(i < 0 || i >= (int)vec.size())
+	    throw std::range_error("CFinDatetimeVector: index out of range");
+	return vec[i]; 
+    }
+    operator SEXP();
+private:
+    std::vector<FinDatetime> vec;
+};
+
 } // end namespace cxxPack
 
 namespace Rcpp {
@@ -92,6 +109,7 @@ template<> SEXP wrap<cxxPack::CNumericVector>(const cxxPack::CNumericVector&);
 template<> SEXP wrap<cxxPack::CNumericMatrix>(const cxxPack::CNumericMatrix&);
 template<> SEXP wrap<cxxPack::CDateVector>(const cxxPack::CDateVector&);
 template<> SEXP wrap<cxxPack::CDatetimeVector>(const cxxPack::CDatetimeVector&);
+template<> SEXP wrap<cxxPack::CFinDatetimeVector>(const cxxPack::CFinDatetimeVector&);
 
 } // end namespace Rcpp
 
@@ -0,0 +1,158 @@
+// Bond.hpp: fixed coupon bond price, yield and risk over portfolios
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BOND_HPP
+#define BOND_HPP
+
+#include <vector>
+
+#include <FinEnum.hpp>
+#include <FinDate.hpp>
+#include <Calendar.hpp>
+#include <Schedule.hpp>
+
+namespace cxxPack {
+
+/**
+ * Results of BondEngine::compute(), one entry per bond. Prices are per
+ * the bond's redemption amount (usually 100), yields are annual rates
+ * (0.05 is 5%), duration is the modified duration -P'/P and convexity
+ * is P''/P, with P the dirty price as a function of the yield. Entries
+ * for bonds that could not be computed (settlement outside of the
+ * schedule, or a price that no yield reproduces) are NaN.
+ */
+struct BondAnalytics {
+    std::vector<double> cleanPrice, dirtyPrice, accrued, yield;
+    std::vector<double> duration, convexity;
+};
+
+/**
+ * Price from yield and yield from price, with duration and convexity,
+ * for a portfolio of fixed coupon bonds.
+ *
+ * Each bond pays coupon/frequency times the redemption amount at the end
+ * of each regular period of its schedule, and the redemption amount at
+ * maturity. A short first or last period pays the fraction of a regular
+ * coupon given by the day count of the period divided by that of the
+ * regular period it is part of (from the unadjusted dates). Accrued
+ * interest follows the bond's AccrualConvention (see AccrualEngine).
+ *
+ * With settlement in period k, w is the day count from settlement to the
+ * next coupon divided by that of the period (times the fraction for a
+ * short period), and the j-th remaining cash flow is t = w + j periods
+ * away (less for a short last period). The dirty price discounts each
+ * cash flow at the yield y with the bond's yield convention:
+ *
+ * - NoFeature (street/ISMA): (1 + y/f)^-t.
+ * - Moosmuller: (1 + w*y/f)^-1 (1 + y/f)^-(t-w), simple interest up to
+ *   the next coupon.
+ * - BraessFangmeyer: (1 + y)^-n (1 + r*y)^-1 where t/f = n + r with n
+ *   whole years, annual compounding with simple interest within a year.
+ *
+ * In FixedYield mode compute() takes yields and returns prices; in
+ * FixedPrice mode it takes clean prices and solves for the yield by
+ * Halley's method (the second derivative is computed with the first),
+ * safeguarded by bisection (the price is decreasing in the yield), to
+ * about 1e-12. This runs in the calling thread, without
+ * calls to R, so when the package is compiled with OpenMP the bonds are
+ * spread over the OpenMP threads. Calendars must outlive the engine.
+ */
+class BondEngine {
+
+    // Per bond, with its periods in [offsets[i], offsets[i+1]-1) of the
+    // period arrays and its dates in [offsets[i], offsets[i+1]).
+    std::vector<int> offsets;
+    std::vector<int> dates;         // adjusted accrual dates
+    std::vector<double> couponAmt;  // coupon paid at the end of period
+    std::vector<double> periodFrac; // 1 except for an odd first or last period
+    std::vector<double> coupon, redemption;
+    std::vector<int> frequency;
+    std::vector<FinEnum::DayCountConvention> dc;
+    std::vector<FinEnum::AccrualConvention> accrualConv;
+    std::vector<FinEnum::BondFeature> yieldConv;
+    std::vector<const Calendar*> cal;
+
+    /**
+     * Where settlement falls in bond i's schedule: period k, the period
+     * fraction w to the next coupon and the accrued interest. Returns
+     * false when settle is outside of the schedule.
+     */
+    bool locate(int i, int settle, int& k, double& w, double& accrued) const;
+
+    /**
+     * Dirty price of bond i at yield y and its first two derivatives.
+     */
+    void dirtyPrice(int i, int k, double w, double y, double& price,
+		    double& dPrice, double& d2Price) const;
+
+    void computeOne(int i, FinEnum::CalcMode mode, int settle, double value,
+		    double& clean, double& dirty, double& accrued, double& yield,
+		    double& duration, double& convexity) const;
+
+public:
+
+    BondEngine() : offsets(1, 0) {}
+
+    /**
+     * Add a bond paying coupon (annual rate) on the dates of schedule.
+     * yieldConv is NoFeature, Moosmuller or BraessFangmeyer. Returns the
+     * index of the bond.
+     */
+    int add(const Schedule& schedule, double coupon,
+	    double redemption = 100,
+	    FinEnum::BondFeature yieldConv = FinEnum::NoFeature,
+	    FinEnum::AccrualConvention accrualConv = FinEnum::Standard);
+
+    /**
+     * Add a bond with n increasing dates (effective, coupon dates,
+     * maturity; julian day numbers). All periods are taken to be regular
+     * (use a Schedule for bonds with short periods).
+     */
+    int add(const int* dates, int n, double coupon, int frequency,
+	    FinEnum::DayCountConvention dc, double redemption = 100,
+	    FinEnum::BondFeature yieldConv = FinEnum::NoFeature,
+	    FinEnum::AccrualConvention accrualConv = FinEnum::Standard,
+	    const Calendar& cal = Calendar::get("WeekendsOnly"));
+
+    int numBonds() const { return coupon.size(); }
+
+    /**
+     * For every bond i: settle[i] is its settlement date (julian day
+     * number) and value[i] is its yield (FixedYield) or clean price
+     * (FixedPrice). The arrays of out are resized to numBonds().
+     */
+    void compute(FinEnum::CalcMode mode, const int* settle,
+		 const double* value, BondAnalytics& out) const;
+
+    /**
+     * Same with a calculation mode for each bond.
+     */
+    void compute(const FinEnum::CalcMode* mode, const int* settle,
+		 const double* value, BondAnalytics& out) const;
+
+    void compute(FinEnum::CalcMode mode, const std::vector<int>& settle,
+		 const std::vector<double>& value, BondAnalytics& out) const;
+
+    /**
+     * Single bond versions (NaN when they cannot be computed).
+     */
+    double cleanPrice(int i, int settle, double yield) const;
+    double yield(int i, int settle, double cleanPrice) const;
+};
+
+} // end cxxPack namespace
+
+#endif
@@ -0,0 +1,155 @@
+// Bootstrap.hpp: discount curve bootstrapping from market quotes
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BOOTSTRAP_HPP
+#define BOOTSTRAP_HPP
+
+#include <vector>
+
+#include <FinEnum.hpp>
+#include <FinDate.hpp>
+#include <Calendar.hpp>
+#include <DiscountCurve.hpp>
+
+namespace cxxPack {
+
+/**
+ * Strips a single (discounting and forecasting) curve from deposits,
+ * 3 month IMM futures (Eurodollar, SOFR) and par swaps. Each instrument
+ * adds a pillar at its last date, and its quote fixes the discount
+ * factor there, given the pillars before it:
+ *
+ * - Deposit: from the reference date to months later (rolled Modified
+ *   Following), P(start)/P(end) = 1 + rate*yearFrac(start, end, dc).
+ * - Future: from the third Wednesday of the contract month to the third
+ *   Wednesday 3 months later, with rate = (100 - price)/100 less a
+ *   convexity adjustment, as for a deposit between those dates.
+ * - Swap: fixed leg on a Schedule from the reference date to years later
+ *   with the fixed rate, against a floating leg worth
+ *   P(start) - P(maturity).
+ *
+ * Discount factors between pillars are log-linear in the strip, so each
+ * pillar is one Newton solve. The resulting curve() uses the requested
+ * interpolation over the stripped pillars (with LogLinear it reprices
+ * every instrument exactly).
+ *
+ * Instrument dates are computed when the instrument is added, and their
+ * positions between pillars when the next curve() sees the new set of
+ * pillars. Times are ACT/365 year fractions from the reference date,
+ * like the default DiscountCurve. When quotes change (setQuote())
+ * only the pillars from the first changed instrument on are solved
+ * again, the next time curve() is called, so intraday updates of the
+ * long end are cheap.
+ */
+class CurveBootstrapper {
+
+    enum InstrumentType { Deposit, Future, Swap };
+
+    /**
+     * A cash flow of an instrument, worth fixed + perRate*rate, at a date
+     * between pillars a and b = a+1 (weight w on b).
+     */
+    struct Flow {
+	int date;
+	int a, b;
+	double w;
+	double fixed, perRate;
+    };
+
+    struct Instrument {
+	InstrumentType type;
+	double quote;
+	double convexity; // futures
+	int pillar;       // last date
+	std::vector<Flow> flows;
+    };
+
+    int refDate;
+    const Calendar* cal;
+    FinEnum::Interpolation interp;
+
+    std::vector<Instrument> instruments; // in the order added
+    std::vector<int> order;  // instruments sorted by pillar
+    std::vector<int> rank;   // position of each instrument in order
+    std::vector<double> x;   // -log P at the reference date and pillars
+    int firstDirty;          // first position in order to solve again
+    bool structureChanged;   // instruments added since the last curve()
+    std::vector<DiscountCurve> cached; // empty, or the current curve
+
+    static Flow makeFlow(int date, double fixed, double perRate);
+    int add(InstrumentType type, double quote, double convexity,
+	    const std::vector<Flow>& flows);
+    void sortPillars();
+    double rate(const Instrument& inst) const;
+    void solve(int pos);
+
+public:
+
+    CurveBootstrapper(FinDate refDate,
+		      const Calendar& cal = Calendar::get("WeekendsOnly"),
+		      FinEnum::Interpolation interp = FinEnum::LogLinear);
+
+    /**
+     * Deposit from the reference date for months months. Returns the
+     * index of the instrument (used by setQuote()).
+     */
+    int addDeposit(int months, double rate,
+		   FinEnum::DayCountConvention dc = FinEnum::DCA360);
+
+    /**
+     * 3 month future for the contract month and year, quoted as a price
+     * (100 - rate in percent). convexity is subtracted from the futures
+     * rate (0.0002 is 2 basis points).
+     */
+    int addFuture(int month, int year, double price, double convexity = 0,
+		  FinEnum::DayCountConvention dc = FinEnum::DCA360);
+
+    /**
+     * Par swap for years years paying rate frequency times a year on the
+     * fixed leg.
+     */
+    int addSwap(int years, double rate, int frequency = 2,
+		FinEnum::DayCountConvention dc = FinEnum::DC30360I);
+
+    int numInstruments() const { return instruments.size(); }
+    double getQuote(int i) const { return instruments[i].quote; }
+
+    /**
+     * Last date of instrument i, where it puts its pillar.
+     */
+    FinDate getPillar(int i) const { return FinDate(instruments[i].pillar, true); }
+
+    /**
+     * Change the quote of instrument i (a rate, or a price for futures).
+     */
+    void setQuote(int i, double quote);
+
+    /**
+     * Number of pillars that the next curve() will solve.
+     */
+    int numDirty() const;
+
+    /**
+     * The bootstrapped curve, stripping the changed pillars first. The
+     * reference is valid until the next call that changes the
+     * bootstrapper.
+     */
+    const DiscountCurve& curve();
+};
+
+} // end cxxPack namespace
+
+#endif
@@ -0,0 +1,250 @@
+// Calendar.hpp: holiday calendars for business day calculations
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CALENDAR_HPP
+#define CALENDAR_HPP
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <FinDate.hpp>
+
+namespace cxxPack {
+
+/**
+ * Holiday calendar for business day calculations. Saturdays, Sundays and
+ * the listed holidays are non-business days. The business days in
+ * [firstYear, lastYear] are stored as a bitset (one bit per day, 64 days
+ * per word) together with the number of business days that precede each
+ * word, so isBusDay(), nextBusDay(), prevBusDay() and busDaysBetween() do
+ * not depend on the distance between dates. Outside of the covered years
+ * only weekends are treated as non-business days.
+ *
+ * All of the int based methods take and return julian day numbers (see
+ * FinDate::serialJulian()).
+ *
+ * Calendars can be registered by name (see add() and load()) so that
+ * they can be shared, for example, get("NYSE"). Register calendars before
+ * they are used: replacing a calendar that other threads are reading is
+ * not safe. "WeekendsOnly", the default calendar of Schedule,
+ * AccrualEngine, BondEngine and CurveBootstrapper, is registered when
+ * the registry is created, so get() only reads the registry for it;
+ * make one registry call (such as get("WeekendsOnly")) before starting
+ * threads, since creating the registry is not synchronized.
+ *
+ * A joint calendar combines several registered calendars, for example,
+ * joint("NYSE", "London") for instruments that settle in both centers.
+ * Its bitset and prefix counts are built once and cached, so queries
+ * against it cost the same as queries against a single calendar.
+ */
+class Calendar {
+public:
+    /**
+     * JoinHolidays: a business day must be a business day in every
+     * member calendar (holidays are combined).
+     * JoinBusinessDays: a business day in any member calendar is a
+     * business day (only common holidays remain).
+     */
+    enum JoinRule { JoinHolidays, JoinBusinessDays };
+
+private:
+    std::string name;
+    std::vector<int> holidays; // sorted, unique, weekdays only.
+    int firstYear, lastYear;
+    int firstJdn, lastJdn; // JDN(1/1/firstYear), JDN(12/31/lastYear).
+
+    std::vector<uint64_t> busDays; // bit b of word w is day firstJdn+64*w+b.
+    std::vector<int> prefixCount; // business days preceding word w.
+
+    // Member calendar names for a joint calendar (empty otherwise).
+    std::vector<std::string> members;
+    JoinRule joinRule;
+
+    void build();
+    void buildJoint();
+    static void rebuildDependents(const std::string& name);
+    bool inRange(int jdn) const { return jdn >= firstJdn && jdn <= lastJdn; }
+
+public:
+
+    static const int defaultFirstYear, defaultLastYear;
+
+    /**
+     * A calendar where only weekends are non-business days.
+     */
+    Calendar(std::string name_ = "WeekendsOnly",
+	     int firstYear_ = defaultFirstYear,
+	     int lastYear_ = defaultLastYear);
+
+    /**
+     * Construct from a list of holidays (julian day numbers). Holidays
+     * that fall on weekends or outside of [firstYear, lastYear] are ignored.
+     */
+    Calendar(std::string name_, const std::vector<int>& holidayJdns,
+	     int firstYear_ = defaultFirstYear,
+	     int lastYear_ = defaultLastYear);
+
+    Calendar(std::string name_, const std::vector<FinDate>& holidayDates,
+	     int firstYear_ = defaultFirstYear,
+	     int lastYear_ = defaultLastYear);
+
+    std::string getName() const { return name; }
+    bool isJoint() const { return members.size() > 0; }
+    const std::vector<std::string>& getMembers() const { return members; }
+    int getFirstYear() const { return firstYear; }
+    int getLastYear() const { return lastYear; }
+    const std::vector<int>& getHolidays() const { return holidays; }
+
+    /**
+     * True if jdn is not a weekend day or a holiday.
+     */
+    bool isBusDay(int jdn) const {
+	if(!inRange(jdn))
+	    return !isWeekend(jdn);
+	int off = jdn - firstJdn;
+	return (busDays[off >> 6] >> (off & 63)) & 1;
+    }
+
+    /**
+     * Holiday that does not fall on a weekend.
+     */
+    bool isHoliday(int jdn) const {
+	return !isWeekend(jdn) && !isBusDay(jdn);
+    }
+
+    /**
+     * Next business day after jdn (jdn is not included).
+     */
+    int nextBusDay(int jdn) const;
+
+    /**
+     * Previous business day before jdn (jdn is not included).
+     */
+    int prevBusDay(int jdn) const;
+
+    /**
+     * Next business day, unless that falls in the following month, in
+     * which case the previous business day is returned.
+     */
+    int modNextBusDay(int jdn) const;
+
+    /**
+     * Roll jdn to a business day using the specified convention. Unlike
+     * nextBusDay() and prevBusDay(), a business day is returned unchanged.
+     * The modified conventions roll the other way when the first choice
+     * falls in a different month. EndOfMonth returns the last business
+     * day of the month of jdn, whether or not jdn is a business day.
+     */
+    int adjust(int jdn, FinEnum::BusDayConvention conv) const;
+
+    /**
+     * Batch version: out[i] = adjust(jdns[i], conv). jdns and out may be
+     * the same array.
+     */
+    void adjust(const int* jdns, int n, FinEnum::BusDayConvention conv,
+		int* out) const;
+    std::vector<int> adjust(const std::vector<int>& jdns,
+			    FinEnum::BusDayConvention conv) const;
+
+    /**
+     * Last business day of the month that contains jdn.
+     */
+    int lastBusDayOfMonth(int jdn) const;
+
+    /**
+     * Move n business days from jdn, for example, advance(trade, 2) for
+     * T+2 settlement: for n > 0 the n-th business day after jdn, for
+     * n < 0 the -n-th business day before jdn, and for n == 0 jdn rolled
+     * forward to a business day. Uses weekday arithmetic and the prefix
+     * counts, so the cost does not depend on n.
+     */
+    int advance(int jdn, int n) const;
+
+    /**
+     * Batch version: out[i] = advance(jdns[i], n). jdns and out may be
+     * the same array.
+     */
+    void advance(const int* jdns, int count, int n, int* out) const;
+    std::vector<int> advance(const std::vector<int>& jdns, int n) const;
+
+    /**
+     * Number of business days d with jdn1 <= d < jdn2 (negative when
+     * jdn2 < jdn1).
+     */
+    int busDaysBetween(int jdn1, int jdn2) const {
+	return busDaysBefore(jdn2) - busDaysBefore(jdn1);
+    }
+
+    /**
+     * Number of business days d with JDN(1/1/firstYear) <= d < jdn
+     * (negative for jdn before the covered years).
+     */
+    int busDaysBefore(int jdn) const;
+
+    static bool isWeekend(int jdn) {
+	int weekday = (jdn+1)%7; // Sun=0, ..., Sat=6
+	return weekday == cxxPack::Sat || weekday == cxxPack::Sun;
+    }
+
+    /**
+     * Number of weekdays d with jdn1 <= d < jdn2 (negative when
+     * jdn2 < jdn1).
+     */
+    static int weekdaysBetween(int jdn1, int jdn2);
+
+    /**
+     * Register a copy of cal under cal.getName(), replacing any
+     * calendar with the same name. Returns the registered copy.
+     */
+    static const Calendar& add(const Calendar& cal);
+
+    /**
+     * Read holidays from a text file with one date per line in ISO
+     * (2010-12-24) or US (12/24/2010) format, parsed by DateIO::parse().
+     * Blank lines and lines that start with '#' are skipped. The calendar
+     * is registered under name.
+     */
+    static const Calendar& load(std::string name, std::string fileName,
+				int firstYear = defaultFirstYear,
+				int lastYear = defaultLastYear);
+
+    /**
+     * Fetch a registered calendar. The name "WeekendsOnly" is always
+     * registered. Does not modify the registry, so it can be called
+     * from several threads once the calendars are registered.
+     */
+    static const Calendar& get(std::string name);
+    static bool has(std::string name);
+
+    /**
+     * Fetch the joint calendar for the named (registered) calendars,
+     * building and caching it on first use. The cache key does not depend
+     * on the order of the names: joint("NYSE","London") and
+     * joint("London","NYSE") are the same registered calendar, named
+     * "London+NYSE" for JoinHolidays and "London|NYSE" for
+     * JoinBusinessDays. Re-registering a member calendar with add()
+     * rebuilds the cached joint calendars that use it.
+     */
+    static const Calendar& joint(const std::vector<std::string>& names,
+				 JoinRule rule = JoinHolidays);
+    static const Calendar& joint(std::string name1, std::string name2,
+				 JoinRule rule = JoinHolidays);
+};
+
+} // end cxxPack namespace
+
+#endif
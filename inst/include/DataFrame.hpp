@@ -23,13 +23,111 @@
 #include <Rcpp.h>
 
 #include <FinDate.hpp>
+#include <FinDatetime.hpp>
 #include <Factor.hpp>
 
 namespace cxxPack {
 
+/**
+ * A contiguous range of n column values, with T const for read-only
+ * access. It does not own the values, and is valid as long as the
+ * storage it was taken from.
+ */
+template <class T>
+class ColumnSpan {
+    T* ptr;
+    int n;
+public:
+    ColumnSpan() : ptr(0), n(0) {}
+    ColumnSpan(T* ptr_, int n_) : ptr(ptr_), n(n_) {}
+
+    // Converts ColumnSpan<T> to ColumnSpan<const T>.
+    template <class U>
+    ColumnSpan(const ColumnSpan<U>& span) : ptr(span.data()), n(span.size()) {}
+
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + n; }
+    T* data() const { return ptr; }
+    int size() const { return n; }
+    bool empty() const { return n == 0; }
+    T& operator[](int i) const { return ptr[i]; }
+};
+
+/**
+ * Loops over whole column spans, written so that the compiler can
+ * vectorize them (no type checks or calls per element). NA values are
+ * not treated specially: NA_real_ propagates as NaN, while NA_INTEGER is
+ * just a large negative number.
+ */
+class ColumnKernels {
+public:
+
+    /**
+     * Sum of the values, accumulated in double precision (with four
+     * partial sums, so the additions do not wait on each other).
+     */
+    template <class T>
+    static double sum(const ColumnSpan<T>& span) {
+	const T* p = span.data();
+	int n = span.size(), i = 0;
+	double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	for(; i + 4 <= n; i += 4) {
+	    s0 += p[i];
+	    s1 += p[i+1];
+	    s2 += p[i+2];
+	    s3 += p[i+3];
+	}
+	for(; i < n; ++i)
+	    s0 += p[i];
+	return (s0 + s1) + (s2 + s3);
+    }
+
+    /**
+     * Multiplies the values by factor, in place.
+     */
+    template <class T>
+    static void scale(const ColumnSpan<T>& span, T factor) {
+	T* p = span.data();
+	int n = span.size();
+	for(int i = 0; i < n; ++i)
+	    p[i] *= factor;
+    }
+
+    /**
+     * out[i] = 1 if span[i] > value, else 0 (out has span.size()
+     * elements). Returns the number of ones.
+     */
+    template <class T, class V>
+    static int greater(const ColumnSpan<T>& span, V value, int* out) {
+	const T* p = span.data();
+	int n = span.size(), count = 0;
+	for(int i = 0; i < n; ++i) {
+	    out[i] = p[i] > value;
+	    count += out[i];
+	}
+	return count;
+    }
+
+    /**
+     * out[i] = 1 if span[i] < value, else 0. Returns the number of ones.
+     */
+    template <class T, class V>
+    static int less(const ColumnSpan<T>& span, V value, int* out) {
+	const T* p = span.data();
+	int n = span.size(), count = 0;
+	for(int i = 0; i < n; ++i) {
+	    out[i] = p[i] < value;
+	    count += out[i];
+	}
+	return count;
+    }
+};
+
 /**
  * Models one column of an R data frame. Can be of type double, int,
- * string, bool, Factor, FinDate, RcppDate, and RcppDatetime.
+ * string, bool, Factor, FinDate, RcppDate, RcppDatetime, and FinDatetime.
+ * A FrameColumn owns its data: copies are deep, while swap(), adopt() and
+ * (with C++11) moves transfer the data without copying it.
  */
 class FrameColumn {
 
@@ -37,10 +135,31 @@ class FrameColumn {
 	std::string mesg=std::string("Invalid ")+typeStr+"Value request in FrameColumn";
 	throw std::range_error(mesg);
     }
+
+    void init();
+    void release();
+
+    template <class T>
+    ColumnSpan<T> span(std::vector<T>* v, int type_,
+		       const char* typeStr) const {
+	if(type != type_) lookupError(typeStr);
+	return v->empty() ? ColumnSpan<T>() : ColumnSpan<T>(&(*v)[0], v->size());
+    }
+
+    template <class T>
+    void adoptVector(std::vector<T>*& slot, std::vector<T>& v, int type_) {
+	std::vector<T>* p = new std::vector<T>();
+	p->swap(v);
+	release();
+	slot = p;
+	type = (ColType)type_;
+    }
+
 public:
 enum ColType { COLTYPE_DOUBLE, COLTYPE_INT, COLTYPE_STRING,
 	       COLTYPE_FACTOR, COLTYPE_LOGICAL, COLTYPE_FINDATE,
-	       COLTYPE_RCPPDATE, COLTYPE_RCPPDATETIME, COLTYPE_NONE };
+	       COLTYPE_RCPPDATE, COLTYPE_RCPPDATETIME, COLTYPE_FINDATETIME,
+	       COLTYPE_NONE };
 
     ColType type;
 
@@ -52,17 +171,38 @@ enum ColType { COLTYPE_DOUBLE, COLTYPE_INT, COLTYPE_STRING,
     std::vector<FinDate>* colFinDate;
     std::vector<RcppDate>* colRcppDate;
     std::vector<RcppDatetime>* colRcppDatetime;
+    std::vector<FinDatetime>* colFinDatetime;
     Factor* colFactor;
 
-    FrameColumn() { type = COLTYPE_NONE; }
+    FrameColumn() { init(); }
     FrameColumn(const FrameColumn& col);
-    ~FrameColumn();
+    ~FrameColumn() { release(); }
+
+    FrameColumn& operator=(const FrameColumn& col) {
+	FrameColumn tmp(col);
+	swap(tmp);
+	return *this;
+    }
 
-    FrameColumn& operator=(const FrameColumn& col);
+    /**
+     * Exchanges the contents of two columns without copying them.
+     */
+    void swap(FrameColumn& col);
+
+#if __cplusplus >= 201103L
+    FrameColumn(FrameColumn&& col) noexcept { init(); swap(col); }
+    FrameColumn& operator=(FrameColumn&& col) noexcept {
+	if(this != &col) {
+	    release();
+	    swap(col);
+	}
+	return *this;
+    }
+#endif
 
     FrameColumn(int type_, int nrows) {
-	type = (ColType)type_;
-	switch(type) {
+	init();
+	switch((ColType)type_) {
 	    case COLTYPE_INT:
 		colInt = new std::vector<int>(nrows);
 		break;
@@ -81,6 +221,9 @@ enum ColType { COLTYPE_DOUBLE, COLTYPE_INT, COLTYPE_STRING,
 	    case COLTYPE_RCPPDATETIME:
 		colRcppDatetime = new std::vector<RcppDatetime>(nrows);
 		break;
+	    case COLTYPE_FINDATETIME:
+		colFinDatetime = new std::vector<FinDatetime>(nrows);
+		break;
 	    case COLTYPE_LOGICAL:
 	    case COLTYPE_FACTOR:
 		throw std::range_error("Factor/Logical cols not permitted in this RcppFrame constructor");
@@ -89,41 +232,126 @@ enum ColType { COLTYPE_DOUBLE, COLTYPE_INT, COLTYPE_STRING,
 		break;
 		    
 	}
+	type = (ColType)type_;
     }
 
-    FrameColumn(std::vector<int>& colInt_) {
+    // These copy their argument (see adopt() and, with C++11, the
+    // constructors taking rvalues to avoid the copy).
+    FrameColumn(const std::vector<int>& colInt_) {
+	init();
 	colInt = new std::vector<int>(colInt_);
 	type=COLTYPE_INT;
     }
-    FrameColumn(std::vector<double>& colDouble_) {
+    FrameColumn(const std::vector<double>& colDouble_) {
+	init();
 	colDouble = new std::vector<double>(colDouble_);
 	type=COLTYPE_DOUBLE;
     }
-    FrameColumn(std::vector<std::string>& colString_) {
+    FrameColumn(const std::vector<std::string>& colString_) {
+	init();
 	colString = new std::vector<std::string>(colString_);
 	type=COLTYPE_STRING;
     }
-    FrameColumn(std::vector<bool>& colBool_) {
+    FrameColumn(const std::vector<bool>& colBool_) {
+	init();
 	colBool = new std::vector<bool>(colBool_);
 	type=COLTYPE_LOGICAL;
     }
-    FrameColumn(std::vector<FinDate>& colFinDate_) {
+    FrameColumn(const std::vector<FinDate>& colFinDate_) {
+	init();
 	colFinDate = new std::vector<FinDate>(colFinDate_);
 	type=COLTYPE_FINDATE;
     }
-    FrameColumn(std::vector<RcppDate>& colRcppDate_) {
+    FrameColumn(const std::vector<RcppDate>& colRcppDate_) {
+	init();
 	colRcppDate = new std::vector<RcppDate>(colRcppDate_);
 	type=COLTYPE_RCPPDATE;
     }
-    FrameColumn(std::vector<RcppDatetime>& colRcppDatetime_) {
+    FrameColumn(const std::vector<RcppDatetime>& colRcppDatetime_) {
+	init();
 	colRcppDatetime = new std::vector<RcppDatetime>(colRcppDatetime_);
 	type=COLTYPE_RCPPDATETIME;
     }
-    FrameColumn(Factor& colFactor_) {
+    FrameColumn(const std::vector<FinDatetime>& colFinDatetime_) {
+	init();
+	colFinDatetime = new std::vector<FinDatetime>(colFinDatetime_);
+	type=COLTYPE_FINDATETIME;
+    }
+    FrameColumn(const Factor& colFactor_) {
+	init();
 	colFactor = new Factor(colFactor_);
 	type=COLTYPE_FACTOR;
     }
 
+#if __cplusplus >= 201103L
+    // Take over the elements of their argument.
+    FrameColumn(std::vector<int>&& colInt_) { init(); adopt(colInt_); }
+    FrameColumn(std::vector<double>&& colDouble_) { init(); adopt(colDouble_); }
+    FrameColumn(std::vector<std::string>&& colString_) {
+	init();
+	adopt(colString_);
+    }
+    FrameColumn(std::vector<bool>&& colBool_) { init(); adopt(colBool_); }
+    FrameColumn(std::vector<FinDate>&& colFinDate_) {
+	init();
+	adopt(colFinDate_);
+    }
+    FrameColumn(std::vector<RcppDate>&& colRcppDate_) {
+	init();
+	adopt(colRcppDate_);
+    }
+    FrameColumn(std::vector<RcppDatetime>&& colRcppDatetime_) {
+	init();
+	adopt(colRcppDatetime_);
+    }
+    FrameColumn(std::vector<FinDatetime>&& colFinDatetime_) {
+	init();
+	adopt(colFinDatetime_);
+    }
+    FrameColumn(Factor&& colFactor_) {
+	init();
+	colFactor = new Factor(std::move(colFactor_));
+	type=COLTYPE_FACTOR;
+    }
+#endif
+
+    /**
+     * Replaces the contents of this column by the elements of v, which
+     * is left empty. The elements are not copied, so a column can be
+     * filled in a local vector and then handed to the frame.
+     */
+    void adopt(std::vector<int>& v) { adoptVector(colInt, v, COLTYPE_INT); }
+    void adopt(std::vector<double>& v) {
+	adoptVector(colDouble, v, COLTYPE_DOUBLE);
+    }
+    void adopt(std::vector<std::string>& v) {
+	adoptVector(colString, v, COLTYPE_STRING);
+    }
+    void adopt(std::vector<bool>& v) {
+	adoptVector(colBool, v, COLTYPE_LOGICAL);
+    }
+    void adopt(std::vector<FinDate>& v) {
+	adoptVector(colFinDate, v, COLTYPE_FINDATE);
+    }
+    void adopt(std::vector<RcppDate>& v) {
+	adoptVector(colRcppDate, v, COLTYPE_RCPPDATE);
+    }
+    void adopt(std::vector<RcppDatetime>& v) {
+	adoptVector(colRcppDatetime, v, COLTYPE_RCPPDATETIME);
+    }
+    void adopt(std::vector<FinDatetime>& v) {
+	adoptVector(colFinDatetime, v, COLTYPE_FINDATETIME);
+    }
+
+    /**
+     * Takes ownership of factor, which must have been allocated with new.
+     */
+    void adopt(Factor* factor) {
+	release();
+	colFactor = factor;
+	type = COLTYPE_FACTOR;
+    }
+
     ColType getType() { return type; }
     
     int& getInt(int i) { 
@@ -154,6 +382,10 @@ enum ColType { COLTYPE_DOUBLE, COLTYPE_INT, COLTYPE_STRING,
 	if(type != COLTYPE_RCPPDATETIME) lookupError("RcppDatetime");
 	return (*colRcppDatetime)[i];
     }
+    FinDatetime& getFinDatetime(int i) {
+	if(type != COLTYPE_FINDATETIME) lookupError("FinDatetime");
+	return (*colFinDatetime)[i];
+    }
     std::string getFactor(int i) { 
 	if(type != COLTYPE_FACTOR) lookupError("Factor");
 	return colFactor->getObservedLevelStr(i);
@@ -177,22 +409,56 @@ enum ColType { COLTYPE_DOUBLE, COLTYPE_INT, COLTYPE_STRING,
 	    return colRcppDate->size();
 	case COLTYPE_RCPPDATETIME:
 	    return colRcppDatetime->size();
+	case COLTYPE_FINDATETIME:
+	    return colFinDatetime->size();
 	case COLTYPE_NONE:
 	    throw std::range_error("Bad COLTYPE in DataFraem.size()");
 	}
 	return -1;
     }
 
+    /**
+     * All of the values of the column, after a single check that the
+     * column holds values of type T: as<double>(), as<int>(),
+     * as<std::string>(), as<FinDate>(), as<RcppDate>(),
+     * as<RcppDatetime>() or as<FinDatetime>(). (Logical and factor
+     * columns are not stored contiguously, and have no span.) The span
+     * is valid until the column is modified or destroyed.
+     */
+    template <class T> ColumnSpan<T> as();
+    template <class T> ColumnSpan<const T> as() const;
+
     void print();
 
 };
 
+#define FRAMECOLUMN_AS(T, member, colType, typeStr) \
+    template <> inline ColumnSpan<T> FrameColumn::as<T>() { \
+	return span(member, colType, typeStr); \
+    } \
+    template <> inline ColumnSpan<const T> FrameColumn::as<T>() const { \
+	return span(member, colType, typeStr); \
+    }
+
+FRAMECOLUMN_AS(int, colInt, COLTYPE_INT, "Int")
+FRAMECOLUMN_AS(double, colDouble, COLTYPE_DOUBLE, "Double")
+FRAMECOLUMN_AS(std::string, colString, COLTYPE_STRING, "String")
+FRAMECOLUMN_AS(FinDate, colFinDate, COLTYPE_FINDATE, "FinDate")
+FRAMECOLUMN_AS(RcppDate, colRcppDate, COLTYPE_RCPPDATE, "RcppDate")
+FRAMECOLUMN_AS(RcppDatetime, colRcppDatetime, COLTYPE_RCPPDATETIME,
+	       "RcppDatetime")
+FRAMECOLUMN_AS(FinDatetime, colFinDatetime, COLTYPE_FINDATETIME,
+	       "FinDatetime")
+
+#undef FRAMECOLUMN_AS
+
 /**
  * Models an R data frame as a vector of FrameColumn's, with a corresponding
  * vector of column names and row names consistent with R's representation.
  * When constructed from an R data frame SEXP input Dates are mapped to
  * FinDate by default; this can be changed to RcppDate by setting the
- * flag useRcppDate_. When constructed from native C++ structures both
+ * flag useRcppDate_. Similarly, POSIXct columns are mapped to RcppDatetime
+ * unless useFinDatetime_ is set. When constructed from native C++ structures both
  * FinDate and RcppDate columns can be included (but I'm not sure why
  * you would want to do this).
  */
@@ -200,17 +466,25 @@ class DataFrame {
     std::vector<std::string> rowNames;
     std::vector<std::string> colNames;
     std::vector<FrameColumn> cols;
-    static bool useRcppDate_;
+    static bool useRcppDate_, useFinDatetime_;
+    SEXP toR(bool transfer);
 public:
 
     // Use this to map R Dates to RcppDate instead of FinDate.
     static void useRcppDate(bool flag) { useRcppDate_ = flag; }
 
+    // Use this to map R POSIXct to FinDatetime instead of RcppDatetime
+    // (NA maps to FinDatetime::NA(), and back to NA).
+    static void useFinDatetime(bool flag) { useFinDatetime_ = flag; }
+
     DataFrame(SEXP df);
     DataFrame(std::vector<std::string> rowNames_, std::vector<std::string> colNames_,
-	       std::vector<FrameColumn> cols_) : rowNames(rowNames_),
-					   colNames(colNames_),
-					   cols(cols_) {
+	       std::vector<FrameColumn> cols_) {
+	// The arguments are already copies, so take them over.
+	rowNames.swap(rowNames_);
+	colNames.swap(colNames_);
+	cols.swap(cols_);
+
 	// Validate the input data.
 	bool badInput = (cols.size() <= 0) || (cols[0].size() <= 0);
 	if(!badInput) {
@@ -224,8 +498,9 @@ public:
 	    throw std::range_error("Inconsistent dims in DataFrame constructor");
     }
 
-    DataFrame(std::vector<std::string> rowNames_, std::vector<std::string> colNames_, std::vector<int> colTypes_) : rowNames(rowNames_),
-														    colNames(colNames_) {
+    DataFrame(std::vector<std::string> rowNames_, std::vector<std::string> colNames_, std::vector<int> colTypes_) {
+	rowNames.swap(rowNames_);
+	colNames.swap(colNames_);
 
 	// The purpose of this constructor is to eliminate the need to copy
 	// all of the user's columns (could be quite long) into the 
@@ -242,7 +517,8 @@ public:
 	cols.resize((int)colNames.size());
 
 	for(int i=0; i < (int)colTypes_.size(); ++i) {
-	    cols[i] = FrameColumn(colTypes_[i], nrows);
+	    FrameColumn col(colTypes_[i], nrows);
+	    cols[i].swap(col);
 	}
 
 	// Validate the input data.
@@ -259,7 +535,18 @@ public:
 	    throw std::range_error("Inconsistent dims in DataFrame constructor");
     }
 
-    operator SEXP();
+    operator SEXP() { return toR(false); }
+
+    /**
+     * Like operator SEXP, but hands the double and integer columns to R
+     * instead of copying them, leaving this frame empty. With R 3.5 or
+     * later these columns become ALTREP vectors over the column buffers,
+     * so the transfer does not depend on the number of rows; R frees the
+     * buffers when it collects the vectors. Other columns, and all
+     * columns with earlier versions of R, are copied. If the transfer
+     * fails this frame is left unchanged.
+     */
+    SEXP transferToR();
 
     void print() { // for debugging
 	for(int c = 0; c < (int)cols.size(); ++c) {
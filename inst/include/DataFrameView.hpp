@@ -0,0 +1,130 @@
+// DataFrameView.hpp: read-only view of an R data frame without copies
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DATAFRAMEVIEW_HPP
+#define DATAFRAMEVIEW_HPP
+
+#include <string>
+#include <vector>
+
+#include <Rcpp.h>
+
+#include <FinDate.hpp>
+#include <DataFrame.hpp>
+
+namespace cxxPack {
+
+/**
+ * An alternative to DataFrame(SEXP) for code that mostly reads a frame.
+ * Instead of copying each column into a FrameColumn the view keeps a
+ * pointer to R's storage, and the frame is protected from the garbage
+ * collector for the lifetime of the view. Column types are as for
+ * DataFrame, with the values as R stores them:
+ *
+ * - COLTYPE_DOUBLE: getDoubles().
+ * - COLTYPE_INT: getInts().
+ * - COLTYPE_LOGICAL: getInts(), with 0, 1 or NA_INTEGER.
+ * - COLTYPE_FACTOR: getInts() gives the level numbers (1-based, as in R),
+ *   and getLevels() the level names.
+ * - COLTYPE_FINDATE: R Date serial numbers, from getDoubles() or, for the
+ *   occasional Date stored as integers, getInts(). getFinDate() works
+ *   with both.
+ * - COLTYPE_RCPPDATETIME: POSIXct seconds since the epoch, getDoubles().
+ * - COLTYPE_STRING: getString() (R strings cannot be spanned).
+ *
+ * NA values are left as R represents them. The columns must not be
+ * modified on the R side while the view exists. To change values in C++
+ * call mutableDoubles() or mutableInts(): the first call copies the
+ * column into the view, and later reads of that column see the copy,
+ * while the R frame is never written. The spans contain no R objects,
+ * so they can be read from several threads.
+ */
+class DataFrameView {
+
+    struct Column {
+	FrameColumn::ColType type;
+	SEXP sexp;
+	const double* doubles; // REALSXP storage, or ownDoubles
+	const int* ints;       // INTSXP or LGLSXP storage, or ownInts
+	bool copied;
+	std::vector<double> ownDoubles;
+	std::vector<int> ownInts;
+	std::vector<std::string> levels; // factors
+    };
+
+    SEXP frame;
+    int nrow;
+    std::vector<std::string> colNames;
+    std::vector<Column> cols;
+
+    // Not copyable (the view protects frame until it is destroyed).
+    DataFrameView(const DataFrameView&);
+    DataFrameView& operator=(const DataFrameView&);
+
+    const Column& column(int j) const;
+
+public:
+
+    DataFrameView(SEXP df);
+    ~DataFrameView();
+
+    int numRows() const { return nrow; }
+    int numCols() const { return cols.size(); }
+    const std::vector<std::string>& getColNames() const { return colNames; }
+
+    /**
+     * Index of the column named name.
+     */
+    int getColIndex(const std::string& name) const;
+
+    FrameColumn::ColType getType(int j) const { return column(j).type; }
+
+    /**
+     * The values of column j, for columns stored as doubles.
+     */
+    ColumnSpan<const double> getDoubles(int j) const;
+
+    /**
+     * The values of column j, for columns stored as integers (including
+     * factors and logicals).
+     */
+    ColumnSpan<const int> getInts(int j) const;
+
+    /**
+     * Writable values of column j, copied from R on the first call.
+     */
+    ColumnSpan<double> mutableDoubles(int j);
+    ColumnSpan<int> mutableInts(int j);
+
+    /**
+     * True when column j has been copied by mutableDoubles() or
+     * mutableInts().
+     */
+    bool isCopied(int j) const { return column(j).copied; }
+
+    FinDate getFinDate(int i, int j) const;
+
+    /**
+     * Value i of a string column, or the level name of a factor.
+     */
+    std::string getString(int i, int j) const;
+
+    const std::vector<std::string>& getLevels(int j) const;
+};
+
+} // end cxxPack namespace
+
+#endif
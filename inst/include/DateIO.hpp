@@ -0,0 +1,133 @@
+// DateIO.hpp: fast date parsing and formatting
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DATEIO_HPP
+#define DATEIO_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#include <FinDate.hpp>
+
+namespace cxxPack {
+
+/**
+ * Conversion between date strings and julian day numbers (see
+ * FinDate::serialJulian()) without streams, locales or allocation per
+ * date. The formats are ISO (2010-12-24), US (12/24/2010) and
+ * WeekdayUS (Fri 12/24/2010, the operator<<() format for FinDate).
+ *
+ * When parsing, the month and day of the US formats may have one digit,
+ * and spaces, tabs and carriage returns around a date are ignored.
+ * AnyFormat accepts ISO or US. For WeekdayUS the name must be the
+ * weekday of the date.
+ *
+ * When formatting, ISO and US dates are fixed width (10 characters,
+ * zero padded) for years 0-9999, while WeekdayUS is not padded.
+ * Datetimes (seconds since 1970-01-01 00:00:00 UTC) are written in UTC
+ * as the date followed by HH:MM:SS.uuuuuu.
+ */
+class DateIO {
+public:
+    enum DateFormat { AnyFormat, ISOFormat, USFormat, WeekdayUSFormat };
+
+    /**
+     * Marks rows that could not be parsed (same value as R's NA_integer_).
+     */
+    static const int badJdn;
+
+    /**
+     * Parse the date in [s, end). Returns false (jdn unchanged) if it is
+     * not a valid date in the requested format.
+     */
+    static bool parse(const char* s, const char* end, int& jdn,
+		      DateFormat fmt = AnyFormat);
+
+    /**
+     * Parse the fields of buf[0,len) separated by delim (for example,
+     * '\n' for one date per line, or ','), writing one julian day number
+     * per field to out, which must have room for maxRows numbers. A
+     * delimiter at the very end of the buffer does not start another
+     * field. Returns the number of rows. Throws std::range_error giving
+     * the (0-based) row number of the first invalid date, or if there are
+     * more than maxRows rows.
+     */
+    static int parse(const char* buf, std::size_t len, char delim,
+		     int* out, int maxRows, DateFormat fmt = AnyFormat);
+
+    /**
+     * As above, but invalid rows are set to badJdn and their row numbers
+     * are appended to badRows instead of throwing.
+     */
+    static int parse(const char* buf, std::size_t len, char delim,
+		     int* out, int maxRows, std::vector<int>& badRows,
+		     DateFormat fmt = AnyFormat);
+
+    static std::vector<int> parse(const std::string& buf, char delim = '\n',
+				  DateFormat fmt = AnyFormat);
+
+    /**
+     * Number of fields parse() will find in buf[0,len), so that the
+     * output can be allocated once.
+     */
+    static int countRows(const char* buf, std::size_t len, char delim);
+
+    /**
+     * Buffer size that is always large enough for one formatted date or
+     * datetime, including the terminating null.
+     */
+    static const int maxDateLength = 40;
+
+    /**
+     * Write the date for jdn to buf (null terminated) and return the
+     * number of characters written, not counting the null.
+     */
+    static int format(int jdn, char* buf, DateFormat fmt = ISOFormat);
+
+    /**
+     * Write the datetime for secs (seconds since the epoch, as used by
+     * POSIXct and RcppDatetime) to buf, rounded to microseconds.
+     */
+    static int formatDatetime(double secs, char* buf,
+			      DateFormat fmt = ISOFormat);
+
+    /**
+     * Same for nanoseconds since the epoch (see FinDatetime), with nine
+     * digits for the fraction.
+     */
+    static int formatNanos(int64_t nanos, char* buf,
+			   DateFormat fmt = ISOFormat);
+
+    /**
+     * Batch versions: write the n dates (datetimes) to buf, each one
+     * followed by sep, and return the number of characters written. Use
+     * sep = '\0' to get n consecutive C strings. buf must have room for
+     * n*maxDateLength characters; for ISO and US dates in years 0-9999,
+     * 11*n is enough, and record i starts at buf + 11*i.
+     */
+    static std::size_t format(const int* jdns, int n, char* buf,
+			      DateFormat fmt = ISOFormat, char sep = '\n');
+
+    static std::size_t formatDatetime(const double* secs, int n, char* buf,
+				      DateFormat fmt = ISOFormat,
+				      char sep = '\n');
+};
+
+} // end cxxPack namespace
+
+#endif
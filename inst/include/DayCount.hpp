@@ -0,0 +1,339 @@
+// DayCount.hpp: batch day count calculations
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DAYCOUNT_HPP
+#define DAYCOUNT_HPP
+
+#include <vector>
+#include <cmath>
+
+#include <FinEnum.hpp>
+#include <FinDate.hpp>
+#include <Calendar.hpp>
+
+namespace cxxPack {
+
+/**
+ * Day counts for the conventions that count actual days, with or without
+ * leap days, and for the 30/360 family. Each count(jdn1, jdn2) matches
+ * FinDate::diffDays() for the corresponding convention.
+ */
+struct ActualDayCount {
+    static int count(int jdn1, int jdn2) { return jdn2 - jdn1; }
+};
+
+struct NoLeapDayCount {
+    static int count(int jdn1, int jdn2) {
+	int result = jdn2 - jdn1;
+	if(result == 0)
+	    return 0;
+	// Assumes |year1 - year2| <= 1 (see FinDate::diffDays()).
+	int y1 = FinDate::jdn2mdy(result > 0 ? jdn1 : jdn2).year;
+	int y2 = FinDate::jdn2mdy(result > 0 ? jdn2 : jdn1).year;
+	int leapDay;
+	if(FinDate::isLeapYear(y1))
+	    leapDay = FinDate::mdy2jdn(2, 29, y1);
+	else if(FinDate::isLeapYear(y2))
+	    leapDay = FinDate::mdy2jdn(2, 29, y2);
+	else
+	    return result;
+	if(jdn1 <= leapDay && jdn2 >= leapDay)
+	    result--;
+	else if(jdn1 >= leapDay && jdn2 <= leapDay)
+	    result++;
+	return result;
+    }
+};
+
+/**
+ * 30/360 day counts. Adjust::apply() adjusts the days of month of the
+ * earlier (1) and later (2) dates.
+ */
+template <typename Adjust>
+struct Thirty360DayCount {
+    static int count(int jdn1, int jdn2) {
+	if(jdn1 == jdn2)
+	    return 0;
+	int sign = jdn2 > jdn1 ? 1 : -1;
+	DateMDY mdy1 = FinDate::jdn2mdy(sign > 0 ? jdn1 : jdn2);
+	DateMDY mdy2 = FinDate::jdn2mdy(sign > 0 ? jdn2 : jdn1);
+	int d1 = mdy1.day, d2 = mdy2.day;
+	Adjust::apply(mdy1.month, d1, mdy1.year, mdy2.month, d2, mdy2.year);
+	return sign*((mdy2.year-mdy1.year)*360 + (mdy2.month-mdy1.month)*30
+		     + d2-d1);
+    }
+};
+
+struct Thirty360Adjust {
+    static bool endOfFeb(int d, int y) { // d is a day in February of y
+	return (FinDate::isLeapYear(y) && d == 29) || d == 28;
+    }
+};
+
+// 30/360 ISDA: d1 = min(d1,30); if d2 == 31 and d1 == 30, d2 = 30.
+struct Thirty360IAdjust {
+    static void apply(int, int& d1, int, int, int& d2, int) {
+	if(d1 == 31) d1 = 30;
+	if(d1 == 30 && d2 == 31) d2 = 30;
+    }
+};
+
+// 30E/360: d1 = min(d1,30); d2 = min(d2,30).
+struct Thirty360EAdjust {
+    static void apply(int, int& d1, int, int, int& d2, int) {
+	if(d1 == 31) d1 = 30;
+	if(d2 == 31) d2 = 30;
+    }
+};
+
+// 30/360 PSA: the end of February counts as the 30th for d1 (when
+// FinDate::adjustFebruary is set), otherwise as for ISDA.
+struct Thirty360P1Adjust : Thirty360Adjust {
+    static void apply(int m1, int& d1, int y1, int, int& d2, int) {
+	if(m1 == cxxPack::Feb && FinDate::adjustFebruary) {
+	    if(endOfFeb(d1, y1))
+		d1 = 30;
+	}
+	else if(d1 > 30)
+	    d1 = 30;
+	if(d1 == 30 && d2 == 31) d2 = 30;
+    }
+};
+
+// Symmetric PSA: the end of February counts as the 30th for d1, and
+// for d2 when FinDate::adjustFebruary is set.
+struct Thirty360P2Adjust : Thirty360Adjust {
+    static void apply(int m1, int& d1, int y1, int m2, int& d2, int y2) {
+	if(m1 == cxxPack::Feb) {
+	    if(endOfFeb(d1, y1))
+		d1 = 30;
+	}
+	else if(d1 == 31)
+	    d1 = 30;
+	if(m2 == cxxPack::Feb && FinDate::adjustFebruary) {
+	    if(endOfFeb(d2, y2))
+		d2 = 30;
+	}
+	else if(d2 == 31)
+	    d2 = 30;
+    }
+};
+
+/**
+ * A convention that divides a day count (plus extraDays) by a fixed
+ * number of days per year.
+ */
+template <typename DayCountRule, int DaysPerYear>
+struct FixedDivisorPolicy {
+    static double divisor() { return DaysPerYear; }
+    static int days(int jdn1, int jdn2) {
+	return DayCountRule::count(jdn1, jdn2);
+    }
+    static double yearFrac(int jdn1, int jdn2, int extraDays = 0) {
+	return (days(jdn1, jdn2) + extraDays) / divisor();
+    }
+    double operator()(int jdn1, int jdn2) const {
+	return yearFrac(jdn1, jdn2);
+    }
+};
+
+/**
+ * Compile-time day count conventions. DayCountPolicy<dc> provides
+ *
+ *   static double divisor();
+ *   static int days(int jdn1, int jdn2);
+ *   static double yearFrac(int jdn1, int jdn2, int extraDays = 0);
+ *   double operator()(int jdn1, int jdn2) const; // yearFrac
+ *
+ * with the same results as FinDate::divisor(dc), FinDate::diffDays() and
+ * FinDate::yearFrac() (those are dispatchers over these policies), so a
+ * pricing loop templated on the convention pays no per-date switch. The
+ * arguments are julian day numbers, and yearFrac() expects jdn1 < jdn2
+ * (the FinDate version checks this).
+ */
+template <FinEnum::DayCountConvention DC>
+struct DayCountPolicy;
+
+template <> struct DayCountPolicy<FinEnum::DCA360>
+    : FixedDivisorPolicy<ActualDayCount, 360> {};
+template <> struct DayCountPolicy<FinEnum::DCA365>
+    : FixedDivisorPolicy<ActualDayCount, 365> {};
+template <> struct DayCountPolicy<FinEnum::DCA252>
+    : FixedDivisorPolicy<ActualDayCount, 252> {};
+template <> struct DayCountPolicy<FinEnum::DCA360NL>
+    : FixedDivisorPolicy<NoLeapDayCount, 360> {};
+template <> struct DayCountPolicy<FinEnum::DCA365NL>
+    : FixedDivisorPolicy<NoLeapDayCount, 365> {};
+template <> struct DayCountPolicy<FinEnum::DC30360I>
+    : FixedDivisorPolicy<Thirty360DayCount<Thirty360IAdjust>, 360> {};
+template <> struct DayCountPolicy<FinEnum::DC30360E>
+    : FixedDivisorPolicy<Thirty360DayCount<Thirty360EAdjust>, 360> {};
+template <> struct DayCountPolicy<FinEnum::DC30360P1>
+    : FixedDivisorPolicy<Thirty360DayCount<Thirty360P1Adjust>, 360> {};
+template <> struct DayCountPolicy<FinEnum::DC30360P2>
+    : FixedDivisorPolicy<Thirty360DayCount<Thirty360P2Adjust>, 360> {};
+
+/**
+ * ACT/ACT: each calendar year touched contributes its days divided by
+ * the length of that year. extraDays is not used.
+ *
+ * Every full year between the first and last years contributes exactly
+ * 1.0, so only the two partial years need a division. To give the same
+ * result (to the last bit) as adding the years one at a time, the full
+ * years are added with addYears(), which does no more than one rounded
+ * add per power of two crossed, so the cost does not depend on the span.
+ */
+template <> struct DayCountPolicy<FinEnum::DCAA> {
+    static double divisor() { return 1.0; }
+    static int days(int jdn1, int jdn2) {
+	return ActualDayCount::count(jdn1, jdn2);
+    }
+    static double yearFrac(int jdn1, int jdn2, int extraDays = 0) {
+	int y1 = FinDate::jdn2mdy(jdn1).year, y2 = FinDate::jdn2mdy(jdn2).year;
+	if(y1 == y2)
+	    return (jdn2 - jdn1)/daysInYear(y1);
+	double frac = 0.;
+	frac += (FinDate::mdy2jdn(12, 31, y1) - jdn1)/daysInYear(y1);
+	frac = addYears(frac, y2 - y1 - 1);
+	frac += (jdn2 - FinDate::mdy2jdn(12, 31, y2-1))/daysInYear(y2);
+	return frac;
+    }
+
+    /**
+     * Same as adding 1.0 to frac numYears times (0 <= frac < 2^52).
+     * Inside [2^(e-1), 2^e) whole numbers are added exactly, so only
+     * the add that crosses 2^e can round.
+     */
+    static double addYears(double frac, int numYears) {
+	while(numYears > 0) {
+	    int e;
+	    std::frexp(frac, &e); // frac in [2^(e-1), 2^e)
+	    double room = std::ceil(std::ldexp(1.0, e) - frac) - 1;
+	    if(room > 0) {
+		int exact = room < numYears ? (int)room : numYears;
+		frac += exact;
+		numYears -= exact;
+	    }
+	    if(numYears > 0) { // the rounded step into the next binade
+		frac += 1.0;
+		numYears--;
+	    }
+	}
+	return frac;
+    }
+
+    double operator()(int jdn1, int jdn2) const {
+	return yearFrac(jdn1, jdn2);
+    }
+    static double daysInYear(int year) {
+	return FinDate::isLeapYear(year) ? 366.0 : 365.0;
+    }
+};
+
+/**
+ * BUS/252 (Brazil): business days d with jdn1 <= d < jdn2 divided by 252.
+ * The business days come from a holiday calendar, using its prefix counts
+ * (see Calendar::busDaysBetween()), so a pair costs the same for any
+ * span. Without a calendar only weekends are excluded. A policy object
+ * constructed with a calendar uses it in operator(). The calendar must
+ * outlive the policy object.
+ */
+template <> struct DayCountPolicy<FinEnum::DCB252> {
+    const Calendar* cal;
+    DayCountPolicy() : cal(0) {}
+    DayCountPolicy(const Calendar& cal_) : cal(&cal_) {}
+
+    static double divisor() { return 252.0; }
+    static int days(int jdn1, int jdn2) {
+	return Calendar::weekdaysBetween(jdn1, jdn2);
+    }
+    static int days(int jdn1, int jdn2, const Calendar& cal) {
+	return cal.busDaysBetween(jdn1, jdn2);
+    }
+    static double yearFrac(int jdn1, int jdn2, int extraDays = 0) {
+	return (days(jdn1, jdn2) + extraDays) / divisor();
+    }
+    static double yearFrac(int jdn1, int jdn2, const Calendar& cal,
+			   int extraDays = 0) {
+	return (days(jdn1, jdn2, cal) + extraDays) / divisor();
+    }
+    double operator()(int jdn1, int jdn2) const {
+	return cal ? yearFrac(jdn1, jdn2, *cal) : yearFrac(jdn1, jdn2);
+    }
+};
+
+/**
+ * Batch versions of FinDate::diffDays() and FinDate::yearFrac() that work
+ * on arrays of julian day numbers (see FinDate::serialJulian()). The day
+ * count convention is dispatched once per call instead of once per date
+ * pair (each case runs a loop over DayCountPolicy<dc>), and the ACT
+ * conventions reduce to a simple loop over the arrays that the compiler
+ * can vectorize. The results are the same as calling
+ * the FinDate versions on each pair.
+ */
+class DayCount {
+public:
+
+    /**
+     * out[i] = FinDate::diffDays(start[i], end[i], dc), i = 0,...,n-1.
+     */
+    static void diffDays(const int* start, const int* end, int n,
+			 FinEnum::DayCountConvention dc, int* out);
+
+    /**
+     * out[i] = FinDate::yearFrac(start[i], end[i], dc, extraDays[i]),
+     * i = 0,...,n-1. extraDays may be null (no extra days). Throws
+     * std::range_error naming the first index where start >= end; in
+     * that case nothing is written to out.
+     */
+    static void yearFrac(const int* start, const int* end, int n,
+			 FinEnum::DayCountConvention dc, double* out,
+			 const int* extraDays = 0);
+
+    static std::vector<int> diffDays(const std::vector<int>& start,
+				     const std::vector<int>& end,
+				     FinEnum::DayCountConvention dc);
+
+    static std::vector<double> yearFrac(const std::vector<int>& start,
+					const std::vector<int>& end,
+					FinEnum::DayCountConvention dc);
+
+    static std::vector<double> yearFrac(const std::vector<int>& start,
+					const std::vector<int>& end,
+					FinEnum::DayCountConvention dc,
+					const std::vector<int>& extraDays);
+
+    /**
+     * Versions that take a holiday calendar. It is used by the
+     * business day conventions (BUS/252) and ignored by the others.
+     */
+    static void diffDays(const int* start, const int* end, int n,
+			 FinEnum::DayCountConvention dc, const Calendar& cal,
+			 int* out);
+
+    static void yearFrac(const int* start, const int* end, int n,
+			 FinEnum::DayCountConvention dc, const Calendar& cal,
+			 double* out, const int* extraDays = 0);
+
+    static std::vector<double> yearFrac(const std::vector<int>& start,
+					const std::vector<int>& end,
+					FinEnum::DayCountConvention dc,
+					const Calendar& cal);
+};
+
+} // end cxxPack namespace
+
+#endif
@@ -0,0 +1,154 @@
+// DiscountCurve.hpp: interpolated discount factor curves
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DISCOUNTCURVE_HPP
+#define DISCOUNTCURVE_HPP
+
+#include <vector>
+
+#include <FinEnum.hpp>
+#include <FinDate.hpp>
+
+namespace cxxPack {
+
+/**
+ * Discount factors P(t) interpolated between pillar dates. The curve
+ * starts at the reference date (P = 1), and t is the year fraction from
+ * the reference date in the curve's day count convention (ACT/365 by
+ * default). With x = -log P(t):
+ *
+ * - LogLinear: x is linear between pillars (piecewise flat forwards).
+ * - CubicSpline: x is a natural cubic spline through the pillars.
+ * - MonotoneConvex: the instantaneous forward f = x' is the monotone
+ *   convex interpolation of Hagan and West (2006), which keeps the
+ *   average forward of each segment, is continuous, and does not
+ *   oscillate between monotone discrete forwards. (The optional
+ *   positivity constraint of the method is not applied, since negative
+ *   rates occur.)
+ *
+ * Past the last pillar the instantaneous forward is held flat at its
+ * value there, and before the reference date at its value at the
+ * reference date.
+ *
+ * The coefficients of each segment are computed once, when the curve is
+ * constructed, so a lookup is a segment search and a polynomial (plus
+ * one exp() for a discount factor). The batch lookups keep a cursor on
+ * the current segment and move it forward, so a sorted array of dates
+ * costs about one comparison per date for the search; unsorted dates are
+ * handled correctly with binary searches. The interpolation is dispatched
+ * once per batch. A DiscountCurve is not modified after construction and
+ * can be shared between threads.
+ */
+class DiscountCurve {
+
+    /**
+     * Segment i covers [t0, t0 + h) with -log P = x0 + c1*s + c2*s^2 +
+     * c3*s^3, s = t - t0 (LogLinear, CubicSpline), or with the monotone
+     * convex forward (fd, g0, g1, eta, A, type) when interpolation is
+     * MonotoneConvex.
+     */
+    struct Segment {
+	double t0, h, x0;
+	double c1, c2, c3;
+	double fd, g0, g1, eta, A;
+	int type;
+    };
+
+    int refDate; // julian day number
+    FinEnum::Interpolation interp;
+    FinEnum::DayCountConvention dc;
+    std::vector<int> pillarDates;
+    std::vector<double> pillarTimes; // includes the reference date (0)
+    std::vector<Segment> segs;
+    double fStart; // forward at the reference date
+    double xEnd, fEnd; // -log P and forward at the last pillar
+    double timeScale; // 1/days per year for the ACT/fixed conventions, else 0
+
+    void build(const int* dates, const double* discounts, int n);
+    void buildLinear(const std::vector<double>& x);
+    void buildCubic(const std::vector<double>& x);
+    void buildMonotoneConvex(const std::vector<double>& x);
+
+    int findSegment(double t, int& cursor) const;
+
+    template <FinEnum::Interpolation I>
+    double minusLogDiscount(int k, double t) const;
+    template <FinEnum::Interpolation I>
+    double instForward(int k, double t) const;
+
+    template <FinEnum::Interpolation I>
+    void batchDiscount(const int* dates, int n, double* out) const;
+    template <FinEnum::Interpolation I>
+    void batchForward(const int* dates, int n, double* out) const;
+
+public:
+
+    /**
+     * Pillar dates must follow refDate and increase, with positive
+     * discount factors.
+     */
+    DiscountCurve(FinDate refDate, const std::vector<FinDate>& pillars,
+		  const std::vector<double>& discounts,
+		  FinEnum::Interpolation interp = FinEnum::MonotoneConvex,
+		  FinEnum::DayCountConvention dc = FinEnum::DCA365);
+
+    /**
+     * Same with pillar dates given as julian day numbers.
+     */
+    DiscountCurve(int refJDN, const int* pillars, const double* discounts,
+		  int n, FinEnum::Interpolation interp = FinEnum::MonotoneConvex,
+		  FinEnum::DayCountConvention dc = FinEnum::DCA365);
+
+    FinDate getRefDate() const { return FinDate(refDate, true); }
+    FinEnum::Interpolation getInterpolation() const { return interp; }
+    FinEnum::DayCountConvention getDayCountConvention() const { return dc; }
+    int numPillars() const { return pillarDates.size(); }
+
+    /**
+     * Year fraction from the reference date (negative before it).
+     */
+    double time(int jdn) const;
+
+    double discount(FinDate date) const;
+    double discount(int jdn) const;
+
+    /**
+     * Instantaneous forward rate (continuously compounded).
+     */
+    double forward(int jdn) const;
+
+    /**
+     * Simply compounded forward rate from start to end with the year
+     * fraction of dc: (P(start)/P(end) - 1)/yearFrac(start, end, dc).
+     */
+    double forwardRate(int start, int end, FinEnum::DayCountConvention dc) const;
+
+    /**
+     * Batch lookups, fastest when dates is sorted. in and out must not
+     * overlap.
+     */
+    void discount(const int* dates, int n, double* out) const;
+    void forward(const int* dates, int n, double* out) const;
+    void forwardRate(const int* start, const int* end, int n,
+		     FinEnum::DayCountConvention dc, double* out) const;
+
+    std::vector<double> discount(const std::vector<int>& dates) const;
+    std::vector<double> forward(const std::vector<int>& dates) const;
+};
+
+} // end cxxPack namespace
+
+#endif
@@ -0,0 +1,135 @@
+// Expiry.hpp: expiration dates for listed futures and options
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef EXPIRY_HPP
+#define EXPIRY_HPP
+
+#include <string>
+#include <vector>
+
+#include <FinDate.hpp>
+#include <Calendar.hpp>
+
+namespace cxxPack {
+
+/**
+ * Rule giving the expiration date of the contract listed in a month: the
+ * nth occurrence of a weekday in the month (nth = -1 for the last one),
+ * moved by calendarDays days and then by businessDays business days
+ * (negative for earlier) in the named calendar. For example,
+ *
+ *   ExpiryRule("SPX", 3, Fri, 1)      // Saturday after the third Friday
+ *   ExpiryRule("IMM", 3, Wed, 0, -2)  // two business days before the
+ *                                     // third Wednesday
+ *
+ * Rules that do not fit this pattern can supply a function that returns
+ * the julian day number for a month and year.
+ */
+class ExpiryRule {
+public:
+    typedef int (*ExpiryFunction)(int month, int year);
+
+    ExpiryRule(std::string name_, int nth_, int weekday_,
+	       int calendarDays_ = 0, int businessDays_ = 0,
+	       std::string calendar_ = "WeekendsOnly")
+	: name(name_), nth(nth_), weekday(weekday_),
+	  calendarDays(calendarDays_), businessDays(businessDays_),
+	  calendar(calendar_), function(0) {}
+
+    ExpiryRule(std::string name_, ExpiryFunction function_)
+	: name(name_), nth(1), weekday(0), calendarDays(0), businessDays(0),
+	  calendar("WeekendsOnly"), function(function_) {}
+
+    std::string getName() const { return name; }
+
+    /**
+     * Julian day number of the expiration for the month and year.
+     */
+    int compute(int month, int year) const;
+
+private:
+    std::string name;
+    int nth, weekday, calendarDays, businessDays;
+    std::string calendar;
+    ExpiryFunction function;
+
+    int compute(int month, int year, const Calendar& cal) const;
+    friend class ExpiryTable;
+};
+
+/**
+ * Expiration dates for every month in [firstYear, lastYear], computed
+ * once, so expiry() is a single array lookup (months outside of the
+ * range are computed on demand).
+ *
+ * Tables can be registered by rule name. "SPX" (same as
+ * FinDate::spxDate()), "IMM" (same as FinDate::immDate()) and
+ * "ThirdFriday" are always available; other exchange rules can be
+ * added with add(). A table that uses a holiday calendar is built with
+ * the calendar registered at that time, so register calendars first.
+ */
+class ExpiryTable {
+    ExpiryRule rule;
+    int firstYear, lastYear;
+    std::vector<int> table; // index 12*(year-firstYear) + month-1
+
+public:
+    ExpiryTable(const ExpiryRule& rule,
+		int firstYear = Calendar::defaultFirstYear,
+		int lastYear = Calendar::defaultLastYear);
+
+    std::string getName() const { return rule.getName(); }
+
+    /**
+     * Julian day number of the expiration for the month and year.
+     */
+    int expiry(int month, int year) const {
+	if(month < 1 || month > 12)
+	    throw std::range_error("ExpiryTable::expiry: invalid month");
+	unsigned int index = 12*(year - firstYear) + month - 1;
+	if(year >= firstYear && index < table.size())
+	    return table[index];
+	return rule.compute(month, year);
+    }
+
+    FinDate expiryDate(int month, int year) const {
+	return FinDate(expiry(month, year), true);
+    }
+
+    /**
+     * First expiration on or after jdn (for example, the front month).
+     */
+    int nextExpiry(int jdn) const;
+
+    /**
+     * Write the expirations of the n consecutive monthly contracts that
+     * start with month/year to out (for example, to build a chain).
+     */
+    void expiries(int month, int year, int n, int* out) const;
+
+    /**
+     * Register (or replace) the table for rule.getName().
+     */
+    static const ExpiryTable& add(const ExpiryRule& rule,
+				  int firstYear = Calendar::defaultFirstYear,
+				  int lastYear = Calendar::defaultLastYear);
+
+    static const ExpiryTable& get(std::string name);
+};
+
+} // end cxxPack namespace
+
+#endif
@@ -17,6 +17,8 @@
 #ifndef FINDATE_HPP
 #define FINDATE_HPP
 
+#include <stdint.h>
+
 #include <Rcpp.h>
 
 #include <FinEnum.hpp>
@@ -31,6 +33,8 @@ namespace cxxPack {
     enum SerialType { None=0, R=1, Excel1900=2, Excel1904=3, QuantLib=4,
 		      IsdaCds=5, Julian=6 };
 
+    class Calendar; // see Calendar.hpp
+
 // Return value from jul2mdy()
 class DateMDY {
 public:
@@ -41,29 +45,60 @@ public:
 
 /**
  * Date class that models R's Date class with a number of enhancements
- * designed to faciliate work in finance. The underlying real representation
- * holds the number of seconds since 1/1/1970 with 1-day resolution. For 
- * finer resolution use RcppDatetime.
+ * designed to faciliate work in finance. The underlying representation
+ * is the julian day number with 1-day resolution, so a FinDate is just
+ * an int: it is trivially copyable and has no hidden mutable state, so
+ * const FinDate's (and vectors of them) can be read from several threads.
+ * For finer resolution use RcppDatetime.
  */
 class FinDate {
 
 protected:
 
-    // These are safe non-public methods so we take some liberties here.
-    void mdy2jdn(), jdn2mdy() const;
     int jdn; // Julian day number
-    mutable int month, day, year;
-    bool parsed;
 
     static const int daysInMonthTable[2][13]; // 0=no-leap, 1=leap; 1<=month<=12.
+
+    // Optional m/d/y lookup table, see useDateTable(). Entries are packed
+    // as (year << 9) | (month << 5) | day.
+    static uint32_t* dateTable;
+    static unsigned int dateTableSize; // zero when the table is not used.
 public:
 
     static const int DAYS2SECS, R_Offset, 
 	             Excel1900_Offset, Excel1904_Offset, IsdaCds_Offset;
+    static const int dateTableFirstYear, dateTableLastYear;
     static int mdy2jdn(int month, int day, int year); // julian from mdy
-    static DateMDY jdn2mdy(int jdn);
-    static const std::string weekdayName[];
-    static const std::string monthName[];
+
+    /**
+     * Transform from Julian day number to month/day/year. When the date
+     * table is enabled dates in [dateTableFirstYear, dateTableLastYear]
+     * are decomposed with a single table lookup.
+     */
+    static DateMDY jdn2mdy(int jdn) {
+	unsigned int off = (unsigned int)jdn - (unsigned int)dateTableFirstJdn;
+	if(off < dateTableSize) {
+	    uint32_t packed = dateTable[off];
+	    return DateMDY((packed >> 5) & 15, packed & 31, (int)(packed >> 9));
+	}
+	return civilFromJdn(jdn);
+    }
+
+    /**
+     * Arithmetic version of jdn2mdy() (no table).
+     */
+    static DateMDY civilFromJdn(int jdn);
+
+    /**
+     * Build (flag = true) or release the date table used by jdn2mdy().
+     * The table takes about 440K. This is not thread-safe: call it
+     * before dates are decomposed from several threads.
+     */
+    static void useDateTable(bool flag);
+    static bool usingDateTable() { return dateTableSize > 0; }
+    static const int dateTableFirstJdn = 2415021; // JDN(1/1/1900)
+    static const char* const weekdayName[];
+    static const char* const monthName[];
     static const int serialOffsets[];
 
     /**
@@ -82,7 +117,6 @@ public:
      * Construct from an R Date serial number or a julian day number (JDN).
      */
     FinDate(int serialNum, bool isJDN = false) {
-	parsed = false;
 	if(isJDN) {
 	    jdn = serialNum;
 	}
@@ -95,47 +129,34 @@ public:
      * Prevent m/d/y and d/m/y confusion by requiring that the first
      * parameter to this constructor be of type cxxPack::Month.
      */
-    FinDate(Month month_, int day_, int year_) {
-	parsed = true;
-	day = day_;
-	month = month_;
-	year = year_;
+    FinDate(Month month, int day, int year) {
 	if(month < 1 || month > 12 || day < 1 || day > 31)
 	    throw std::range_error("FinDate: invalid date");
 	jdn = mdy2jdn(month, day, year);
     }
 
     FinDate() {
-	parsed = false;
 	jdn = mdy2jdn(1,1,1970);
     }
 
     operator SEXP();
 
-    int getMonth() const { if(!parsed) jdn2mdy(); return month; }
-    int getDay()   const { if(!parsed) jdn2mdy(); return day; }
-    int getYear()  const { if(!parsed) jdn2mdy(); return year; }
+    /**
+     * Month, day and year in one conversion. Use this instead of
+     * getMonth(), getDay() and getYear() when more than one is needed.
+     */
+    DateMDY getMDY() const { return jdn2mdy(jdn); }
+
+    int getMonth() const { return jdn2mdy(jdn).month; }
+    int getDay()   const { return jdn2mdy(jdn).day; }
+    int getYear()  const { return jdn2mdy(jdn).year; }
     std::string getWeekdayName() const;
     std::string getMonthName() const;
 
-    static double divisor(FinEnum::DayCountConvention dc) {
-	switch(dc) {
-	case FinEnum::DCA360:
-	case FinEnum::DC30360I:
-	case FinEnum::DC30360E:
-	case FinEnum::DC30360P1:
-	case FinEnum::DC30360P2:
-	case FinEnum::DCA360NL:
-	    return 360.0;
-	case FinEnum::DCA365:
-	case FinEnum::DCA365NL:
-	    return 365.0;
-	case FinEnum::DCA252:
-	    return 252.0;
-	default:
-	    return 1.0;
-	}
-    }
+    /**
+     * Days per year for yearFrac() (1 for ACT/ACT).
+     */
+    static double divisor(FinEnum::DayCountConvention dc);
 
     friend bool     operator<(const FinDate &date1, const FinDate& date2);
     friend bool     operator>(const FinDate &date1, const FinDate& date2);
@@ -173,6 +194,14 @@ public:
      */
     FinDate nthWeekday(int n, int dayNum) const;
 
+    /**
+     * Same as nthWeekday() for the specified month and year, returning a
+     * julian day number (no loops). The result is not checked against the
+     * end of the month: n = 5 gives a date in the following month when
+     * the month has only four of the weekday.
+     */
+    static int nthWeekday(int n, int dayNum, int month, int year);
+
     /**
      * Is this date in a leap year?
      */
@@ -181,7 +210,9 @@ public:
     /**
      * Is the specified year a leap year?
      */
-    static bool isLeapYear(int year);
+    static bool isLeapYear(int year) {
+	return (year%4 == 0 && year%100 != 0) || year%400 == 0;
+    }
 
     /**
      * How many days are in the specified month and year?
@@ -208,11 +239,45 @@ public:
 			   FinEnum::DayCountConvention dc, 
 			   int extraDays);
 
+    /**
+     * BUS/252 (DCB252) counts business days in cal. Without a calendar
+     * (above) only weekends are excluded. Other conventions ignore cal.
+     */
+    static int diffDays(FinDate date1, FinDate date2,
+			FinEnum::DayCountConvention dc, const Calendar& cal);
+
+    static double yearFrac(FinDate date1, FinDate date2,
+			   FinEnum::DayCountConvention dc, const Calendar& cal,
+			   int extraDays = 0);
+
     FinDate addMonths(int n, bool adjustEOM) const;
     bool isBusDay() const; // no holiday calendar support
     FinDate nextBusDay() const;
     FinDate prevBusDay() const;
     FinDate modNextBusDay() const;
+
+    // Business day calculations using a holiday calendar.
+    bool isBusDay(const Calendar& cal) const;
+    FinDate nextBusDay(const Calendar& cal) const;
+    FinDate prevBusDay(const Calendar& cal) const;
+    FinDate modNextBusDay(const Calendar& cal) const;
+
+    /**
+     * Roll to a business day (see Calendar::adjust()), and move n
+     * business days, for example, trade.addBusDays(2, cal) for T+2
+     * settlement (see Calendar::advance()). For arrays of dates use the
+     * batch versions in Calendar.
+     */
+    FinDate adjust(const Calendar& cal, FinEnum::BusDayConvention conv) const;
+    FinDate addBusDays(int n, const Calendar& cal) const;
+    FinDate immDate(const Calendar& cal) const;
+
+    /**
+     * Number of business days from date1 (included) to date2 (excluded).
+     */
+    static int busDaysBetween(FinDate date1, FinDate date2,
+			      const Calendar& cal);
+
     FinDate spxDate() const;
     FinDate immDate() const;
 
@@ -251,6 +316,31 @@ public:
     double serialNumber(RcppDate&, cxxPack::SerialType);
     double serialNumber(RcppDatetime&, cxxPack::SerialType);
 
+    /**
+     * Batch conversion of serial numbers (in days) between serial types:
+     * out[i] = in[i] + offset(from) - offset(to), computed in that order
+     * so that the result matches the R function serialNumber(). in and
+     * out may be the same array.
+     */
+    void serialNumberConvert(const double* in, int n, cxxPack::SerialType from,
+			     cxxPack::SerialType to, double* out);
+    void serialNumberConvert(const int* in, int n, cxxPack::SerialType from,
+			     cxxPack::SerialType to, int* out);
+
+    /**
+     * Batch conversion of POSIXct/RcppDatetime seconds to serial numbers
+     * of the given type, measured in days (with a fractional part) for
+     * every type, including R (as the R function serialNumber() does).
+     */
+    void serialNumberFromSeconds(const double* secs, int n,
+				 cxxPack::SerialType to, double* out);
+
+    /**
+     * Serial type for its name ("R", "Excel1900", "Excel1904",
+     * "QuantLib", "IsdaCds", "Julian").
+     */
+    cxxPack::SerialType serialTypeFor(const std::string& name);
+
 } // end cxxPack namespace
 
 namespace Rcpp {
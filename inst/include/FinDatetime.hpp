@@ -0,0 +1,228 @@
+// FinDatetime.hpp: nanosecond resolution datetimes
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FINDATETIME_HPP
+#define FINDATETIME_HPP
+
+#include <stdint.h>
+#include <ostream>
+
+#include <Rcpp.h>
+
+#include <FinDate.hpp>
+
+namespace cxxPack {
+
+/**
+ * Datetime stored as a 64-bit count of nanoseconds since
+ * 1970-01-01 00:00:00 UTC (about +/- 292 years). Unlike RcppDatetime
+ * (fractional seconds in a double) the resolution does not depend on
+ * the distance from the epoch, and differences and comparisons are
+ * exact, which is what tick data needs. Like FinDate it is just a number,
+ * so vectors of them are compact and can be shared between threads.
+ *
+ * R has no nanosecond type: on the R side a FinDatetime is a POSIXct
+ * (seconds in a double), so values that pass through R are rounded to
+ * what a double can hold (about a microsecond for current dates).
+ *
+ * NA (NA_real_ or NaN seconds in R) is held as NA_NANOS, and converted
+ * back to NA_real_. It compares less than every other datetime, but it
+ * has no date or time of day, and arithmetic on it is undefined.
+ */
+class FinDatetime {
+
+    int64_t nanos; // nanoseconds since the epoch
+
+    // Floor division for negative (pre-1970) times.
+    static int64_t floorDiv(int64_t a, int64_t b) {
+	int64_t q = a / b;
+	return (a % b < 0) ? q - 1 : q;
+    }
+
+public:
+
+    static const int64_t NANOS_PER_SEC, NANOS_PER_DAY;
+
+    /**
+     * Nanoseconds of NA, the smallest int64_t (outside the range of
+     * secondsToNanos()).
+     */
+    static const int64_t NA_NANOS;
+
+    /**
+     * The epoch, 1970-01-01 00:00:00 UTC.
+     */
+    FinDatetime() : nanos(0) {}
+
+    /**
+     * From a POSIXct (the first element is used, and may be NA).
+     */
+    FinDatetime(SEXP);
+
+    FinDatetime(const RcppDatetime& datetime);
+
+    /**
+     * Midnight UTC at the start of date, plus the specified time of day.
+     */
+    FinDatetime(const FinDate& date, int hour = 0, int minute = 0,
+		int second = 0, int nanosecond = 0);
+
+    /**
+     * From seconds since the epoch (POSIXct, RcppDatetime), rounded to
+     * the nearest nanosecond. NA or NaN seconds give NA.
+     */
+    static FinDatetime fromSeconds(double secs) {
+	FinDatetime datetime;
+	datetime.nanos = ISNAN(secs) ? NA_NANOS : secondsToNanos(secs);
+	return datetime;
+    }
+
+    static FinDatetime fromNanos(int64_t nanos_) {
+	FinDatetime datetime;
+	datetime.nanos = nanos_;
+	return datetime;
+    }
+
+    static FinDatetime NA() { return fromNanos(NA_NANOS); }
+
+    /**
+     * Throws if secs is NaN or more than about 292 years from the epoch.
+     */
+    static int64_t secondsToNanos(double secs);
+
+    operator SEXP() const;
+
+    /**
+     * Nanoseconds since the epoch.
+     */
+    int64_t getNanos() const { return nanos; }
+
+    bool isNA() const { return nanos == NA_NANOS; }
+
+    /**
+     * Seconds since the epoch, the value used by POSIXct (NA_REAL for
+     * NA).
+     */
+    double getSeconds() const {
+	if(isNA())
+	    return NA_REAL;
+	int64_t whole = floorDiv(nanos, NANOS_PER_SEC);
+	return (double)whole + (double)(nanos - whole*NANOS_PER_SEC)/1.0e9;
+    }
+
+    /**
+     * The (UTC) date.
+     */
+    FinDate getFinDate() const {
+	return FinDate(julianDay(), true);
+    }
+
+    int julianDay() const {
+	return (int)floorDiv(nanos, NANOS_PER_DAY) + FinDate::R_Offset;
+    }
+
+    /**
+     * Nanoseconds since midnight UTC.
+     */
+    int64_t getTimeOfDay() const {
+	return nanos - floorDiv(nanos, NANOS_PER_DAY)*NANOS_PER_DAY;
+    }
+
+    int getHour() const { return (int)(getTimeOfDay()/(3600*NANOS_PER_SEC)); }
+    int getMinute() const {
+	return (int)(getTimeOfDay()/(60*NANOS_PER_SEC) % 60);
+    }
+    int getSecond() const {
+	return (int)(getTimeOfDay()/NANOS_PER_SEC % 60);
+    }
+    int getNanosecond() const { return (int)(getTimeOfDay() % NANOS_PER_SEC); }
+
+    FinDatetime& addNanos(int64_t n) { nanos += n; return *this; }
+
+    /**
+     * Shift by secs seconds (rounded to nanoseconds), like
+     * RcppDatetime + secs.
+     */
+    friend FinDatetime operator+(const FinDatetime& datetime, double secs) {
+	return fromNanos(datetime.nanos + secondsToNanos(secs));
+    }
+    FinDatetime& operator+=(double secs) {
+	nanos += secondsToNanos(secs);
+	return *this;
+    }
+
+    /**
+     * dt1 - dt2 in seconds (see diffNanos() for the exact difference).
+     */
+    friend double operator-(const FinDatetime& dt1, const FinDatetime& dt2) {
+	return (double)(dt1.nanos - dt2.nanos)*1.0e-9;
+    }
+
+    /**
+     * dt1 - dt2 in nanoseconds, with the sign of operator-.
+     */
+    static int64_t diffNanos(const FinDatetime& dt1, const FinDatetime& dt2) {
+	return dt1.nanos - dt2.nanos;
+    }
+
+    friend bool operator<(const FinDatetime& dt1, const FinDatetime& dt2) {
+	return dt1.nanos < dt2.nanos;
+    }
+    friend bool operator>(const FinDatetime& dt1, const FinDatetime& dt2) {
+	return dt1.nanos > dt2.nanos;
+    }
+    friend bool operator<=(const FinDatetime& dt1, const FinDatetime& dt2) {
+	return dt1.nanos <= dt2.nanos;
+    }
+    friend bool operator>=(const FinDatetime& dt1, const FinDatetime& dt2) {
+	return dt1.nanos >= dt2.nanos;
+    }
+    friend bool operator==(const FinDatetime& dt1, const FinDatetime& dt2) {
+	return dt1.nanos == dt2.nanos;
+    }
+    friend bool operator!=(const FinDatetime& dt1, const FinDatetime& dt2) {
+	return dt1.nanos != dt2.nanos;
+    }
+
+    /**
+     * Batch conversions between POSIXct seconds, FinDatetime's and julian
+     * day numbers. in and out must not overlap. NA converts to and from
+     * NA_REAL, and toJulianDays() throws on NA.
+     */
+    static void fromSeconds(const double* secs, int n, FinDatetime* out);
+    static void toSeconds(const FinDatetime* datetimes, int n, double* out);
+    static void toJulianDays(const FinDatetime* datetimes, int n, int* out);
+
+    /**
+     * Written in UTC as 2010-12-24 15:30:00.123456789, or NA.
+     */
+    friend std::ostream& operator<<(std::ostream& os,
+				    const FinDatetime& datetime);
+};
+
+    std::string to_string(const FinDatetime& datetime);
+
+} // end cxxPack namespace
+
+namespace Rcpp {
+
+    // Work-aruond for the fact that Rcpp::wrap(obj) does not work when
+    // obj is an object of a class that has operator SEXP().
+    template<> SEXP wrap<cxxPack::FinDatetime>(const cxxPack::FinDatetime& x);
+
+}
+
+#endif
@@ -18,6 +18,7 @@
 #define FinEnum_Include
 
 #include <string>
+#include <cstddef>
 
 namespace cxxPack {
 
@@ -32,44 +33,105 @@ public:
     };
     enum DayCountConvention {
 	DCAA, DCA360, DCA365, DCA252,
-	DC30360I, DC30360E, DC30360P1, DC30360P2, DCA360NL, DCA365NL
+	DC30360I, DC30360E, DC30360P1, DC30360P2, DCA360NL, DCA365NL,
+	DCB252
     };
     enum MonthEndAdjustment { NoAdj, AdjustIfEOM };
     enum AccrualConvention { Standard, YearFraction, YearFractionPlus1 };
     enum CashFlowType {  FX, SETTLE, COUPON, PRINCIPAL, OTHER };
     enum CalcMode { FixedPrice, FixedYield };
+    enum BusDayConvention {
+	Unadjusted, Following, ModFollowing, Preceding, ModPreceding,
+	EndOfMonth
+    };
+    enum Interpolation { LogLinear, MonotoneConvex, CubicSpline };
 
     FinEnum() {}
 
+    /**
+     * Name table entry. The tables are arrays of string literals with
+     * their lengths, so they need no construction when the library is
+     * loaded. The _for() lookups hash the string to the one name it can
+     * match and compare against that name only. The _for() functions
+     * that take a pointer and a length do not allocate, and do not need
+     * a null terminated string.
+     */
+    struct Name {
+	const char* str;
+	std::size_t length;
+    };
+
     static std::string BondFeature_str(BondFeature t);
-    static BondFeature BondFeature_for(std::string s);
-    static std::string BondFeatureStr[];
-    static int numBondFeature;
+    static const char* BondFeature_name(BondFeature t);
+    static BondFeature BondFeature_for(const char* s, std::size_t len);
+    static BondFeature BondFeature_for(const std::string& s) {
+	return BondFeature_for(s.data(), s.size());
+    }
+    static const Name BondFeatureStr[];
+    static const int numBondFeature;
 
     static std::string DayCountConvention_str(DayCountConvention t);
-    static DayCountConvention DayCountConvention_for(std::string s);
-    static std::string DayCountConventionStr[];
-    static int numDayCountConvention;
+    static const char* DayCountConvention_name(DayCountConvention t);
+    static DayCountConvention DayCountConvention_for(const char* s, std::size_t len);
+    static DayCountConvention DayCountConvention_for(const std::string& s) {
+	return DayCountConvention_for(s.data(), s.size());
+    }
+    static const Name DayCountConventionStr[];
+    static const int numDayCountConvention;
 
     static std::string MonthEndAdjustment_str(MonthEndAdjustment t);
-    static MonthEndAdjustment MonthEndAdjustment_for(std::string s);
-    static std::string MonthEndAdjustmentStr[];
-    static int numMonthEndAdjustment;
+    static const char* MonthEndAdjustment_name(MonthEndAdjustment t);
+    static MonthEndAdjustment MonthEndAdjustment_for(const char* s, std::size_t len);
+    static MonthEndAdjustment MonthEndAdjustment_for(const std::string& s) {
+	return MonthEndAdjustment_for(s.data(), s.size());
+    }
+    static const Name MonthEndAdjustmentStr[];
+    static const int numMonthEndAdjustment;
 
     static std::string AccrualConvention_str(AccrualConvention t);
-    static AccrualConvention AccrualConvention_for(std::string s);
-    static std::string AccrualConventionStr[];
-    static int numAccrualConvention;
+    static const char* AccrualConvention_name(AccrualConvention t);
+    static AccrualConvention AccrualConvention_for(const char* s, std::size_t len);
+    static AccrualConvention AccrualConvention_for(const std::string& s) {
+	return AccrualConvention_for(s.data(), s.size());
+    }
+    static const Name AccrualConventionStr[];
+    static const int numAccrualConvention;
 
     static std::string CashFlowType_str(CashFlowType t);
-    static CashFlowType CashFlowType_for(std::string s);
-    static std::string CashFlowTypeStr[];
-    static int numCashFlowType;
+    static const char* CashFlowType_name(CashFlowType t);
+    static CashFlowType CashFlowType_for(const char* s, std::size_t len);
+    static CashFlowType CashFlowType_for(const std::string& s) {
+	return CashFlowType_for(s.data(), s.size());
+    }
+    static const Name CashFlowTypeStr[];
+    static const int numCashFlowType;
 
     static std::string CalcMode_str(CalcMode t);
-    static CalcMode CalcMode_for(std::string s);
-    static std::string CalcModeStr[];
-    static int numCalcMode;
+    static const char* CalcMode_name(CalcMode t);
+    static CalcMode CalcMode_for(const char* s, std::size_t len);
+    static CalcMode CalcMode_for(const std::string& s) {
+	return CalcMode_for(s.data(), s.size());
+    }
+    static const Name CalcModeStr[];
+    static const int numCalcMode;
+
+    static std::string BusDayConvention_str(BusDayConvention t);
+    static const char* BusDayConvention_name(BusDayConvention t);
+    static BusDayConvention BusDayConvention_for(const char* s, std::size_t len);
+    static BusDayConvention BusDayConvention_for(const std::string& s) {
+	return BusDayConvention_for(s.data(), s.size());
+    }
+    static const Name BusDayConventionStr[];
+    static const int numBusDayConvention;
+
+    static std::string Interpolation_str(Interpolation t);
+    static const char* Interpolation_name(Interpolation t);
+    static Interpolation Interpolation_for(const char* s, std::size_t len);
+    static Interpolation Interpolation_for(const std::string& s) {
+	return Interpolation_for(s.data(), s.size());
+    }
+    static const Name InterpolationStr[];
+    static const int numInterpolation;
 };
 
 } // end cxxPack namespace
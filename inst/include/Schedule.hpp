@@ -0,0 +1,113 @@
+// Schedule.hpp: coupon schedule generation
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SCHEDULE_HPP
+#define SCHEDULE_HPP
+
+#include <vector>
+
+#include <FinEnum.hpp>
+#include <FinDate.hpp>
+#include <Calendar.hpp>
+
+namespace cxxPack {
+
+/**
+ * Coupon (payment) schedule from effective to maturity with frequency
+ * payments per year (1, 2, 3, 4, 6 or 12). The regular dates are
+ * computed with FinDate::addMonths() from a single anchor date, so the
+ * day of month does not drift (a schedule anchored on the 31st returns to
+ * the 31st after a short month):
+ *
+ * - MaturityAnchor, OddFirst (and NoFeature): dates are counted back
+ *   from maturity, so any odd (short) period is the first one.
+ * - OddLast: dates are counted forward from effective, so any odd period
+ *   is the last one.
+ * - OddBoth needs a separate anchor date and is not supported.
+ *
+ * With AdjustIfEOM an anchor on the last day of a month gives dates on
+ * the last day of each month. Each date is then rolled to a business day
+ * in the calendar using the roll convention, and the accrual fraction of
+ * each period is computed from the adjusted dates with the day count
+ * convention. A stub so short that both of its ends roll to the same
+ * business day is merged into the neighboring period.
+ *
+ * numDates() is known when the Schedule is constructed, so the output of
+ * generate() can be allocated once and reused across many schedules.
+ * The calendar must outlive the Schedule.
+ */
+class Schedule {
+    int effective, maturity; // julian day numbers
+    int months; // months per period
+    bool forward; // counting forward from effective (OddLast)?
+    bool adjustEOM;
+    FinEnum::BusDayConvention roll;
+    FinEnum::DayCountConvention dc;
+    const Calendar* cal;
+    int numRegular; // regular dates strictly between effective and maturity
+
+    int regularDate(int k) const; // k-th date counted from the anchor
+    void countRegular();
+
+public:
+    Schedule(FinDate effective, FinDate maturity, int frequency,
+	     FinEnum::BondFeature feature = FinEnum::MaturityAnchor,
+	     FinEnum::MonthEndAdjustment eomAdj = FinEnum::NoAdj,
+	     FinEnum::BusDayConvention roll = FinEnum::Following,
+	     FinEnum::DayCountConvention dc = FinEnum::DC30360I,
+	     const Calendar& cal = Calendar::get("WeekendsOnly"));
+
+    /**
+     * Number of dates, including effective and maturity.
+     */
+    int numDates() const { return numRegular + 2; }
+
+    int numPeriods() const { return numRegular + 1; }
+
+    int getFrequency() const { return 12/months; }
+    FinEnum::DayCountConvention getDayCountConvention() const { return dc; }
+    const Calendar& getCalendar() const { return *cal; }
+
+    /**
+     * Write the unadjusted and adjusted dates (julian day numbers,
+     * numDates() of each) and the accrual fraction of each period
+     * (numPeriods()) to the arrays provided. Returns numDates().
+     */
+    int generate(int* unadjusted, int* adjusted, double* accrual) const;
+
+    void generate(std::vector<int>& unadjusted, std::vector<int>& adjusted,
+		  std::vector<double>& accrual) const;
+
+    /**
+     * The regular (unadjusted) period counted from the anchor that each
+     * period is part of, numPeriods() of each. It differs from the period
+     * only for a short (or merged) first or last period, and is used to
+     * prorate the coupons of those periods.
+     */
+    void referencePeriods(int* start, int* end) const;
+
+    /**
+     * The fraction of a regular coupon that each period pays
+     * (numPeriods()): the day count of the period divided by that of its
+     * reference period, from the unadjusted dates. It is 1 for regular
+     * periods, less for a short stub and more for a merged (long) one.
+     */
+    void couponFractions(double* frac) const;
+};
+
+} // end cxxPack namespace
+
+#endif
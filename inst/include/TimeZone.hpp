@@ -0,0 +1,177 @@
+// TimeZone.hpp: conversion between UTC and local time
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef TIMEZONE_HPP
+#define TIMEZONE_HPP
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <FinDate.hpp>
+#include <FinDatetime.hpp>
+#include <Calendar.hpp>
+
+namespace cxxPack {
+
+/**
+ * Time zone built from a compiled tz database (zoneinfo) file, for
+ * converting UTC timestamps (RcppDatetime, POSIXct, FinDatetime) to
+ * local time and back without going through R's as.POSIXlt().
+ *
+ * The file is read once into a table of UTC offset transitions. The
+ * rule at the end of the file (a POSIX TZ string such as
+ * EST5EDT,M3.2.0,M11.1.0) is expanded into explicit transitions through
+ * lastYear, and the first transition of each year in [firstYear,
+ * lastYear] is indexed, so a conversion finds its year arithmetically
+ * and scans the (at most a few) transitions of that year. The batch
+ * conversions also remember the last offset interval, so sorted tick
+ * data seldom looks at the table at all. Outside of [firstYear,
+ * lastYear] the transitions are binary searched.
+ *
+ * Local times are represented like UTC times (seconds or nanoseconds
+ * since 1970-01-01 00:00:00), so that FinDatetime::getFinDate(),
+ * getHour(), etc., of a local time give the local date and time of day.
+ *
+ * A local time that occurs twice (when clocks are set back) is mapped
+ * to the earlier UTC time, and a local time that is skipped (when
+ * clocks are set forward) is moved forward by the length of the gap,
+ * as mktime() does for standard time.
+ *
+ * Time zones are registered by name like calendars: get("America/New_York")
+ * loads the file from the zoneinfo directory ($TZDIR, or the usual
+ * system locations) on first use. "UTC" is always available. Load time
+ * zones before converting from several threads; the conversions
+ * themselves are const and can run concurrently.
+ */
+class TimeZone {
+
+    std::string name;
+    int firstYear, lastYear;
+
+    // Local time types (UTC offset in seconds, DST flag, abbreviation).
+    std::vector<int> typeOffset;
+    std::vector<bool> typeDst;
+    std::vector<std::string> typeAbbrev;
+    int initialType; // type in effect before the first transition
+
+    std::vector<int64_t> transitions; // UTC seconds, increasing
+    std::vector<int> transitionType;  // type in effect from transition i
+
+    std::vector<int64_t> yearStart; // UTC seconds at 1/1 of each year
+    std::vector<int> yearInterval;  // interval that contains yearStart
+
+    // Offset interval k is [transitions[k-1], transitions[k]).
+    int intervalType(int k) const {
+	return k == 0 ? initialType : transitionType[k-1];
+    }
+    int intervalOffset(int k) const { return typeOffset[intervalType(k)]; }
+    double intervalStart(int k) const; // -HUGE_VAL for k == 0
+    double intervalEnd(int k) const;   // HUGE_VAL for the last interval
+
+    template<typename T> void batchToLocal(const T* in, int n, T* out) const;
+    template<typename T> void batchToUTC(const T* in, int n, T* out) const;
+
+    void readTZif(const std::string& fileName);
+    void expandRule(const std::string& rule);
+    int findType(int offset, bool isDst, const std::string& abbrev);
+    void buildIndex();
+
+public:
+
+    /**
+     * UTC (no transitions).
+     */
+    TimeZone(std::string name_ = "UTC",
+	     int firstYear_ = Calendar::defaultFirstYear,
+	     int lastYear_ = Calendar::defaultLastYear);
+
+    /**
+     * Read a compiled zoneinfo (TZif) file, versions 1 to 3.
+     */
+    TimeZone(std::string name_, std::string fileName,
+	     int firstYear_ = Calendar::defaultFirstYear,
+	     int lastYear_ = Calendar::defaultLastYear);
+
+    std::string getName() const { return name; }
+    int numTransitions() const { return transitions.size(); }
+
+    /**
+     * Index of the offset interval that contains utcSecs.
+     */
+    int interval(int64_t utcSecs) const;
+
+    /**
+     * Offset from UTC (local - UTC, in seconds) at utcSecs.
+     */
+    int utcOffset(int64_t utcSecs) const {
+	return typeOffset[intervalType(interval(utcSecs))];
+    }
+    bool isDst(int64_t utcSecs) const {
+	return typeDst[intervalType(interval(utcSecs))];
+    }
+    std::string abbreviation(int64_t utcSecs) const {
+	return typeAbbrev[intervalType(interval(utcSecs))];
+    }
+
+    /**
+     * Offset from UTC in effect at the local time localSecs (see the
+     * class comment for repeated and skipped local times).
+     */
+    int localOffset(int64_t localSecs) const;
+
+    /**
+     * Conversions for POSIXct/RcppDatetime seconds.
+     */
+    double toLocal(double utcSecs) const;
+    double toUTC(double localSecs) const;
+
+    FinDatetime toLocal(const FinDatetime& utc) const;
+    FinDatetime toUTC(const FinDatetime& local) const;
+
+    /**
+     * Batch conversions (in and out may be the same array).
+     */
+    void toLocal(const double* utcSecs, int n, double* out) const;
+    void toUTC(const double* localSecs, int n, double* out) const;
+    void toLocal(const FinDatetime* utc, int n, FinDatetime* out) const;
+    void toUTC(const FinDatetime* local, int n, FinDatetime* out) const;
+
+    /**
+     * Register a copy of tz under tz.getName(), replacing any time zone
+     * with the same name. Returns the registered copy.
+     */
+    static const TimeZone& add(const TimeZone& tz);
+
+    /**
+     * Read fileName and register the result under name.
+     */
+    static const TimeZone& load(std::string name, std::string fileName,
+				int firstYear = Calendar::defaultFirstYear,
+				int lastYear = Calendar::defaultLastYear);
+
+    /**
+     * Fetch a registered time zone, loading name (for example,
+     * "America/New_York" or "Europe/London") from the zoneinfo directory
+     * if it has not been registered.
+     */
+    static const TimeZone& get(std::string name);
+    static bool has(std::string name);
+};
+
+} // end cxxPack namespace
+
+#endif
@@ -22,6 +22,7 @@
 
 #include <Rcpp.h>
 #include <FinDate.hpp>
+#include <FinDatetime.hpp>
 #include <ZooSeries.hpp>
 
 namespace cxxPack {
@@ -29,7 +30,7 @@ namespace cxxPack {
 /**
  * Models an R zoo time series object with an ordered but not necessarily
  * equally spaced index. The index can be integer, double, FinDate,
- * RcppDate, or RcppDatetime. The data part can be a vector or a 2D matrix.
+ * RcppDate, RcppDatetime, or FinDatetime (nanoseconds, for tick data). The data part can be a vector or a 2D matrix.
  * Permits the user to modify the structure, so it may become unsorted.
  * The operator SEXP() function has been designed to sort on the index 
  * before returning
@@ -55,6 +56,7 @@ class ZooSeries {
     std::vector<FinDate> indFinDate;
     std::vector<RcppDate> indRcppDate;
     std::vector<RcppDatetime> indRcppDatetime;
+    std::vector<FinDatetime> indFinDatetime;
 
     // Data types supported: only double for now.
     std::vector<double> dataVec;
@@ -62,7 +64,7 @@ class ZooSeries {
     int indexType_;
     double frequency_;
     bool isMatrix_, isRegular_;
-    static bool useRcppDate_;
+    static bool useRcppDate_, useFinDatetime_;
 
     int nrows, ncols;
 
@@ -71,11 +73,15 @@ class ZooSeries {
     }
 public:
     enum IndexType { IND_INTEGER, IND_DOUBLE, IND_FINDATE, 
-		     IND_RCPPDATE, IND_RCPPDATETIME };
+		     IND_RCPPDATE, IND_RCPPDATETIME, IND_FINDATETIME };
 
     // Use this to map from R Date to RcppDate instead of FinDate.
     static void useRcppDate(bool flag) { useRcppDate_ = flag; }
 
+    // Use this to map from R POSIXct to FinDatetime instead of RcppDatetime
+    // (NA maps to FinDatetime::NA(), which sorts first, and back to NA).
+    static void useFinDatetime(bool flag) { useFinDatetime_ = flag; }
+
     // Constructor from R object.
     ZooSeries(SEXP zoosexp);
 
@@ -90,6 +96,8 @@ public:
 	    double freq=0);
     ZooSeries(std::vector<double>& data, std::vector<RcppDatetime>& index, 
 	    double freq=0);
+    ZooSeries(std::vector<double>& data, std::vector<FinDatetime>& index, 
+	    double freq=0);
     ZooSeries(std::vector<std::vector<double> >& data, std::vector<int>& index, 
 	    double freq=0);
     ZooSeries(std::vector<std::vector<double> >& data, std::vector<double>& index, 
@@ -97,6 +105,7 @@ public:
     ZooSeries(std::vector<std::vector<double> >& data, std::vector<FinDate>& index,double freq=0);
     ZooSeries(std::vector<std::vector<double> >& data, std::vector<RcppDate>& index,double freq=0);
     ZooSeries(std::vector<std::vector<double> >& data, std::vector<RcppDatetime>& index,double freq=0);
+    ZooSeries(std::vector<std::vector<double> >& data, std::vector<FinDatetime>& index,double freq=0);
 
     operator SEXP();
 
@@ -128,6 +137,10 @@ public:
 	if(indexType_ != IND_RCPPDATETIME) lookupError("indexRcppDatetime");
 	return indRcppDatetime[i]; 
     }
+    inline FinDatetime& indexFinDatetime(int i) { 
+	if(indexType_ != IND_FINDATETIME) lookupError("indexFinDatetime");
+	return indFinDatetime[i]; 
+    }
 
     inline double& operator()(int i) { 
 	if(isMatrix_)
@@ -158,6 +171,7 @@ public:
     std::vector<FinDate>& getIndFinDate() { return indFinDate; }
     std::vector<RcppDate>& getIndRcppDate() { return indRcppDate; }
     std::vector<RcppDatetime>& getIndRcppDatetime() { return indRcppDatetime; }
+    std::vector<FinDatetime>& getIndFinDatetime() { return indFinDatetime; }
 
     void print();
 };
@@ -26,7 +26,19 @@
 #include <cxxUtils.hpp>
 #include <FinEnum.hpp>
 #include <FinDate.hpp>
+#include <FinDatetime.hpp>
+#include <Calendar.hpp>
+#include <DayCount.hpp>
+#include <DateIO.hpp>
+#include <Schedule.hpp>
+#include <Accrual.hpp>
+#include <Bond.hpp>
+#include <DiscountCurve.hpp>
+#include <Bootstrap.hpp>
+#include <Expiry.hpp>
+#include <TimeZone.hpp>
 #include <DataFrame.hpp>
+#include <DataFrameView.hpp>
 #include <Factor.hpp>
 #include <ZooSeries.hpp>
 #include <optimize.hpp>
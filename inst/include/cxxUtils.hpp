@@ -37,6 +37,11 @@ std::string to_string(const T& obj) {
     return ss.str();
 }
 
+class FinDate;
+
+// Same result as the template, formatted without a stream (see DateIO).
+std::string to_string(const FinDate& date);
+
 
 // Using the following functions to get the dimensions of an R vector
 // or matrix is deprecated because this is available more naturally
@@ -50,7 +55,7 @@ void setRDims(SEXP s, std::vector<int>& dims);
 
 namespace Rcpp {
 
-    extern std::string datetimeClass[];
+    extern const char* const datetimeClass[];
 
     // Wraps for some of the "Classic API" types.
     template<> SEXP wrap<RcppDate>(const RcppDate&);
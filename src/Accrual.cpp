@@ -0,0 +1,308 @@
+// Accrual.cpp: accrued interest over portfolios of coupon schedules
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <Accrual.hpp>
+#include <Bond.hpp>
+#include <DayCount.hpp>
+
+namespace cxxPack {
+
+// Instruments with at least this many valuation dates in total are
+// processed in parallel (when compiled with OpenMP).
+static const int parallelThreshold = 4096;
+
+/**
+ * Day counts and year fractions for convention DC. BUS/252 counts the
+ * business days of the instrument's calendar.
+ */
+template <FinEnum::DayCountConvention DC>
+struct AccrualDays {
+    AccrualDays(const Calendar&) {}
+    int days(int jdn1, int jdn2) const {
+	return DayCountPolicy<DC>::days(jdn1, jdn2);
+    }
+    double yearFrac(int jdn1, int jdn2, int extraDays) const {
+	return DayCountPolicy<DC>::yearFrac(jdn1, jdn2, extraDays);
+    }
+};
+
+template <>
+struct AccrualDays<FinEnum::DCB252> {
+    const Calendar& cal;
+    AccrualDays(const Calendar& cal_) : cal(cal_) {}
+    int days(int jdn1, int jdn2) const {
+	return DayCountPolicy<FinEnum::DCB252>::days(jdn1, jdn2, cal);
+    }
+    double yearFrac(int jdn1, int jdn2, int extraDays) const {
+	return DayCountPolicy<FinEnum::DCB252>::yearFrac(jdn1, jdn2, cal,
+							 extraDays);
+    }
+};
+
+/**
+ * Accrued interest of one instrument (accrual dates d[0..n-1], with the
+ * coupon fraction of each period in frac) at each valuation date. Consecutive valuation dates usually fall in the same
+ * period, so the last period found is tried before the binary search.
+ */
+template <FinEnum::DayCountConvention DC>
+static void accrueDates(const int* d, const double* frac, int n,
+			double coupon, int frequency,
+			FinEnum::AccrualConvention conv, const Calendar& cal,
+			const int* valDates, int nVal,
+			double* accrued, int* period) {
+    AccrualDays<DC> dcf(cal);
+    int k = 0;
+    for(int j = 0; j < nVal; ++j) {
+	int v = valDates[j];
+	if(v < d[0] || v >= d[n-1]) {
+	    accrued[j] = 0;
+	    if(period)
+		period[j] = -1;
+	    continue;
+	}
+	if(v < d[k] || v >= d[k+1])
+	    k = std::upper_bound(d, d+n, v) - d - 1;
+	double a = 0;
+	if(v > d[k]) {
+	    switch(conv) {
+	    case FinEnum::Standard: {
+		int periodDays = dcf.days(d[k], d[k+1]);
+		if(periodDays > 0)
+		    a = coupon/frequency*frac[k]*dcf.days(d[k], v)/periodDays;
+		break;
+	    }
+	    case FinEnum::YearFraction:
+		a = coupon*dcf.yearFrac(d[k], v, 0);
+		break;
+	    case FinEnum::YearFractionPlus1:
+		a = coupon*dcf.yearFrac(d[k], v, 1);
+		break;
+	    }
+	}
+	accrued[j] = a;
+	if(period)
+	    period[j] = k;
+    }
+}
+
+/**
+ * Instrument i at each of the nVal valuation dates. The day count
+ * convention is dispatched once per call.
+ */
+void AccrualEngine::accrueRange(int i, const int* valDates, int nVal,
+				double* accrued, int* period) const {
+    const int* d = &dates[offsets[i]];
+    const double* frac = &periodFrac[offsets[i]];
+    int n = offsets[i+1] - offsets[i];
+    switch(dc[i]) {
+    case FinEnum::DCAA:
+	accrueDates<FinEnum::DCAA>(d, frac, n, coupon[i], frequency[i],
+				   conv[i], *cal[i], valDates, nVal, accrued,
+				   period);
+	break;
+    case FinEnum::DCA360:
+	accrueDates<FinEnum::DCA360>(d, frac, n, coupon[i], frequency[i],
+				     conv[i], *cal[i], valDates, nVal, accrued,
+				     period);
+	break;
+    case FinEnum::DCA365:
+	accrueDates<FinEnum::DCA365>(d, frac, n, coupon[i], frequency[i],
+				     conv[i], *cal[i], valDates, nVal, accrued,
+				     period);
+	break;
+    case FinEnum::DCA252:
+	accrueDates<FinEnum::DCA252>(d, frac, n, coupon[i], frequency[i],
+				     conv[i], *cal[i], valDates, nVal, accrued,
+				     period);
+	break;
+    case FinEnum::DC30360I:
+	accrueDates<FinEnum::DC30360I>(d, frac, n, coupon[i], frequency[i],
+				       conv[i], *cal[i], valDates, nVal,
+				       accrued, period);
+	break;
+    case FinEnum::DC30360E:
+	accrueDates<FinEnum::DC30360E>(d, frac, n, coupon[i], frequency[i],
+				       conv[i], *cal[i], valDates, nVal,
+				       accrued, period);
+	break;
+    case FinEnum::DC30360P1:
+	accrueDates<FinEnum::DC30360P1>(d, frac, n, coupon[i], frequency[i],
+					conv[i], *cal[i], valDates, nVal,
+					accrued, period);
+	break;
+    case FinEnum::DC30360P2:
+	accrueDates<FinEnum::DC30360P2>(d, frac, n, coupon[i], frequency[i],
+					conv[i], *cal[i], valDates, nVal,
+					accrued, period);
+	break;
+    case FinEnum::DCA360NL:
+	accrueDates<FinEnum::DCA360NL>(d, frac, n, coupon[i], frequency[i],
+				       conv[i], *cal[i], valDates, nVal,
+				       accrued, period);
+	break;
+    case FinEnum::DCA365NL:
+	accrueDates<FinEnum::DCA365NL>(d, frac, n, coupon[i], frequency[i],
+				       conv[i], *cal[i], valDates, nVal,
+				       accrued, period);
+	break;
+    case FinEnum::DCB252:
+	accrueDates<FinEnum::DCB252>(d, frac, n, coupon[i], frequency[i],
+				     conv[i], *cal[i], valDates, nVal, accrued,
+				     period);
+	break;
+    }
+}
+
+int AccrualEngine::add(const int* dates_, int n, double coupon_,
+		       int frequency_, FinEnum::DayCountConvention dc_,
+		       FinEnum::AccrualConvention conv_, const Calendar& cal_) {
+    if(dates_ == 0 || n < 2)
+	throw std::range_error("AccrualEngine::add: need at least two dates");
+    for(int k = 1; k < n; ++k)
+	if(dates_[k-1] >= dates_[k])
+	    throw std::range_error("AccrualEngine::add: dates must increase");
+    if(frequency_ < 1)
+	throw std::range_error("AccrualEngine::add: invalid frequency");
+    if(dc_ < 0 || dc_ >= FinEnum::numDayCountConvention)
+	throw std::range_error("AccrualEngine::add: invalid day count convention");
+    if(conv_ < 0 || conv_ >= FinEnum::numAccrualConvention)
+	throw std::range_error("AccrualEngine::add: invalid accrual convention");
+    dates.insert(dates.end(), dates_, dates_ + n);
+    periodFrac.insert(periodFrac.end(), n, 1.0);
+    offsets.push_back(dates.size());
+    coupon.push_back(coupon_);
+    frequency.push_back(frequency_);
+    dc.push_back(dc_);
+    conv.push_back(conv_);
+    cal.push_back(&cal_);
+    return numInstruments() - 1;
+}
+
+int AccrualEngine::add(const Schedule& schedule, double coupon_,
+		       FinEnum::AccrualConvention conv_) {
+    std::vector<int> unadjusted, adjusted;
+    std::vector<double> accrual;
+    schedule.generate(unadjusted, adjusted, accrual);
+    int i = add(&adjusted[0], adjusted.size(), coupon_,
+		schedule.getFrequency(), schedule.getDayCountConvention(),
+		conv_, schedule.getCalendar());
+    schedule.couponFractions(&periodFrac[offsets[i]]);
+    return i;
+}
+
+void AccrualEngine::accrue(const int* valDates, int nVal, double* accrued,
+			   int* period) const {
+    int n = numInstruments();
+    if(nVal > 0 && (valDates == 0 || accrued == 0))
+	throw std::range_error("AccrualEngine::accrue: null array");
+    if(nVal <= 0)
+	return;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if((double)n*nVal >= parallelThreshold)
+#endif
+    for(int i = 0; i < n; ++i)
+	accrueRange(i, valDates, nVal, accrued + (size_t)i*nVal,
+		    period ? period + (size_t)i*nVal : 0);
+}
+
+void AccrualEngine::accrueEach(const int* valDates, double* accrued,
+			       int* period) const {
+    int n = numInstruments();
+    if(n > 0 && (valDates == 0 || accrued == 0))
+	throw std::range_error("AccrualEngine::accrueEach: null array");
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if(n >= parallelThreshold)
+#endif
+    for(int i = 0; i < n; ++i)
+	accrueRange(i, valDates + i, 1, accrued + i, period ? period + i : 0);
+}
+
+std::vector<double> AccrualEngine::accrue(const std::vector<int>& valDates) const {
+    std::vector<double> accrued((size_t)numInstruments()*valDates.size());
+    if(!accrued.empty())
+	accrue(&valDates[0], valDates.size(), &accrued[0]);
+    return accrued;
+}
+
+std::vector<double> AccrualEngine::accrueEach(const std::vector<int>& valDates) const {
+    if((int)valDates.size() != numInstruments())
+	throw std::range_error("AccrualEngine::accrueEach: need one date per instrument");
+    std::vector<double> accrued(valDates.size());
+    if(!accrued.empty())
+	accrueEach(&valDates[0], &accrued[0]);
+    return accrued;
+}
+
+} // end cxxPack namespace
+
+/**
+ * R interface used by the unit tests: accrued interest per unit of
+ * notional (Standard convention) of the bond paying coupon on a Schedule
+ * from effective to maturity (R dates) with the weekends only calendar,
+ * at each of the R dates valDates. Returns a list with the AccrualEngine
+ * results (accrued, period) and the accrued interest from BondEngine
+ * (bondAccrued, NaN outside of the schedule).
+ */
+RcppExport SEXP accrual_(SEXP effective, SEXP maturity, SEXP frequency,
+			 SEXP feature, SEXP dc, SEXP coupon, SEXP valDates) {
+    BEGIN_RCPP
+    using cxxPack::FinDate;
+    using cxxPack::FinEnum;
+    cxxPack::Schedule schedule(
+	FinDate((int)Rcpp::as<double>(effective)),
+	FinDate((int)Rcpp::as<double>(maturity)),
+	Rcpp::as<int>(frequency),
+	FinEnum::BondFeature_for(Rcpp::as<std::string>(feature)),
+	FinEnum::NoAdj, FinEnum::Following,
+	FinEnum::DayCountConvention_for(Rcpp::as<std::string>(dc)));
+    double c = Rcpp::as<double>(coupon);
+    cxxPack::AccrualEngine engine;
+    engine.add(schedule, c);
+    cxxPack::BondEngine bonds;
+    bonds.add(schedule, c, 1.0);
+
+    Rcpp::NumericVector dates(valDates);
+    int n = dates.size();
+    std::vector<int> jdns(n);
+    for(int j = 0; j < n; ++j)
+	jdns[j] = (int)dates[j] + FinDate::R_Offset;
+    Rcpp::NumericVector accrued(n), bondAccrued(n);
+    Rcpp::IntegerVector period(n);
+    if(n > 0)
+	engine.accrue(&jdns[0], n, REAL(accrued), INTEGER(period));
+    cxxPack::BondAnalytics out;
+    for(int j = 0; j < n; ++j) {
+	std::vector<int> settle(1, jdns[j]);
+	std::vector<double> yield(1, 0.05);
+	bonds.compute(FinEnum::FixedYield, settle, yield, out);
+	bondAccrued[j] = out.accrued[0];
+    }
+
+    Rcpp::GenericVector result(3);
+    result[0] = accrued;
+    result[1] = period;
+    result[2] = bondAccrued;
+    Rcpp::CharacterVector names(3);
+    names[0] = "accrued";
+    names[1] = "period";
+    names[2] = "bondAccrued";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
@@ -81,6 +81,23 @@ CDatetimeVector::operator SEXP() {
     return nv;
 }
 
+CFinDatetimeVector::CFinDatetimeVector(Rcpp::NumericVector nv) {
+    if(nv.size() <= 0)
+	throw std::range_error("CFinDatetimeVector: invalid size");
+    vec.resize(nv.size());
+    for(int i=0; i < nv.size(); ++i) vec[i] = FinDatetime::fromSeconds(nv(i));
+}
+
+CFinDatetimeVector::operator SEXP() {
+    Rcpp::NumericVector nv(vec.size());
+    for(int i=0; i < nv.size(); ++i) nv(i) = vec[i].getSeconds();
+    Rcpp::CharacterVector cv(2);
+    cv(0) = Rcpp::datetimeClass[0];
+    cv(1) = Rcpp::datetimeClass[1];
+    Rcpp::RObject(nv).attr("class") = cv;
+    return nv;
+}
+
 }
 
 namespace Rcpp {
@@ -95,6 +112,10 @@ template<> SEXP wrap<cxxPack::CDatetimeVector>(const cxxPack::CDatetimeVector& d
     cxxPack::CDatetimeVector *p = const_cast<cxxPack::CDatetimeVector*>(&dv);
     return (SEXP)*p;
 }
+template<> SEXP wrap<cxxPack::CFinDatetimeVector>(const cxxPack::CFinDatetimeVector& dv) {
+    cxxPack::CFinDatetimeVector *p = const_cast<cxxPack::CFinDatetimeVector*>(&dv);
+    return (SEXP)*p;
+}
 template<> SEXP wrap<cxxPack::CNumericVector>(const cxxPack::CNumericVector& dv)	 {
     cxxPack::CNumericVector *p = const_cast<cxxPack::CNumericVector*>(&dv);
     return (SEXP)*p;
@@ -0,0 +1,351 @@
+// Bond.cpp: fixed coupon bond price, yield and risk over portfolios
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <limits>
+
+#include <Bond.hpp>
+
+namespace cxxPack {
+
+// Portfolios with at least this many bonds are processed in parallel
+// (when compiled with OpenMP).
+static const int parallelThreshold = 256;
+
+// Yield search interval and tolerance.
+static const double yieldLo = -0.99, yieldHi = 10.0, yieldTol = 1e-13;
+static const int maxIter = 100;
+
+static double notANumber() {
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+static int days(int jdn1, int jdn2, FinEnum::DayCountConvention dc,
+		const Calendar& cal) {
+    return FinDate::diffDays(FinDate(jdn1, true), FinDate(jdn2, true), dc, cal);
+}
+
+int BondEngine::add(const int* dates_, int n, double coupon_, int frequency_,
+		    FinEnum::DayCountConvention dc_, double redemption_,
+		    FinEnum::BondFeature yieldConv_,
+		    FinEnum::AccrualConvention accrualConv_,
+		    const Calendar& cal_) {
+    if(dates_ == 0 || n < 2)
+	throw std::range_error("BondEngine::add: need at least two dates");
+    for(int k = 1; k < n; ++k)
+	if(dates_[k-1] >= dates_[k])
+	    throw std::range_error("BondEngine::add: dates must increase");
+    if(frequency_ < 1)
+	throw std::range_error("BondEngine::add: invalid frequency");
+    if(dc_ < 0 || dc_ >= FinEnum::numDayCountConvention)
+	throw std::range_error("BondEngine::add: invalid day count convention");
+    if(accrualConv_ < 0 || accrualConv_ >= FinEnum::numAccrualConvention)
+	throw std::range_error("BondEngine::add: invalid accrual convention");
+    if(yieldConv_ != FinEnum::NoFeature && yieldConv_ != FinEnum::Moosmuller
+       && yieldConv_ != FinEnum::BraessFangmeyer)
+	throw std::range_error("BondEngine::add: "
+			       + FinEnum::BondFeature_str(yieldConv_)
+			       + " is not a yield convention");
+    dates.insert(dates.end(), dates_, dates_ + n);
+    offsets.push_back(dates.size());
+    for(int k = 0; k < n-1; ++k) {
+	periodFrac.push_back(1.0);
+	couponAmt.push_back(coupon_/frequency_*redemption_);
+    }
+    // Keeps the period arrays aligned with dates.
+    periodFrac.push_back(0.0);
+    couponAmt.push_back(0.0);
+    coupon.push_back(coupon_);
+    redemption.push_back(redemption_);
+    frequency.push_back(frequency_);
+    dc.push_back(dc_);
+    accrualConv.push_back(accrualConv_);
+    yieldConv.push_back(yieldConv_);
+    cal.push_back(&cal_);
+    return numBonds() - 1;
+}
+
+int BondEngine::add(const Schedule& schedule, double coupon_,
+		    double redemption_, FinEnum::BondFeature yieldConv_,
+		    FinEnum::AccrualConvention accrualConv_) {
+    std::vector<int> unadjusted, adjusted;
+    std::vector<double> accrual;
+    schedule.generate(unadjusted, adjusted, accrual);
+    int i = add(&adjusted[0], adjusted.size(), coupon_,
+		schedule.getFrequency(), schedule.getDayCountConvention(),
+		redemption_, yieldConv_, accrualConv_, schedule.getCalendar());
+
+    // Prorate the coupons of odd first and last periods.
+    int np = schedule.numPeriods();
+    std::vector<double> frac(np);
+    schedule.couponFractions(&frac[0]);
+    for(int p = 0; p < np; ++p) {
+	periodFrac[offsets[i] + p] = frac[p];
+	couponAmt[offsets[i] + p] *= frac[p];
+    }
+    return i;
+}
+
+bool BondEngine::locate(int i, int settle, int& k, double& w,
+			double& accrued) const {
+    const int* d = &dates[offsets[i]];
+    int n = offsets[i+1] - offsets[i];
+    if(settle < d[0] || settle >= d[n-1])
+	return false;
+    k = std::upper_bound(d, d+n, settle) - d - 1;
+    int p = offsets[i] + k;
+    int periodDays = days(d[k], d[k+1], dc[i], *cal[i]);
+    int elapsed = days(d[k], settle, dc[i], *cal[i]);
+    w = periodDays > 0 ? periodFrac[p]*(periodDays - elapsed)/periodDays
+	: periodFrac[p];
+    accrued = 0;
+    if(settle > d[k]) {
+	FinDate start(d[k], true), end(settle, true);
+	switch(accrualConv[i]) {
+	case FinEnum::Standard:
+	    if(periodDays > 0)
+		accrued = couponAmt[p]*elapsed/periodDays;
+	    break;
+	case FinEnum::YearFraction:
+	    accrued = coupon[i]*redemption[i]
+		*FinDate::yearFrac(start, end, dc[i], *cal[i]);
+	    break;
+	case FinEnum::YearFractionPlus1:
+	    accrued = coupon[i]*redemption[i]
+		*FinDate::yearFrac(start, end, dc[i], *cal[i], 1);
+	    break;
+	}
+    }
+    return true;
+}
+
+/**
+ * Each discount factor has the form A*B with A = 1/(1 + a*y) and
+ * B = (1 + y/g)^-b (see the class comment for a, b and g under each yield
+ * convention), so the derivatives in y follow from the product rule.
+ * Under the street and Moosmuller conventions b grows by a whole period
+ * from one regular cash flow to the next, and B is updated by one
+ * multiplication.
+ */
+void BondEngine::dirtyPrice(int i, int k, double w, double y, double& price,
+			    double& dPrice, double& d2Price) const {
+    int first = offsets[i] + k, last = offsets[i+1] - 2; // periods
+    double f = frequency[i];
+    FinEnum::BondFeature conv = yieldConv[i];
+    price = dPrice = d2Price = 0;
+
+    double g = conv == FinEnum::BraessFangmeyer ? 1.0 : f;
+    double v = 1/(1 + y/g); // one period discount at base g
+    double a = conv == FinEnum::Moosmuller ? w/f : 0.0;
+    double A = 1/(1 + a*y);
+    double dA = -a*A*A, d2A = 2*a*a*A*A*A;
+    double t = w; // periods from settlement to the cash flow
+    double b = conv == FinEnum::Moosmuller ? 0.0 : t;
+    double B = std::pow(v, b);
+    for(int p = first; p <= last; ++p) {
+	if(p > first) {
+	    double step = periodFrac[p];
+	    t += step;
+	    if(conv != FinEnum::BraessFangmeyer) {
+		b += step;
+		B *= step == 1.0 ? v : std::pow(v, step);
+	    }
+	}
+	if(conv == FinEnum::BraessFangmeyer) {
+	    double years = t/f;
+	    b = std::floor(years + 1e-12);
+	    a = std::max(0.0, years - b);
+	    A = 1/(1 + a*y);
+	    dA = -a*A*A;
+	    d2A = 2*a*a*A*A*A;
+	    B = std::pow(v, b);
+	}
+	double dB = -(b/g)*B*v, d2B = (b/g)*((b+1)/g)*B*v*v;
+	double cf = couponAmt[p] + (p == last ? redemption[i] : 0.0);
+	price += cf*A*B;
+	dPrice += cf*(dA*B + A*dB);
+	d2Price += cf*(d2A*B + 2*dA*dB + A*d2B);
+    }
+}
+
+void BondEngine::computeOne(int i, FinEnum::CalcMode mode, int settle,
+			    double value, double& clean, double& dirty,
+			    double& accrued, double& yield, double& duration,
+			    double& convexity) const {
+    clean = dirty = accrued = yield = duration = convexity = notANumber();
+    int k;
+    double w, acc;
+    if(!locate(i, settle, k, w, acc))
+	return;
+    double p, dp, d2p;
+    if(mode == FinEnum::FixedYield) {
+	yield = value;
+	dirtyPrice(i, k, w, yield, p, dp, d2p);
+    }
+    else {
+	// Halley's method, falling back to bisection when a step leaves
+	// the bracket [lo, hi] (the price decreases as the yield rises).
+	double target = value + acc, lo = yieldLo, hi = yieldHi;
+	double y = coupon[i] > lo && coupon[i] < hi ? coupon[i] : 0.05;
+	int iter;
+	for(iter = 0; iter < maxIter; ++iter) {
+	    dirtyPrice(i, k, w, y, p, dp, d2p);
+	    double diff = p - target;
+	    if(diff == 0)
+		break;
+	    if(diff > 0)
+		lo = y;
+	    else
+		hi = y;
+	    // Halley's step (the second derivative comes for free).
+	    double denom = 2*dp*dp - diff*d2p;
+	    double next = dp < 0 && denom > 0 ? y - 2*diff*dp/denom
+		: 0.5*(lo + hi);
+	    if(!(next > lo && next < hi))
+		next = 0.5*(lo + hi);
+	    bool done = std::fabs(next - y) <= yieldTol*(1 + std::fabs(y));
+	    y = next;
+	    if(done)
+		break;
+	}
+	dirtyPrice(i, k, w, y, p, dp, d2p);
+	// No root in [yieldLo, yieldHi]: the iterations end at one end.
+	if(iter == maxIter || !(std::fabs(p - target) <= 1e-8*target))
+	    return;
+	yield = y;
+    }
+    dirty = p;
+    accrued = acc;
+    clean = p - acc;
+    duration = -dp/p;
+    convexity = d2p/p;
+}
+
+void BondEngine::compute(const FinEnum::CalcMode* mode, const int* settle,
+			 const double* value, BondAnalytics& out) const {
+    int n = numBonds();
+    if(n > 0 && (mode == 0 || settle == 0 || value == 0))
+	throw std::range_error("BondEngine::compute: null array");
+    out.cleanPrice.resize(n);
+    out.dirtyPrice.resize(n);
+    out.accrued.resize(n);
+    out.yield.resize(n);
+    out.duration.resize(n);
+    out.convexity.resize(n);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 64) if(n >= parallelThreshold)
+#endif
+    for(int i = 0; i < n; ++i)
+	computeOne(i, mode[i], settle[i], value[i], out.cleanPrice[i],
+		   out.dirtyPrice[i], out.accrued[i], out.yield[i],
+		   out.duration[i], out.convexity[i]);
+}
+
+void BondEngine::compute(FinEnum::CalcMode mode, const int* settle,
+			 const double* value, BondAnalytics& out) const {
+    std::vector<FinEnum::CalcMode> modes(numBonds(), mode);
+    compute(modes.empty() ? 0 : &modes[0], settle, value, out);
+}
+
+void BondEngine::compute(FinEnum::CalcMode mode,
+			 const std::vector<int>& settle,
+			 const std::vector<double>& value,
+			 BondAnalytics& out) const {
+    if((int)settle.size() != numBonds() || (int)value.size() != numBonds())
+	throw std::range_error("BondEngine::compute: need one value per bond");
+    compute(mode, settle.empty() ? 0 : &settle[0],
+	    value.empty() ? 0 : &value[0], out);
+}
+
+double BondEngine::cleanPrice(int i, int settle, double yield) const {
+    double clean, dirty, accrued, y, duration, convexity;
+    computeOne(i, FinEnum::FixedYield, settle, yield, clean, dirty, accrued,
+	       y, duration, convexity);
+    return clean;
+}
+
+double BondEngine::yield(int i, int settle, double cleanPrice) const {
+    double clean, dirty, accrued, y, duration, convexity;
+    computeOne(i, FinEnum::FixedPrice, settle, cleanPrice, clean, dirty,
+	       accrued, y, duration, convexity);
+    return y;
+}
+
+} // end cxxPack namespace
+
+/**
+ * R interface used by the unit tests: the bond paying coupon on a
+ * Schedule from effective to maturity (R dates, Maturity Anchor, 30/360
+ * ISDA unless dc says otherwise, weekends only calendar) with yield
+ * convention yieldConv, computed with BondEngine::compute() in mode
+ * ("Fixed Yield" or "Fixed Price") at settlement settle[j] (R dates) with
+ * value[j], one copy of the bond for each j. Returns a list with the
+ * BondAnalytics vectors.
+ */
+RcppExport SEXP bond_(SEXP effective, SEXP maturity, SEXP frequency,
+		      SEXP coupon, SEXP dc, SEXP yieldConv, SEXP mode,
+		      SEXP settle, SEXP value) {
+    BEGIN_RCPP
+    using cxxPack::FinDate;
+    using cxxPack::FinEnum;
+    cxxPack::Schedule schedule(
+	FinDate((int)Rcpp::as<double>(effective)),
+	FinDate((int)Rcpp::as<double>(maturity)),
+	Rcpp::as<int>(frequency), FinEnum::MaturityAnchor, FinEnum::NoAdj,
+	FinEnum::Following,
+	FinEnum::DayCountConvention_for(Rcpp::as<std::string>(dc)));
+    FinEnum::BondFeature conv
+	= FinEnum::BondFeature_for(Rcpp::as<std::string>(yieldConv));
+    FinEnum::CalcMode calcMode
+	= FinEnum::CalcMode_for(Rcpp::as<std::string>(mode));
+    Rcpp::NumericVector settleDates(settle), values(value);
+    int n = settleDates.size();
+    if(values.size() != n)
+	throw std::range_error("bond_: length mismatch");
+
+    cxxPack::BondEngine engine;
+    std::vector<int> jdns(n);
+    std::vector<double> v(n);
+    for(int j = 0; j < n; ++j) {
+	engine.add(schedule, Rcpp::as<double>(coupon), 100, conv);
+	jdns[j] = (int)settleDates[j] + FinDate::R_Offset;
+	v[j] = values[j];
+    }
+    cxxPack::BondAnalytics out;
+    engine.compute(calcMode, jdns, v, out);
+
+    const std::vector<double>* fields[] = {
+	&out.cleanPrice, &out.dirtyPrice, &out.accrued, &out.yield,
+	&out.duration, &out.convexity
+    };
+    const char* fieldNames[] = {
+	"cleanPrice", "dirtyPrice", "accrued", "yield", "duration", "convexity"
+    };
+    Rcpp::GenericVector result(6);
+    Rcpp::CharacterVector names(6);
+    for(int f = 0; f < 6; ++f) {
+	Rcpp::NumericVector x(n);
+	for(int j = 0; j < n; ++j)
+	    x[j] = (*fields[f])[j];
+	result[f] = x;
+	names[f] = fieldNames[f];
+    }
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
@@ -0,0 +1,306 @@
+// Bootstrap.cpp: discount curve bootstrapping from market quotes
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#include <Bootstrap.hpp>
+#include <Schedule.hpp>
+
+namespace cxxPack {
+
+static const int maxIter = 50;
+static const double tolerance = 1e-15;
+
+CurveBootstrapper::CurveBootstrapper(FinDate refDate_, const Calendar& cal_,
+				     FinEnum::Interpolation interp_)
+    : refDate(refDate_.serialJulian()), cal(&cal_), interp(interp_),
+      firstDirty(0), structureChanged(true) {}
+
+CurveBootstrapper::Flow CurveBootstrapper::makeFlow(int date, double fixed,
+						    double perRate) {
+    Flow flow;
+    flow.date = date;
+    flow.a = flow.b = 0;
+    flow.w = 0;
+    flow.fixed = fixed;
+    flow.perRate = perRate;
+    return flow;
+}
+
+int CurveBootstrapper::add(InstrumentType type, double quote,
+			   double convexity, const std::vector<Flow>& flows) {
+    Instrument inst;
+    inst.type = type;
+    inst.quote = quote;
+    inst.convexity = convexity;
+    inst.flows = flows;
+    inst.pillar = flows.back().date;
+    instruments.push_back(inst);
+    structureChanged = true;
+    cached.clear();
+    return instruments.size() - 1;
+}
+
+int CurveBootstrapper::addDeposit(int months, double rate_,
+				  FinEnum::DayCountConvention dc) {
+    if(months < 1)
+	throw std::range_error("CurveBootstrapper::addDeposit: months must be positive");
+    int end = cal->adjust(FinDate(refDate, true).addMonths(months, false)
+			  .serialJulian(), FinEnum::ModFollowing);
+    double tau = FinDate::yearFrac(FinDate(refDate, true), FinDate(end, true),
+				   dc, *cal);
+    std::vector<Flow> flows;
+    flows.push_back(makeFlow(refDate, 1, 0));
+    flows.push_back(makeFlow(end, -1, -tau));
+    return add(Deposit, rate_, 0, flows);
+}
+
+int CurveBootstrapper::addFuture(int month, int year, double price,
+				 double convexity,
+				 FinEnum::DayCountConvention dc) {
+    if(month < 1 || month > 12)
+	throw std::range_error("CurveBootstrapper::addFuture: invalid month");
+    int endMonth = month + 3, endYear = year;
+    if(endMonth > 12) {
+	endMonth -= 12;
+	endYear++;
+    }
+    int start = FinDate::nthWeekday(3, cxxPack::Wed, month, year);
+    int end = FinDate::nthWeekday(3, cxxPack::Wed, endMonth, endYear);
+    if(start <= refDate)
+	throw std::range_error("CurveBootstrapper::addFuture: contract period has started");
+    double tau = FinDate::yearFrac(FinDate(start, true), FinDate(end, true),
+				   dc, *cal);
+    std::vector<Flow> flows;
+    flows.push_back(makeFlow(start, 1, 0));
+    flows.push_back(makeFlow(end, -1, -tau));
+    return add(Future, price, convexity, flows);
+}
+
+int CurveBootstrapper::addSwap(int years, double rate_, int frequency,
+			       FinEnum::DayCountConvention dc) {
+    if(years < 1)
+	throw std::range_error("CurveBootstrapper::addSwap: years must be positive");
+    FinDate ref(refDate, true);
+    Schedule schedule(ref, ref.addMonths(12*years, false), frequency,
+		      FinEnum::MaturityAnchor, FinEnum::NoAdj,
+		      FinEnum::ModFollowing, dc, *cal);
+    std::vector<int> unadjusted, adjusted;
+    std::vector<double> accrual;
+    schedule.generate(unadjusted, adjusted, accrual);
+    std::vector<Flow> flows;
+    flows.push_back(makeFlow(adjusted[0], -1, 0));
+    for(size_t i = 1; i < adjusted.size(); ++i)
+	flows.push_back(makeFlow(adjusted[i], i+1 == adjusted.size() ? 1 : 0,
+				 accrual[i-1]));
+    return add(Swap, rate_, 0, flows);
+}
+
+/**
+ * Orders the instruments by pillar, and places every cash flow between
+ * two pillars. All pillars must be solved again.
+ */
+void CurveBootstrapper::sortPillars() {
+    int n = instruments.size();
+    std::vector<std::pair<int,int> > byPillar(n);
+    for(int i = 0; i < n; ++i)
+	byPillar[i] = std::make_pair(instruments[i].pillar, i);
+    std::sort(byPillar.begin(), byPillar.end());
+    order.resize(n);
+    rank.resize(n);
+    std::vector<double> times(n+1, 0.0);
+    for(int pos = 0; pos < n; ++pos) {
+	order[pos] = byPillar[pos].second;
+	rank[order[pos]] = pos;
+	int pillar = byPillar[pos].first;
+	if(pillar <= (pos == 0 ? refDate : byPillar[pos-1].first))
+	    throw std::range_error("CurveBootstrapper: instruments must end on distinct dates after the reference date");
+	times[pos+1] = (pillar - refDate)/365.0;
+    }
+    for(int i = 0; i < n; ++i) {
+	std::vector<Flow>& flows = instruments[i].flows;
+	for(size_t j = 0; j < flows.size(); ++j) {
+	    double t = (flows[j].date - refDate)/365.0;
+	    int b = std::lower_bound(times.begin() + 1, times.end(), t)
+		- times.begin();
+	    flows[j].a = b - 1;
+	    flows[j].b = b;
+	    flows[j].w = (t - times[b-1])/(times[b] - times[b-1]);
+	}
+    }
+    x.assign(n+1, 0.0);
+    firstDirty = 0;
+    structureChanged = false;
+}
+
+double CurveBootstrapper::rate(const Instrument& inst) const {
+    if(inst.type == Future)
+	return (100 - inst.quote)/100 - inst.convexity;
+    return inst.quote;
+}
+
+/**
+ * Solves for -log P at the pillar of order[pos], by Newton's method on
+ * the value of the instrument's cash flows. Only the flows past the
+ * previous pillar depend on the unknown.
+ */
+void CurveBootstrapper::solve(int pos) {
+    const Instrument& inst = instruments[order[pos]];
+    const std::vector<Flow>& flows = inst.flows;
+    double r = rate(inst);
+    int k = pos + 1;
+    double dt = (inst.pillar - refDate)/365.0
+	- (pos == 0 ? 0.0 : (instruments[order[pos-1]].pillar - refDate)/365.0);
+    double xk = x[k-1] + r*dt;
+    for(int iter = 0; iter < maxIter; ++iter) {
+	x[k] = xk;
+	double value = 0, deriv = 0;
+	for(size_t j = 0; j < flows.size(); ++j) {
+	    const Flow& f = flows[j];
+	    double df = std::exp(-(x[f.a] + f.w*(x[f.b] - x[f.a])));
+	    double amount = f.fixed + f.perRate*r;
+	    value += amount*df;
+	    if(f.b == k)
+		deriv -= amount*f.w*df;
+	}
+	if(deriv == 0)
+	    break;
+	double step = value/deriv;
+	xk -= step;
+	if(std::fabs(step) <= tolerance*(1 + std::fabs(xk))) {
+	    x[k] = xk;
+	    return;
+	}
+    }
+    throw std::range_error("CurveBootstrapper: no discount factor reprices the instrument ending "
+			   + to_string(FinDate(inst.pillar, true)));
+}
+
+void CurveBootstrapper::setQuote(int i, double quote) {
+    if(i < 0 || i >= numInstruments())
+	throw std::range_error("CurveBootstrapper::setQuote: invalid instrument");
+    instruments[i].quote = quote;
+    if(!structureChanged)
+	firstDirty = std::min(firstDirty, rank[i]);
+    cached.clear();
+}
+
+int CurveBootstrapper::numDirty() const {
+    return structureChanged ? numInstruments() : numInstruments() - firstDirty;
+}
+
+const DiscountCurve& CurveBootstrapper::curve() {
+    int n = numInstruments();
+    if(n == 0)
+	throw std::range_error("CurveBootstrapper::curve: no instruments");
+    if(structureChanged)
+	sortPillars();
+    for(int pos = firstDirty; pos < n; ++pos) {
+	try {
+	    solve(pos);
+	}
+	catch(...) {
+	    firstDirty = pos;
+	    throw;
+	}
+    }
+    firstDirty = n;
+    if(cached.empty()) {
+	std::vector<int> pillars(n);
+	std::vector<double> discounts(n);
+	for(int pos = 0; pos < n; ++pos) {
+	    pillars[pos] = instruments[order[pos]].pillar;
+	    discounts[pos] = std::exp(-x[pos+1]);
+	}
+	cached.push_back(DiscountCurve(refDate, &pillars[0], &discounts[0], n,
+				       interp));
+    }
+    return cached[0];
+}
+
+} // end cxxPack namespace
+
+/**
+ * R interface used by the unit tests. Adds the instruments (type
+ * "Deposit" with term months, "Future" for month term of year, or "Swap"
+ * with term years) and strips the curve. Then quote changeIndex[k]
+ * (1-based) is set to changeQuote[k] in turn, calling curve() after the
+ * changes for which changeStrip[k] is true. Returns list(pillars,
+ * discount, dirty) with the pillars of the instruments (R dates), the
+ * discount factors of the final curve at dates, and numDirty() before
+ * the first curve() and after each change.
+ */
+RcppExport SEXP bootstrap_(SEXP refDate, SEXP interp, SEXP type, SEXP term,
+			   SEXP year, SEXP quote, SEXP convexity,
+			   SEXP changeIndex, SEXP changeQuote, SEXP changeStrip,
+			   SEXP dates) {
+    BEGIN_RCPP
+    using cxxPack::FinDate;
+    using cxxPack::FinEnum;
+    Rcpp::CharacterVector types(type);
+    Rcpp::IntegerVector terms(term), years(year);
+    Rcpp::NumericVector quotes(quote), conv(convexity);
+    Rcpp::IntegerVector index(changeIndex);
+    Rcpp::NumericVector newQuotes(changeQuote);
+    Rcpp::LogicalVector strip(changeStrip);
+    Rcpp::NumericVector lookupDates(dates);
+    int n = types.size(), m = index.size();
+    if(terms.size() != n || years.size() != n || quotes.size() != n
+       || conv.size() != n || newQuotes.size() != m || strip.size() != m)
+	throw std::range_error("bootstrap_: length mismatch");
+
+    cxxPack::CurveBootstrapper boot(
+	FinDate((int)Rcpp::as<double>(refDate)),
+	cxxPack::Calendar::get("WeekendsOnly"),
+	FinEnum::Interpolation_for(Rcpp::as<std::string>(interp)));
+    for(int i = 0; i < n; ++i) {
+	std::string t = Rcpp::as<std::string>(types[i]);
+	if(t == "Deposit")
+	    boot.addDeposit(terms[i], quotes[i]);
+	else if(t == "Future")
+	    boot.addFuture(terms[i], years[i], quotes[i], conv[i]);
+	else if(t == "Swap")
+	    boot.addSwap(terms[i], quotes[i]);
+	else
+	    throw std::range_error("bootstrap_: unknown instrument type " + t);
+    }
+    Rcpp::IntegerVector dirty(m+1);
+    dirty[0] = boot.numDirty();
+    boot.curve();
+    for(int k = 0; k < m; ++k) {
+	boot.setQuote(index[k] - 1, newQuotes[k]);
+	dirty[k+1] = boot.numDirty();
+	if(strip[k])
+	    boot.curve();
+    }
+    const cxxPack::DiscountCurve& curve = boot.curve();
+
+    Rcpp::NumericVector pillars(n), discount(lookupDates.size());
+    for(int i = 0; i < n; ++i)
+	pillars[i] = boot.getPillar(i).getRValue();
+    for(int j = 0; j < lookupDates.size(); ++j)
+	discount[j] = curve.discount((int)lookupDates[j] + FinDate::R_Offset);
+    Rcpp::GenericVector result(3);
+    Rcpp::CharacterVector names(3);
+    result[0] = pillars;  names[0] = "pillars";
+    result[1] = discount; names[1] = "discount";
+    result[2] = dirty;    names[2] = "dirty";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
@@ -0,0 +1,561 @@
+// Calendar.cpp: holiday calendars for business day calculations
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <iterator>
+
+#include <Calendar.hpp>
+#include <DateIO.hpp>
+
+namespace cxxPack {
+
+const int Calendar::defaultFirstYear = 1900;
+const int Calendar::defaultLastYear = 2200;
+
+// Bit twiddling helpers. The GNU builtins compile to single instructions
+// on most platforms.
+static inline int popCount(uint64_t x) {
+#ifdef __GNUC__
+    return __builtin_popcountll(x);
+#else
+    int count = 0;
+    for(; x != 0; x &= x-1)
+	count++;
+    return count;
+#endif
+}
+
+static inline int lowestBit(uint64_t x) { // x != 0
+#ifdef __GNUC__
+    return __builtin_ctzll(x);
+#else
+    int b = 0;
+    while(!((x >> b) & 1))
+	b++;
+    return b;
+#endif
+}
+
+static inline int highestBit(uint64_t x) { // x != 0
+#ifdef __GNUC__
+    return 63 - __builtin_clzll(x);
+#else
+    int b = 63;
+    while(!((x >> b) & 1))
+	b--;
+    return b;
+#endif
+}
+
+Calendar::Calendar(std::string name_, int firstYear_, int lastYear_)
+    : name(name_), firstYear(firstYear_), lastYear(lastYear_),
+      joinRule(JoinHolidays) {
+    build();
+}
+
+Calendar::Calendar(std::string name_, const std::vector<int>& holidayJdns,
+		   int firstYear_, int lastYear_)
+    : name(name_), holidays(holidayJdns),
+      firstYear(firstYear_), lastYear(lastYear_), joinRule(JoinHolidays) {
+    build();
+}
+
+Calendar::Calendar(std::string name_, const std::vector<FinDate>& holidayDates,
+		   int firstYear_, int lastYear_)
+    : name(name_), firstYear(firstYear_), lastYear(lastYear_),
+      joinRule(JoinHolidays) {
+    holidays.resize(holidayDates.size());
+    for(int i=0; i < (int)holidayDates.size(); ++i)
+	holidays[i] = holidayDates[i].serialJulian();
+    build();
+}
+
+/**
+ * Sets up the business day bitset and the per-word prefix counts.
+ */
+void Calendar::build() {
+    if(firstYear > lastYear)
+	throw std::range_error("Calendar: firstYear > lastYear");
+    firstJdn = FinDate::mdy2jdn(1, 1, firstYear);
+    lastJdn = FinDate::mdy2jdn(12, 31, lastYear);
+
+    // Keep only the holidays that matter.
+    std::sort(holidays.begin(), holidays.end());
+    holidays.erase(std::unique(holidays.begin(), holidays.end()),
+		   holidays.end());
+    std::vector<int> kept;
+    for(int i=0; i < (int)holidays.size(); ++i)
+	if(inRange(holidays[i]) && !isWeekend(holidays[i]))
+	    kept.push_back(holidays[i]);
+    holidays.swap(kept);
+
+    int numDays = lastJdn - firstJdn + 1;
+    int numWords = (numDays + 63)/64;
+    busDays.assign(numWords, 0);
+    for(int off = 0; off < numDays; ++off)
+	if(!isWeekend(firstJdn + off))
+	    busDays[off >> 6] |= (uint64_t)1 << (off & 63);
+    for(int i=0; i < (int)holidays.size(); ++i) {
+	int off = holidays[i] - firstJdn;
+	busDays[off >> 6] &= ~((uint64_t)1 << (off & 63));
+    }
+
+    prefixCount.resize(numWords+1);
+    prefixCount[0] = 0;
+    for(int w = 0; w < numWords; ++w)
+	prefixCount[w+1] = prefixCount[w] + popCount(busDays[w]);
+}
+
+/**
+ * Combines the holidays of the member calendars and rebuilds. The joint
+ * calendar covers all of the years covered by its members (a member
+ * has no holidays outside of its own years).
+ */
+void Calendar::buildJoint() {
+    const Calendar& first = get(members[0]);
+    firstYear = first.getFirstYear();
+    lastYear = first.getLastYear();
+    holidays = first.getHolidays();
+    for(int i=1; i < (int)members.size(); ++i) {
+	const Calendar& cal = get(members[i]);
+	firstYear = std::min(firstYear, cal.getFirstYear());
+	lastYear = std::max(lastYear, cal.getLastYear());
+	const std::vector<int>& other = cal.getHolidays();
+	std::vector<int> combined;
+	if(joinRule == JoinHolidays)
+	    std::set_union(holidays.begin(), holidays.end(),
+			   other.begin(), other.end(),
+			   std::back_inserter(combined));
+	else
+	    std::set_intersection(holidays.begin(), holidays.end(),
+				  other.begin(), other.end(),
+				  std::back_inserter(combined));
+	holidays.swap(combined);
+    }
+    build();
+}
+
+int Calendar::busDaysBefore(int jdn) const {
+    if(jdn <= firstJdn)
+	return -weekdaysBetween(jdn, firstJdn);
+    if(jdn > lastJdn)
+	return prefixCount[prefixCount.size()-1]
+	    + weekdaysBetween(lastJdn+1, jdn);
+    int off = jdn - firstJdn;
+    int w = off >> 6, b = off & 63;
+    uint64_t below = busDays[w] & (((uint64_t)1 << b) - 1);
+    return prefixCount[w] + popCount(below);
+}
+
+int Calendar::nextBusDay(int jdn) const {
+    int next = jdn+1;
+    if(inRange(next)) {
+	int off = next - firstJdn;
+	int w = off >> 6;
+	uint64_t word = busDays[w] >> (off & 63);
+	if(word != 0)
+	    return next + lowestBit(word);
+	for(++w; w < (int)busDays.size(); ++w)
+	    if(busDays[w] != 0)
+		return firstJdn + 64*w + lowestBit(busDays[w]);
+	next = lastJdn+1;
+    }
+    while(isWeekend(next)) // at most two steps
+	next++;
+    return next;
+}
+
+int Calendar::prevBusDay(int jdn) const {
+    int prev = jdn-1;
+    if(inRange(prev)) {
+	int off = prev - firstJdn;
+	int w = off >> 6, b = off & 63;
+	uint64_t word = busDays[w] << (63 - b);
+	if(word != 0)
+	    return prev - (63 - highestBit(word));
+	for(--w; w >= 0; --w)
+	    if(busDays[w] != 0)
+		return firstJdn + 64*w + highestBit(busDays[w]);
+	prev = firstJdn-1;
+    }
+    while(isWeekend(prev))
+	prev--;
+    return prev;
+}
+
+int Calendar::modNextBusDay(int jdn) const {
+    int next = nextBusDay(jdn);
+    if(FinDate::jdn2mdy(next).month != FinDate::jdn2mdy(jdn).month)
+	next = prevBusDay(jdn);
+    return next;
+}
+
+int Calendar::adjust(int jdn, FinEnum::BusDayConvention conv) const {
+    if(conv == FinEnum::EndOfMonth)
+	return lastBusDayOfMonth(jdn);
+    if(conv == FinEnum::Unadjusted || isBusDay(jdn))
+	return jdn;
+    int rolled;
+    switch(conv) {
+    case FinEnum::Following:
+	return nextBusDay(jdn);
+    case FinEnum::Preceding:
+	return prevBusDay(jdn);
+    case FinEnum::ModFollowing:
+	rolled = nextBusDay(jdn);
+	if(FinDate::jdn2mdy(rolled).month != FinDate::jdn2mdy(jdn).month)
+	    rolled = prevBusDay(jdn);
+	return rolled;
+    case FinEnum::ModPreceding:
+	rolled = prevBusDay(jdn);
+	if(FinDate::jdn2mdy(rolled).month != FinDate::jdn2mdy(jdn).month)
+	    rolled = nextBusDay(jdn);
+	return rolled;
+    default:
+	throw std::range_error("Calendar::adjust: invalid convention");
+    }
+}
+
+void Calendar::adjust(const int* jdns, int n, FinEnum::BusDayConvention conv,
+		      int* out) const {
+    if(conv < FinEnum::Unadjusted || conv > FinEnum::EndOfMonth)
+	throw std::range_error("Calendar::adjust: invalid convention");
+    if(conv == FinEnum::EndOfMonth) {
+	for(int i = 0; i < n; ++i)
+	    out[i] = lastBusDayOfMonth(jdns[i]);
+	return;
+    }
+    for(int i = 0; i < n; ++i) {
+	int jdn = jdns[i];
+	// Most dates are business days: test the bit inline.
+	unsigned int off = (unsigned int)(jdn - firstJdn);
+	bool busDay = off <= (unsigned int)(lastJdn - firstJdn)
+	    ? (busDays[off >> 6] >> (off & 63)) & 1 : !isWeekend(jdn);
+	out[i] = busDay ? jdn : adjust(jdn, conv);
+    }
+}
+
+std::vector<int> Calendar::adjust(const std::vector<int>& jdns,
+				  FinEnum::BusDayConvention conv) const {
+    std::vector<int> out(jdns.size());
+    if(jdns.size() > 0)
+	adjust(&jdns[0], jdns.size(), conv, &out[0]);
+    return out;
+}
+
+int Calendar::lastBusDayOfMonth(int jdn) const {
+    DateMDY mdy = FinDate::jdn2mdy(jdn);
+    int monthEnd = jdn + FinDate::daysInMonth(mdy.month, mdy.year) - mdy.day;
+    return isBusDay(monthEnd) ? monthEnd : prevBusDay(monthEnd);
+}
+
+// The k-th weekday after (k > 0) or the -k-th weekday before (k < 0)
+// jdn, ignoring holidays.
+static int addWeekdays(int jdn, int k) {
+    int weekday = (jdn+1)%7; // Sun=0, ..., Sat=6
+    if(k > 0) {
+	if(weekday == cxxPack::Sat || weekday == cxxPack::Sun) { // from Fri
+	    jdn -= (weekday == cxxPack::Sat) ? 1 : 2;
+	    weekday = cxxPack::Fri;
+	}
+	int rem = k%5;
+	jdn += 7*(k/5) + rem;
+	return (weekday + rem > cxxPack::Fri) ? jdn + 2 : jdn;
+    }
+    k = -k;
+    if(weekday == cxxPack::Sat || weekday == cxxPack::Sun) { // from Mon
+	jdn += (weekday == cxxPack::Sat) ? 2 : 1;
+	weekday = cxxPack::Mon;
+    }
+    int rem = k%5;
+    jdn -= 7*(k/5) + rem;
+    return (weekday - rem < cxxPack::Mon) ? jdn - 2 : jdn;
+}
+
+/**
+ * Holidays are rare, so the date n weekdays away is usually the answer:
+ * the business days in between are counted with busDaysBefore() (two
+ * lookups), and the search continues from there for each holiday found.
+ * If the count is complete the last weekday is a business day.
+ */
+int Calendar::advance(int jdn, int n) const {
+    if(n == 0)
+	return isBusDay(jdn) ? jdn : nextBusDay(jdn);
+    if(n > 0 && n <= 4) { // T+1, T+2, ...: a bit scan per day is cheaper
+	for(; n > 0; --n)
+	    jdn = nextBusDay(jdn);
+	return jdn;
+    }
+    if(n < 0 && n >= -4) {
+	for(; n < 0; ++n)
+	    jdn = prevBusDay(jdn);
+	return jdn;
+    }
+    while(n > 0) {
+	int next = addWeekdays(jdn, n);
+	n -= busDaysBefore(next+1) - busDaysBefore(jdn+1);
+	jdn = next;
+    }
+    while(n < 0) {
+	int prev = addWeekdays(jdn, n);
+	n += busDaysBefore(jdn) - busDaysBefore(prev);
+	jdn = prev;
+    }
+    return jdn;
+}
+
+void Calendar::advance(const int* jdns, int count, int n, int* out) const {
+    for(int i = 0; i < count; ++i)
+	out[i] = advance(jdns[i], n);
+}
+
+std::vector<int> Calendar::advance(const std::vector<int>& jdns, int n) const {
+    std::vector<int> out(jdns.size());
+    if(jdns.size() > 0)
+	advance(&jdns[0], jdns.size(), n, &out[0]);
+    return out;
+}
+
+int Calendar::weekdaysBetween(int jdn1, int jdn2) {
+    if(jdn2 < jdn1)
+	return -weekdaysBetween(jdn2, jdn1);
+    int days = jdn2 - jdn1;
+    int count = (days/7)*5;
+    int weekday = (jdn1+1)%7; // Sun=0, ..., Sat=6
+    for(int i = 0; i < days%7; ++i) // remaining partial week
+	if((weekday+i)%7 != cxxPack::Sat && (weekday+i)%7 != cxxPack::Sun)
+	    count++;
+    return count;
+}
+
+// The registry is created on first use (no static constructors), with
+// WeekendsOnly already registered, so that get() does not modify it for
+// the built-in name.
+typedef std::map<std::string, Calendar> CalendarMap;
+static CalendarMap builtinCalendars() {
+    CalendarMap calendars;
+    calendars.insert(std::make_pair(std::string("WeekendsOnly"),
+				    Calendar("WeekendsOnly")));
+    return calendars;
+}
+
+static CalendarMap& registry() {
+    static CalendarMap calendars = builtinCalendars();
+    return calendars;
+}
+
+/**
+ * Rebuilds (in place, so references stay valid) the cached joint
+ * calendars that depend on the named calendar.
+ */
+void Calendar::rebuildDependents(const std::string& name) {
+    CalendarMap& reg = registry();
+    for(CalendarMap::iterator it = reg.begin(); it != reg.end(); ++it) {
+	std::vector<std::string>& members = it->second.members;
+	if(std::find(members.begin(), members.end(), name) != members.end()) {
+	    it->second.buildJoint();
+	    rebuildDependents(it->first);
+	}
+    }
+}
+
+const Calendar& Calendar::add(const Calendar& cal) {
+    CalendarMap& reg = registry();
+    CalendarMap::iterator it = reg.find(cal.getName());
+    if(it != reg.end()) {
+	it->second = cal;
+	rebuildDependents(cal.getName());
+	return it->second;
+    }
+    return reg.insert(std::make_pair(cal.getName(), cal)).first->second;
+}
+
+bool Calendar::has(std::string name) {
+    return registry().count(name) > 0;
+}
+
+const Calendar& Calendar::get(std::string name) {
+    std::map<std::string, Calendar>& reg = registry();
+    std::map<std::string, Calendar>::iterator it = reg.find(name);
+    if(it != reg.end())
+	return it->second;
+    throw std::range_error("Calendar::get: unknown calendar: " + name);
+}
+
+const Calendar& Calendar::joint(const std::vector<std::string>& names,
+				JoinRule rule) {
+    if(names.size() == 0)
+	throw std::range_error("Calendar::joint: no calendars specified");
+    std::vector<std::string> sorted(names);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    if(sorted.size() == 1)
+	return get(sorted[0]);
+
+    std::string key = sorted[0];
+    for(int i=1; i < (int)sorted.size(); ++i)
+	key += (rule == JoinHolidays ? "+" : "|") + sorted[i];
+    CalendarMap::iterator it = registry().find(key);
+    if(it != registry().end())
+	return it->second;
+
+    Calendar cal(key);
+    cal.members = sorted;
+    cal.joinRule = rule;
+    cal.buildJoint();
+    return add(cal);
+}
+
+const Calendar& Calendar::joint(std::string name1, std::string name2,
+				JoinRule rule) {
+    std::vector<std::string> names(2);
+    names[0] = name1;
+    names[1] = name2;
+    return joint(names, rule);
+}
+
+const Calendar& Calendar::load(std::string name, std::string fileName,
+			       int firstYear, int lastYear) {
+    std::ifstream in(fileName.c_str());
+    if(!in)
+	throw std::range_error("Calendar::load: cannot open " + fileName);
+    std::vector<int> jdns;
+    std::string line;
+    int lineNum = 0;
+    while(std::getline(in, line)) {
+	lineNum++;
+	std::string::size_type pos = line.find_first_not_of(" \t\r");
+	if(pos == std::string::npos || line[pos] == '#')
+	    continue;
+	int jdn;
+	if(!DateIO::parse(line.data() + pos, line.data() + line.size(), jdn))
+	    throw std::range_error("Calendar::load: bad date on line "
+				   + to_string(lineNum) + " of " + fileName);
+	jdns.push_back(jdn);
+    }
+    return add(Calendar(name, jdns, firstYear, lastYear));
+}
+
+} // end cxxPack namespace
+
+/**
+ * R interface used by the unit tests: registers a calendar with the
+ * holidays given as R dates and returns its name.
+ */
+RcppExport SEXP calendarAdd_(SEXP name, SEXP holidays, SEXP firstYear,
+			     SEXP lastYear) {
+    BEGIN_RCPP
+    Rcpp::NumericVector dates(holidays);
+    std::vector<int> jdns(dates.size());
+    for(int i = 0; i < dates.size(); ++i)
+	jdns[i] = (int)dates[i] + cxxPack::FinDate::R_Offset;
+    const cxxPack::Calendar& cal
+	= cxxPack::Calendar::add(cxxPack::Calendar(Rcpp::as<std::string>(name),
+						   jdns,
+						   Rcpp::as<int>(firstYear),
+						   Rcpp::as<int>(lastYear)));
+    return Rcpp::wrap(cal.getName());
+    END_RCPP
+}
+
+/**
+ * Fetches the joint calendar of the registered calendars members, with
+ * rule "+" (JoinHolidays) or "|" (JoinBusinessDays), and returns its name.
+ */
+RcppExport SEXP calendarJoint_(SEXP members, SEXP rule) {
+    BEGIN_RCPP
+    std::vector<std::string> names
+	= Rcpp::as<std::vector<std::string> >(members);
+    std::string r = Rcpp::as<std::string>(rule);
+    if(r != "+" && r != "|")
+	throw std::range_error("calendarJoint_: rule must be + or |");
+    const cxxPack::Calendar& cal
+	= cxxPack::Calendar::joint(names, r == "+"
+				   ? cxxPack::Calendar::JoinHolidays
+				   : cxxPack::Calendar::JoinBusinessDays);
+    return Rcpp::wrap(cal.getName());
+    END_RCPP
+}
+
+/**
+ * Applies a Calendar method to the R dates in x using the calendar
+ * registered under name:
+ *
+ * - "isBusDay": logical result.
+ * - "busDaysBefore": integer result.
+ * - "busDaysBetween": business days from x[i] to arg[i] (R dates).
+ * - "adjust": x rolled with the convention named by arg.
+ * - "advance": x moved arg business days.
+ * - "nextBusDay", "prevBusDay".
+ *
+ * The date results are R date serial numbers.
+ */
+RcppExport SEXP calendarApply_(SEXP name, SEXP method, SEXP x, SEXP arg) {
+    BEGIN_RCPP
+    const cxxPack::Calendar& cal
+	= cxxPack::Calendar::get(Rcpp::as<std::string>(name));
+    std::string what = Rcpp::as<std::string>(method);
+    Rcpp::NumericVector dates(x);
+    int n = dates.size();
+    std::vector<int> jdns(n);
+    for(int i = 0; i < n; ++i)
+	jdns[i] = (int)dates[i] + cxxPack::FinDate::R_Offset;
+
+    if(what == "isBusDay") {
+	Rcpp::LogicalVector out(n);
+	for(int i = 0; i < n; ++i)
+	    out[i] = cal.isBusDay(jdns[i]);
+	return out;
+    }
+    if(what == "busDaysBefore") {
+	Rcpp::IntegerVector out(n);
+	for(int i = 0; i < n; ++i)
+	    out[i] = cal.busDaysBefore(jdns[i]);
+	return out;
+    }
+    if(what == "busDaysBetween") {
+	Rcpp::NumericVector to(arg);
+	if(to.size() != n)
+	    throw std::range_error("calendarApply_: length mismatch");
+	Rcpp::IntegerVector out(n);
+	for(int i = 0; i < n; ++i)
+	    out[i] = cal.busDaysBetween(jdns[i],
+					(int)to[i] + cxxPack::FinDate::R_Offset);
+	return out;
+    }
+
+    std::vector<int> result;
+    if(what == "adjust")
+	result = cal.adjust(jdns, cxxPack::FinEnum::BusDayConvention_for(
+				Rcpp::as<std::string>(arg)));
+    else if(what == "advance")
+	result = cal.advance(jdns, Rcpp::as<int>(arg));
+    else if(what == "nextBusDay" || what == "prevBusDay") {
+	result.resize(n);
+	for(int i = 0; i < n; ++i)
+	    result[i] = what == "nextBusDay" ? cal.nextBusDay(jdns[i])
+		: cal.prevBusDay(jdns[i]);
+    }
+    else
+	throw std::range_error("calendarApply_: unknown method " + what);
+    Rcpp::NumericVector out(n);
+    for(int i = 0; i < n; ++i)
+	out[i] = result[i] - cxxPack::FinDate::R_Offset;
+    return out;
+    END_RCPP
+}
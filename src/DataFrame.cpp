@@ -14,56 +14,174 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
+
 #include <DataFrame.hpp>
+#include <DataFrameView.hpp>
+#include <DateIO.hpp>
+
+#include <Rversion.h>
+
+// R 3.5 added ALTREP, which lets transferToR() hand column buffers to R.
+// Before R 3.6 Altrep.h uses class as a parameter name.
+#if defined(R_VERSION) && R_VERSION >= R_Version(3,5,0)
+#define CXXPACK_ALTREP
+#if R_VERSION < R_Version(3,6,0)
+#define class klass
+extern "C" {
+#include <R_ext/Altrep.h>
+}
+#undef class
+#else
+#include <R_ext/Altrep.h>
+#endif
+#endif
 
 namespace cxxPack {
 
-FrameColumn::FrameColumn(const FrameColumn& col) {
-    switch(col.type) {
-    case FrameColumn::COLTYPE_INT:
-	type = FrameColumn::COLTYPE_INT;
-	colInt = new std::vector<int>(*col.colInt);
-	break;
-    case FrameColumn::COLTYPE_DOUBLE:
-	type = COLTYPE_DOUBLE;
-	colDouble = new std::vector<double>(*col.colDouble);
-	break;
-    case FrameColumn::COLTYPE_STRING:
-	type = COLTYPE_STRING;
-	colString = new std::vector<std::string>(*col.colString);
-	break;
-    case FrameColumn::COLTYPE_LOGICAL:
-	type = COLTYPE_LOGICAL;
-	colBool = new std::vector<bool>(*col.colBool);
-	break;
-    case FrameColumn::COLTYPE_FACTOR:
-	type = COLTYPE_FACTOR;
-	colFactor = new Factor(*col.colFactor);
-	break;
-    case FrameColumn::COLTYPE_FINDATE:
-	type = COLTYPE_FINDATE;
-	colFinDate = new std::vector<FinDate>(*col.colFinDate);
-	break;
-    case FrameColumn::COLTYPE_RCPPDATE:
-	type = COLTYPE_RCPPDATE;
-	colRcppDate = new std::vector<RcppDate>(*col.colRcppDate);
-	break;
-    case FrameColumn::COLTYPE_RCPPDATETIME:
-	type = COLTYPE_RCPPDATETIME;
-	colRcppDatetime = new std::vector<RcppDatetime>(*col.colRcppDatetime);	
-	break;
-    default:
-	;
+#ifdef CXXPACK_ALTREP
+
+/**
+ * An R vector (double or integer) whose elements live in a std::vector
+ * owned by R: data1 is an external pointer to the vector, deleted by its
+ * finalizer when R collects the vector. R reads and writes the elements
+ * in place, so nothing is copied in either direction. The classes are
+ * registered on first use, without a DllInfo, since this code is also
+ * linked into user libraries; the vectors are serialized as ordinary
+ * vectors.
+ */
+template <class T>
+class AltColumn {
+
+    static R_altrep_class_t altClass;
+    static bool registered;
+    static T empty; // DATAPTR of a zero length vector
+
+    static R_altrep_class_t makeClass();
+
+    static std::vector<T>& get(SEXP x) {
+	return *(std::vector<T>*)R_ExternalPtrAddr(R_altrep_data1(x));
     }
+
+    static void finalize(SEXP ptr) {
+	delete (std::vector<T>*)R_ExternalPtrAddr(ptr);
+	R_ClearExternalPtr(ptr);
+    }
+
+    static R_xlen_t length(SEXP x) { return get(x).size(); }
+
+    static void* dataptr(SEXP x, Rboolean) {
+	std::vector<T>& v = get(x);
+	return v.empty() ? &empty : &v[0];
+    }
+
+    static const void* dataptrOrNull(SEXP x) { return dataptr(x, FALSE); }
+
+    static T elt(SEXP x, R_xlen_t i) { return get(x)[i]; }
+
+    static R_xlen_t getRegion(SEXP x, R_xlen_t i, R_xlen_t n, T* buf) {
+	std::vector<T>& v = get(x);
+	R_xlen_t count = std::min(n, (R_xlen_t)v.size() - i);
+	std::copy(v.begin() + i, v.begin() + i + count, buf);
+	return count;
+    }
+
+    static Rboolean inspect(SEXP x, int, int, int,
+			    void (*)(SEXP, int, int, int)) {
+	Rprintf("cxxPack column (length %d)\n", (int)get(x).size());
+	return TRUE;
+    }
+
+public:
+
+    /**
+     * An empty R vector. The buffer is handed over later with adopt(),
+     * once every other R allocation has succeeded.
+     */
+    static SEXP make() {
+	if(!registered) {
+	    altClass = makeClass();
+	    registered = true;
+	}
+	// The finalizer is registered before the buffer exists, so that
+	// nothing leaks if an allocation below fails.
+	SEXP ptr = PROTECT(R_MakeExternalPtr(0, R_NilValue, R_NilValue));
+	R_RegisterCFinalizerEx(ptr, finalize, TRUE);
+	R_SetExternalPtrAddr(ptr, new std::vector<T>());
+	SEXP x = R_new_altrep(altClass, ptr, R_NilValue);
+	UNPROTECT(1);
+	return x;
+    }
+
+    /**
+     * Moves the elements of v (v is left empty) into x, a vector from
+     * make(). Cannot fail.
+     */
+    static void adopt(SEXP x, std::vector<T>& v) { get(x).swap(v); }
+};
+
+template <class T> R_altrep_class_t AltColumn<T>::altClass;
+template <class T> bool AltColumn<T>::registered = false;
+template <class T> T AltColumn<T>::empty;
+
+template <>
+R_altrep_class_t AltColumn<double>::makeClass() {
+    R_altrep_class_t c = R_make_altreal_class("cxxPack_double", "cxxPack", 0);
+    R_set_altrep_Length_method(c, length);
+    R_set_altrep_Inspect_method(c, inspect);
+    R_set_altvec_Dataptr_method(c, dataptr);
+    R_set_altvec_Dataptr_or_null_method(c, dataptrOrNull);
+    R_set_altreal_Elt_method(c, elt);
+    R_set_altreal_Get_region_method(c, getRegion);
+    return c;
 }
 
-FrameColumn& FrameColumn::operator=(const FrameColumn& col) {
-    if(this == &col)
-	return *this;
+template <>
+R_altrep_class_t AltColumn<int>::makeClass() {
+    R_altrep_class_t c = R_make_altinteger_class("cxxPack_int", "cxxPack", 0);
+    R_set_altrep_Length_method(c, length);
+    R_set_altrep_Inspect_method(c, inspect);
+    R_set_altvec_Dataptr_method(c, dataptr);
+    R_set_altvec_Dataptr_or_null_method(c, dataptrOrNull);
+    R_set_altinteger_Elt_method(c, elt);
+    R_set_altinteger_Get_region_method(c, getRegion);
+    return c;
+}
+
+#endif
+
+void FrameColumn::init() {
+    type = COLTYPE_NONE;
+    colInt = 0;
+    colDouble = 0;
+    colString = 0;
+    colBool = 0;
+    colFinDate = 0;
+    colRcppDate = 0;
+    colRcppDatetime = 0;
+    colFinDatetime = 0;
+    colFactor = 0;
+}
+
+void FrameColumn::release() {
+    // At most one of these is non-null.
+    delete colInt;
+    delete colDouble;
+    delete colString;
+    delete colBool;
+    delete colFinDate;
+    delete colRcppDate;
+    delete colRcppDatetime;
+    delete colFinDatetime;
+    delete colFactor;
+    init();
+}
 
+FrameColumn::FrameColumn(const FrameColumn& col) {
+    init();
     switch(col.type) {
     case FrameColumn::COLTYPE_INT:
-	type = COLTYPE_INT;
+	type = FrameColumn::COLTYPE_INT;
 	colInt = new std::vector<int>(*col.colInt);
 	break;
     case FrameColumn::COLTYPE_DOUBLE:
@@ -94,43 +212,28 @@ FrameColumn& FrameColumn::operator=(const FrameColumn& col) {
 	type = COLTYPE_RCPPDATETIME;
 	colRcppDatetime = new std::vector<RcppDatetime>(*col.colRcppDatetime);	
 	break;
-    default:
-	;
-    }
-    return *this;
-}	
-
-FrameColumn::~FrameColumn() {
-    switch(type) {
-    case FrameColumn::COLTYPE_INT:
-	delete colInt;
-	break;
-    case FrameColumn::COLTYPE_DOUBLE:
-	delete colDouble;
-	break;
-    case FrameColumn::COLTYPE_STRING:
-	delete colString;
-	break;
-    case FrameColumn::COLTYPE_LOGICAL:
-	delete colBool;
-	break;
-    case FrameColumn::COLTYPE_FACTOR:
-	delete colFactor;
-	break;
-    case FrameColumn::COLTYPE_FINDATE:
-	delete colFinDate;
-	break;
-    case FrameColumn::COLTYPE_RCPPDATE:
-	delete colRcppDate;
-	break;
-    case FrameColumn::COLTYPE_RCPPDATETIME:
-	delete colRcppDatetime;
+    case FrameColumn::COLTYPE_FINDATETIME:
+	type = COLTYPE_FINDATETIME;
+	colFinDatetime = new std::vector<FinDatetime>(*col.colFinDatetime);
 	break;
     default:
 	;
     }
 }
 
+void FrameColumn::swap(FrameColumn& col) {
+    std::swap(type, col.type);
+    std::swap(colInt, col.colInt);
+    std::swap(colDouble, col.colDouble);
+    std::swap(colString, col.colString);
+    std::swap(colBool, col.colBool);
+    std::swap(colFinDate, col.colFinDate);
+    std::swap(colRcppDate, col.colRcppDate);
+    std::swap(colRcppDatetime, col.colRcppDatetime);
+    std::swap(colFinDatetime, col.colFinDatetime);
+    std::swap(colFactor, col.colFactor);
+}
+
 void FrameColumn::print() {
     switch(type) {
     case COLTYPE_INT:
@@ -162,8 +265,12 @@ void FrameColumn::print() {
 	break;
     case COLTYPE_FINDATE:
 	Rprintf("FINDATE:\n");
-	for(int i = 0; i < (int)colFinDate->size(); ++i)
-	    Rprintf("  %s\n", to_string((*colFinDate)[i]).c_str());
+	for(int i = 0; i < (int)colFinDate->size(); ++i) {
+	    char buf[DateIO::maxDateLength];
+	    DateIO::format((*colFinDate)[i].serialJulian(), buf,
+			   DateIO::WeekdayUSFormat);
+	    Rprintf("  %s\n", buf);
+	}
 	break;
     case COLTYPE_RCPPDATE:
 	Rprintf("RCPPDATE:\n");
@@ -175,12 +282,21 @@ void FrameColumn::print() {
 	for(int i = 0; i < (int)colRcppDatetime->size(); ++i)
 	    Rprintf("  %s\n", to_string((*colRcppDatetime)[i]).c_str());
 	break;
+    case COLTYPE_FINDATETIME:
+	Rprintf("FINDATETIME:\n");
+	for(int i = 0; i < (int)colFinDatetime->size(); ++i) {
+	    char buf[DateIO::maxDateLength];
+	    DateIO::formatNanos((*colFinDatetime)[i].getNanos(), buf);
+	    Rprintf("  %s\n", buf);
+	}
+	break;
     case COLTYPE_NONE:
 	throw std::range_error("Invalide COLTYPE in FrameColun::print");
     }
 }
 
 bool DataFrame::useRcppDate_ = false;
+bool DataFrame::useFinDatetime_ = false;
 
 DataFrame::DataFrame(SEXP df) {
 
@@ -205,7 +321,10 @@ DataFrame::DataFrame(SEXP df) {
 	throw std::range_error("columnList has zero size in DataFrame constr");
     int nrow = Rf_length(columnList[0]);
 
-    // Process columns.
+    // Process columns. Each one is filled in a local vector that is then
+    // handed to its (initially empty) FrameColumn, so the data is
+    // allocated once and never copied.
+    cols.resize(ncol);
     for(int i=0; i < ncol; ++i) {
 
 	// Need cast to SEXP here due to ambiguity.
@@ -224,48 +343,55 @@ DataFrame::DataFrame(SEXP df) {
 	if(Rf_isReal(colObject)) { // Used for numeric AND date types.
 	    if(isDateClass) {
 		if(useRcppDate_) { // Use RcppDate instead of FinDate
-		    std::vector<RcppDate>* colDate = new std::vector<RcppDate>(nrow);
+		    std::vector<RcppDate> colDate(nrow);
 		    Rcpp::NumericVector nv(colObject);
 		    for(int j=0; j < nrow; j++) // FrameColumn of RcppDate's
-			(*colDate)[j] = RcppDate(nv(j));
-		    cols.push_back(FrameColumn(*colDate));
+			colDate[j] = RcppDate(nv(j));
+		    cols[i].adopt(colDate);
 		}
 		else { // Use FinDate
-		    std::vector<FinDate>* colDate = new std::vector<FinDate>(nrow);
+		    std::vector<FinDate> colDate(nrow);
 		    Rcpp::NumericVector nv(colObject);
 		    for(int j=0; j < nrow; j++) // FrameColumn of FinDate's
-			(*colDate)[j] = FinDate((int)nv(j));
-		    cols.push_back(FrameColumn(*colDate));
+			colDate[j] = FinDate((int)nv(j));
+		    cols[i].adopt(colDate);
 		}
 	    }
+	    else if(isPOSIXDate && useFinDatetime_) {
+		std::vector<FinDatetime> colFinDatetime(nrow);
+		Rcpp::NumericVector nv(colObject);
+		for(int j=0; j < nrow; j++) // FrameColumn of FinDatetime's
+		    colFinDatetime[j] = FinDatetime::fromSeconds(nv(j));
+		cols[i].adopt(colFinDatetime);
+	    }
 	    else if(isPOSIXDate) {
-		std::vector<RcppDatetime>* colRcppDatetime = new std::vector<RcppDatetime>(nrow);
+		std::vector<RcppDatetime> colRcppDatetime(nrow);
 		Rcpp::NumericVector nv(colObject);
 		for(int j=0; j < nrow; j++) // FrameColumn of RcppDatetime's
-		    (*colRcppDatetime)[j] = RcppDatetime(nv(j));
-		cols.push_back(FrameColumn(*colRcppDatetime));
+		    colRcppDatetime[j] = RcppDatetime(nv(j));
+		cols[i].adopt(colRcppDatetime);
 	    }
 	    else { // FrameColumn of REAL's
-		std::vector<double>* colDouble = new std::vector<double>(nrow);
+		std::vector<double> colDouble(nrow);
 		Rcpp::NumericVector nv(colObject);
 		for(int j=0; j < nrow; j++)
-		    (*colDouble)[j] = nv(j);
-		cols.push_back(FrameColumn(*colDouble));
+		    colDouble[j] = nv(j);
+		cols[i].adopt(colDouble);
 	    }
 	}
 	else if(Rf_isInteger(colObject)) {
 	    Rcpp::IntegerVector iv(colObject);
-	    std::vector<int>* colInt = new std::vector<int>(nrow);
+	    std::vector<int> colInt(nrow);
 	    for(int j=0; j < nrow; j++)
-		(*colInt)[j] = iv(j);
-	    cols.push_back(FrameColumn(*colInt));
+		colInt[j] = iv(j);
+	    cols[i].adopt(colInt);
 	}
 	else if(Rf_isString(colObject)) { // Non-factor string column
-	    std::vector<std::string>* colString = new std::vector<std::string>(nrow);
+	    std::vector<std::string> colString(nrow);
 	    Rcpp::CharacterVector cv(colObject);
 	    for(int j=0; j < nrow; j++)
-		(*colString)[j] = cv(j);
-	    cols.push_back(FrameColumn(*colString));
+		colString[j] = cv(j);
+	    cols[i].adopt(colString);
 	}
 	else if (Rf_isFactor(colObject)) { // Factor column.
 	    SEXP names = Rf_getAttrib(colObject, R_LevelsSymbol);
@@ -280,16 +406,15 @@ DataFrame::DataFrame(SEXP df) {
 		int obsLevel = iv(j);
 		obsLevelNames[j] = levelNames[obsLevel-1];
 	    }
-	    Factor* colFactor = new Factor(obsLevelNames);
-	    cols.push_back(FrameColumn(*colFactor));
+	    cols[i].adopt(new Factor(obsLevelNames));
 	}
 	else if(Rf_isLogical(colObject)) {
-	    std::vector<bool>* colBool = new std::vector<bool>(nrow);
+	    std::vector<bool> colBool(nrow);
 	    Rcpp::IntegerVector iv(colObject);
 	    for(int j=0; j < nrow; j++) {
-		(*colBool)[j] = (bool)iv(j);
+		colBool[j] = (bool)iv(j);
 	    }
-	    cols.push_back(FrameColumn(*colBool));
+	    cols[i].adopt(colBool);
 	}
 	else
 	    throw std::range_error("DataFrame constr unsupported data frame column type.");
@@ -314,30 +439,51 @@ DataFrame::DataFrame(SEXP df) {
 	    rowNames[i] = to_string(nv(i));
     }
     else if(Rf_isString(rownamesAttr)) {
-	rowNames = Rcpp::RObject(rownamesAttr).attributeNames();
+	Rcpp::CharacterVector cv(rownamesAttr);
+	for(int i = 0; i < Rf_length(rownamesAttr); ++i)
+	    rowNames[i] = cv(i);
     }
 }
 
-DataFrame::operator SEXP() {
+SEXP DataFrame::transferToR() {
+    SEXP frame = PROTECT(toR(true));
+    rowNames.clear();
+    colNames.clear();
+    cols.clear();
+    UNPROTECT(1);
+    return frame;
+}
+
+SEXP DataFrame::toR(bool transfer) {
 
-    int ncol = getColNames().size();
-    int nrow = getRowNames().size();
+    int ncol = colNames.size();
+    int nrow = rowNames.size();
 
     Rcpp::GenericVector frame(ncol);
 
     // Set row name vector and attribute.
     Rcpp::CharacterVector rowNames(nrow);
     for(int i=0; i < nrow; ++i)
-	rowNames[i] = getRowNames()[i];
+	rowNames[i] = this->rowNames[i];
     Rcpp::RObject(rowNames).attr("class") = "row.names";
 
     // Set column names.
     Rcpp::CharacterVector colNames(ncol);
     for(int i=0; i < ncol; ++i)
-	colNames[i] = getColNames()[i];
+	colNames[i] = this->colNames[i];
 
     for(int i=0; i < ncol; i++) {
-	cxxPack::FrameColumn col = getColumns()[i];
+	cxxPack::FrameColumn& col = cols[i];
+#ifdef CXXPACK_ALTREP
+	if(transfer && col.getType() == cxxPack::FrameColumn::COLTYPE_DOUBLE) {
+	    frame[i] = AltColumn<double>::make();
+	    continue;
+	}
+	if(transfer && col.getType() == cxxPack::FrameColumn::COLTYPE_INT) {
+	    frame[i] = AltColumn<int>::make();
+	    continue;
+	}
+#endif
 	switch(col.getType()) {
 	case cxxPack::FrameColumn::COLTYPE_DOUBLE: {
 	    Rcpp::NumericVector nv(nrow);
@@ -411,6 +557,17 @@ DataFrame::operator SEXP() {
 	    frame[i] = nv;
 	    }
 	    break;
+	case cxxPack::FrameColumn::COLTYPE_FINDATETIME: {
+	    Rcpp::NumericVector nv(nrow);
+	    Rcpp::CharacterVector cv(2);
+	    cv[0] = Rcpp::datetimeClass[0];
+	    cv[1] = Rcpp::datetimeClass[1];
+	    Rcpp::RObject(nv).attr("class") = cv;
+	    for(int j=0; j < nrow; j++)
+		nv[j] = (*col.colFinDatetime)[j].getSeconds();
+	    frame[i] = nv;
+	    }
+	    break;
 	default:
 	    throw std::range_error("Invalid column type in DataFrame wrap");
 	}
@@ -421,6 +578,19 @@ DataFrame::operator SEXP() {
     frame.attr("row.names") = rowNames;
     frame.attr("names") = colNames;
 
+#ifdef CXXPACK_ALTREP
+    // Every R object exists now, so the buffers can be moved without an
+    // error leaving this frame with some columns emptied.
+    if(transfer)
+	for(int i=0; i < ncol; ++i) {
+	    cxxPack::FrameColumn& col = cols[i];
+	    if(col.getType() == cxxPack::FrameColumn::COLTYPE_DOUBLE)
+		AltColumn<double>::adopt(VECTOR_ELT(frame, i), *col.colDouble);
+	    else if(col.getType() == cxxPack::FrameColumn::COLTYPE_INT)
+		AltColumn<int>::adopt(VECTOR_ELT(frame, i), *col.colInt);
+	}
+#endif
+
     return frame;
 }
 
@@ -435,3 +605,320 @@ template<> SEXP wrap<cxxPack::DataFrame>(const cxxPack::DataFrame& x) {
 
 }
 
+
+/**
+ * R interface used by the unit tests: builds a frame with nrow rows and
+ * columns id (int), amount (double), name (string) and date in C++, and
+ * returns it with transferToR(). Returns a list with the frame and the
+ * number of columns left in the C++ frame after the transfer.
+ */
+RcppExport SEXP dataFrameTransfer_(SEXP nrow_) {
+    BEGIN_RCPP
+    int nrow = Rcpp::as<int>(nrow_);
+    std::vector<std::string> rowNames(nrow), colNames(4);
+    std::vector<int> colTypes(4);
+    colNames[0] = "id"; colTypes[0] = cxxPack::FrameColumn::COLTYPE_INT;
+    colNames[1] = "amount"; colTypes[1] = cxxPack::FrameColumn::COLTYPE_DOUBLE;
+    colNames[2] = "name"; colTypes[2] = cxxPack::FrameColumn::COLTYPE_STRING;
+    colNames[3] = "date"; colTypes[3] = cxxPack::FrameColumn::COLTYPE_FINDATE;
+    for(int i=0; i < nrow; ++i)
+	rowNames[i] = "r" + cxxPack::to_string(i+1);
+    cxxPack::DataFrame df(rowNames, colNames, colTypes);
+    cxxPack::FinDate first(cxxPack::Apr, 15, 2010);
+    for(int i=0; i < nrow; ++i) {
+	df["id"].getInt(i) = i+1;
+	df["amount"].getDouble(i) = i+0.5;
+	df["name"].getString(i) = "row" + cxxPack::to_string(i+1);
+	df["date"].getFinDate(i) = first + i;
+    }
+
+    Rcpp::GenericVector result(2);
+    result[0] = df.transferToR();
+    result[1] = Rcpp::wrap(df.numCols());
+    Rcpp::CharacterVector names(2);
+    names[0] = "frame";
+    names[1] = "remaining";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
+
+/**
+ * R interface used by the unit tests: converts frame to a DataFrame, with
+ * the useRcppDate and useFinDatetime flags set as requested (and reset to
+ * false afterwards), and back to R. Returns a list with the new frame and
+ * the types of the FrameColumn's ("Double", "Int", "String", "Factor",
+ * "Logical", "FinDate", "RcppDate", "RcppDatetime" or "FinDatetime").
+ */
+RcppExport SEXP dataFrameRoundTrip_(SEXP frame, SEXP rcppDate,
+				    SEXP finDatetime) {
+    BEGIN_RCPP
+    static const char* typeNames[] = {
+	"Double", "Int", "String", "Factor", "Logical", "FinDate",
+	"RcppDate", "RcppDatetime", "FinDatetime"
+    };
+    struct FlagReset {
+	~FlagReset() {
+	    cxxPack::DataFrame::useRcppDate(false);
+	    cxxPack::DataFrame::useFinDatetime(false);
+	}
+    } reset;
+    cxxPack::DataFrame::useRcppDate(Rcpp::as<bool>(rcppDate));
+    cxxPack::DataFrame::useFinDatetime(Rcpp::as<bool>(finDatetime));
+    cxxPack::DataFrame df(frame);
+
+    int ncol = df.numCols();
+    Rcpp::CharacterVector types(ncol);
+    for(int i = 0; i < ncol; ++i)
+	types[i] = typeNames[df[i].getType()];
+    Rcpp::GenericVector result(2);
+    result[0] = (SEXP)df;
+    result[1] = types;
+    Rcpp::CharacterVector names(2);
+    names[0] = "frame";
+    names[1] = "types";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
+
+/**
+ * R interface used by the unit tests: checks that FrameColumn::adopt()
+ * and FrameColumn::swap() move the data without copying it, and that
+ * copies are deep. Returns list(checks, frame) with the named results of
+ * the checks, and a frame (columns a, b, c and f) built from the
+ * columns.
+ */
+RcppExport SEXP frameColumnOwnership_() {
+    BEGIN_RCPP
+    using cxxPack::FrameColumn;
+    std::vector<std::string> checkNames;
+    std::vector<bool> checks;
+
+    // adopt() takes over the buffer and empties its argument.
+    std::vector<double> doubles(3);
+    doubles[0] = 1.5; doubles[1] = -2; doubles[2] = 4;
+    const double* buffer = &doubles[0];
+    FrameColumn a;
+    a.adopt(doubles);
+    checkNames.push_back("adoptEmpties");
+    checks.push_back(doubles.empty());
+    checkNames.push_back("adoptNoCopy");
+    checks.push_back(a.as<double>().data() == buffer);
+    checkNames.push_back("adoptType");
+    checks.push_back(a.getType() == FrameColumn::COLTYPE_DOUBLE
+		     && a.size() == 3 && a.getDouble(1) == -2);
+
+    // adopt() replaces a column of another type.
+    std::vector<std::string> strings(3, "x");
+    FrameColumn b(strings);
+    std::vector<int> ints(3);
+    ints[0] = 7; ints[1] = 8; ints[2] = 9;
+    const int* intBuffer = &ints[0];
+    b.adopt(ints);
+    checkNames.push_back("adoptReplaces");
+    checks.push_back(b.getType() == FrameColumn::COLTYPE_INT
+		     && b.colString == 0 && b.as<int>().data() == intBuffer);
+
+    // swap() exchanges the buffers and types.
+    a.swap(b);
+    checkNames.push_back("swapTypes");
+    checks.push_back(a.getType() == FrameColumn::COLTYPE_INT
+		     && b.getType() == FrameColumn::COLTYPE_DOUBLE);
+    checkNames.push_back("swapNoCopy");
+    checks.push_back(a.as<int>().data() == intBuffer
+		     && b.as<double>().data() == buffer);
+
+    // Copies (construction and assignment) are deep.
+    FrameColumn c(b);
+    FrameColumn d;
+    d = b;
+    c.getDouble(0) = 100;
+    d.getDouble(0) = 200;
+    checkNames.push_back("copyDeep");
+    checks.push_back(c.as<double>().data() != buffer
+		     && d.as<double>().data() != buffer
+		     && b.getDouble(0) == 1.5 && c.getDouble(0) == 100
+		     && d.getDouble(0) == 200);
+
+    // Factors are adopted by pointer.
+    std::vector<std::string> obs(3);
+    obs[0] = "lo"; obs[1] = "hi"; obs[2] = "lo";
+    cxxPack::Factor* factor = new cxxPack::Factor(obs);
+    FrameColumn f;
+    f.adopt(factor);
+    checkNames.push_back("adoptFactor");
+    checks.push_back(f.getType() == FrameColumn::COLTYPE_FACTOR
+		     && f.colFactor == factor && f.getFactor(1) == "hi");
+
+    std::vector<std::string> rowNames(3), colNames(4);
+    for(int i = 0; i < 3; ++i)
+	rowNames[i] = "r" + cxxPack::to_string(i+1);
+    colNames[0] = "a"; colNames[1] = "b"; colNames[2] = "c";
+    colNames[3] = "f";
+    std::vector<FrameColumn> cols(4);
+    cols[0].swap(a);
+    cols[1].swap(b);
+    cols[2].swap(c);
+    cols[3].swap(f);
+    cxxPack::DataFrame frame(rowNames, colNames, cols);
+
+    int n = checks.size();
+    Rcpp::LogicalVector checkValues(n);
+    Rcpp::CharacterVector names(n);
+    for(int i = 0; i < n; ++i) {
+	checkValues[i] = checks[i];
+	names[i] = checkNames[i];
+    }
+    checkValues.attr("names") = names;
+    Rcpp::GenericVector result(2);
+    result[0] = checkValues;
+    result[1] = (SEXP)frame;
+    Rcpp::CharacterVector resultNames(2);
+    resultNames[0] = "checks";
+    resultNames[1] = "frame";
+    result.attr("names") = resultNames;
+    return result;
+    END_RCPP
+}
+
+// Whether as<T>() and the const as<T>() throw for col.
+template <class T>
+static bool asThrows(cxxPack::FrameColumn& col) {
+    int thrown = 0;
+    try {
+	col.as<T>();
+    }
+    catch(std::range_error&) {
+	thrown++;
+    }
+    try {
+	const cxxPack::FrameColumn& constCol = col;
+	constCol.as<T>();
+    }
+    catch(std::range_error&) {
+	thrown++;
+    }
+    if(thrown == 1)
+	throw std::range_error("asThrows: const and non-const as<T>() differ");
+    return thrown == 2;
+}
+
+// The ColumnKernels results for a column, read through values and then
+// scaled in place through writable (which may be the same storage).
+template <class T, class V>
+static SEXP kernelResults(const cxxPack::ColumnSpan<const T>& values,
+			  const cxxPack::ColumnSpan<T>& writable, T factor,
+			  double value) {
+    int n = values.size();
+    Rcpp::IntegerVector greater(n), less(n);
+    Rcpp::GenericVector result(6);
+    result[0] = Rcpp::wrap(cxxPack::ColumnKernels::sum(values));
+    result[2] = Rcpp::wrap(cxxPack::ColumnKernels::greater(values, value,
+							    INTEGER(greater)));
+    result[1] = greater;
+    result[4] = Rcpp::wrap(cxxPack::ColumnKernels::less(values, value,
+							 INTEGER(less)));
+    result[3] = less;
+    cxxPack::ColumnKernels::scale(writable, factor);
+    V scaled(n);
+    for(int i = 0; i < n; ++i)
+	scaled[i] = writable[i];
+    result[5] = scaled;
+    Rcpp::CharacterVector names(6);
+    names[0] = "sum";
+    names[1] = "greater";
+    names[2] = "greaterCount";
+    names[3] = "less";
+    names[4] = "lessCount";
+    names[5] = "scaled";
+    result.attr("names") = names;
+    return result;
+}
+
+/**
+ * R interface used by the unit tests, for the double or integer column
+ * name of frame. Returns a list with
+ *
+ * - mismatch: for each of the types int, double, string, FinDate,
+ *   RcppDate, RcppDatetime and FinDatetime, whether FrameColumn::as<T>()
+ *   (and the const version) throws.
+ * - cover: the spans of the FrameColumn (const and non-const) cover the
+ *   whole column.
+ * - frame, view: the sum of the column, greater() and less() than value
+ *   (the flags and their counts), and the values multiplied by factor
+ *   with scale(), using the spans of a DataFrame and of a DataFrameView.
+ */
+RcppExport SEXP columnKernels_(SEXP frame, SEXP name, SEXP factor,
+			       SEXP value) {
+    BEGIN_RCPP
+    using cxxPack::FrameColumn;
+    using cxxPack::ColumnSpan;
+    std::string colName = Rcpp::as<std::string>(name);
+    double v = Rcpp::as<double>(value);
+    cxxPack::DataFrame df(frame);
+    cxxPack::DataFrameView view(frame);
+    FrameColumn& col = df[colName];
+    const FrameColumn& constCol = col;
+    int j = view.getColIndex(colName);
+    int n = df.numRows();
+
+    Rcpp::LogicalVector mismatch(7);
+    mismatch[0] = asThrows<int>(col);
+    mismatch[1] = asThrows<double>(col);
+    mismatch[2] = asThrows<std::string>(col);
+    mismatch[3] = asThrows<cxxPack::FinDate>(col);
+    mismatch[4] = asThrows<RcppDate>(col);
+    mismatch[5] = asThrows<RcppDatetime>(col);
+    mismatch[6] = asThrows<cxxPack::FinDatetime>(col);
+    Rcpp::CharacterVector typeNames(7);
+    typeNames[0] = "int";
+    typeNames[1] = "double";
+    typeNames[2] = "string";
+    typeNames[3] = "FinDate";
+    typeNames[4] = "RcppDate";
+    typeNames[5] = "RcppDatetime";
+    typeNames[6] = "FinDatetime";
+    mismatch.attr("names") = typeNames;
+
+    Rcpp::GenericVector result(4);
+    bool cover = true;
+    if(col.getType() == FrameColumn::COLTYPE_DOUBLE) {
+	ColumnSpan<double> span = col.as<double>();
+	ColumnSpan<const double> constSpan = constCol.as<double>();
+	cover = span.size() == n && constSpan.size() == n
+	    && span.end() - span.begin() == n && constSpan.data() == span.data();
+	for(int i = 0; i < n && cover; ++i)
+	    cover = span[i] == col.getDouble(i) && &span[i] == &col.getDouble(i);
+	result[2] = kernelResults<double, Rcpp::NumericVector>(
+	    constSpan, span, Rcpp::as<double>(factor), v);
+	result[3] = kernelResults<double, Rcpp::NumericVector>(
+	    view.getDoubles(j), view.mutableDoubles(j),
+	    Rcpp::as<double>(factor), v);
+    }
+    else if(col.getType() == FrameColumn::COLTYPE_INT) {
+	ColumnSpan<int> span = col.as<int>();
+	ColumnSpan<const int> constSpan = constCol.as<int>();
+	cover = span.size() == n && constSpan.size() == n
+	    && span.end() - span.begin() == n && constSpan.data() == span.data();
+	for(int i = 0; i < n && cover; ++i)
+	    cover = span[i] == col.getInt(i) && &span[i] == &col.getInt(i);
+	result[2] = kernelResults<int, Rcpp::IntegerVector>(
+	    constSpan, span, Rcpp::as<int>(factor), v);
+	result[3] = kernelResults<int, Rcpp::IntegerVector>(
+	    view.getInts(j), view.mutableInts(j), Rcpp::as<int>(factor), v);
+    }
+    else
+	throw std::range_error("columnKernels_: not a double or integer column");
+
+    result[0] = mismatch;
+    result[1] = Rcpp::wrap(cover);
+    Rcpp::CharacterVector names(4);
+    names[0] = "mismatch";
+    names[1] = "cover";
+    names[2] = "frame";
+    names[3] = "view";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
@@ -0,0 +1,294 @@
+// DataFrameView.cpp: read-only view of an R data frame without copies
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdexcept>
+
+#include <DataFrameView.hpp>
+
+namespace cxxPack {
+
+DataFrameView::DataFrameView(SEXP df) : frame(df), nrow(0) {
+
+    Rcpp::RObject frameObject(df);
+
+    // Check class.
+    SEXP classAttr = frameObject.attr("class");
+    if(classAttr == R_NilValue
+       || std::string(Rcpp::CharacterVector(classAttr)[0]) != "data.frame")
+	throw std::range_error("Invalid class in DataFrameView constr");
+
+    // Get column names.
+    Rcpp::CharacterVector columnNames = frameObject.attr("names");
+    int ncol = columnNames.size();
+    colNames.resize(ncol);
+    for(int j=0; j < ncol; ++j)
+	colNames[j] = columnNames(j);
+
+    // The row count comes from the first column (the row.names attribute
+    // would be expanded by R for compact row names).
+    if(ncol > 0)
+	nrow = Rf_length(VECTOR_ELT(df, 0));
+
+    cols.resize(ncol);
+    for(int j=0; j < ncol; ++j) {
+	Column& col = cols[j];
+	col.sexp = VECTOR_ELT(df, j);
+	col.doubles = 0;
+	col.ints = 0;
+	col.copied = false;
+	if(Rf_length(col.sexp) != nrow)
+	    throw std::range_error("Inconsistent column lengths in DataFrameView constr");
+
+	bool isDateClass = false, isPOSIXDate = false;
+	SEXP colClass = Rf_getAttrib(col.sexp, R_ClassSymbol);
+	if(colClass != R_NilValue) {
+	    Rcpp::CharacterVector cv(colClass);
+	    std::string cls = std::string(cv[0]);
+	    isDateClass = cls == "Date";
+	    isPOSIXDate = cls.substr(0,5) == "POSIX";
+	}
+
+	if(Rf_isReal(col.sexp)) {
+	    col.doubles = REAL(col.sexp);
+	    if(isDateClass)
+		col.type = FrameColumn::COLTYPE_FINDATE;
+	    else if(isPOSIXDate)
+		col.type = FrameColumn::COLTYPE_RCPPDATETIME;
+	    else
+		col.type = FrameColumn::COLTYPE_DOUBLE;
+	}
+	else if(Rf_isFactor(col.sexp)) {
+	    col.ints = INTEGER(col.sexp);
+	    col.type = FrameColumn::COLTYPE_FACTOR;
+	    Rcpp::CharacterVector cv(Rf_getAttrib(col.sexp, R_LevelsSymbol));
+	    col.levels.resize(cv.size());
+	    for(int k=0; k < cv.size(); ++k)
+		col.levels[k] = cv(k);
+	}
+	else if(Rf_isInteger(col.sexp)) {
+	    col.ints = INTEGER(col.sexp);
+	    col.type = isDateClass ? FrameColumn::COLTYPE_FINDATE
+		: FrameColumn::COLTYPE_INT;
+	}
+	else if(Rf_isLogical(col.sexp)) {
+	    col.ints = LOGICAL(col.sexp);
+	    col.type = FrameColumn::COLTYPE_LOGICAL;
+	}
+	else if(Rf_isString(col.sexp)) {
+	    col.type = FrameColumn::COLTYPE_STRING;
+	}
+	else
+	    throw std::range_error("DataFrameView constr unsupported data frame column type.");
+    }
+
+    R_PreserveObject(frame);
+}
+
+DataFrameView::~DataFrameView() {
+    R_ReleaseObject(frame);
+}
+
+const DataFrameView::Column& DataFrameView::column(int j) const {
+    if(j < 0 || j >= (int)cols.size())
+	throw std::range_error("Column index out of range in DataFrameView");
+    return cols[j];
+}
+
+int DataFrameView::getColIndex(const std::string& name) const {
+    for(int j=0; j < (int)colNames.size(); ++j)
+	if(colNames[j] == name)
+	    return j;
+    throw std::range_error("Invalid column name in DataFrameView: " + name);
+}
+
+ColumnSpan<const double> DataFrameView::getDoubles(int j) const {
+    const Column& col = column(j);
+    if(col.doubles == 0)
+	throw std::range_error("DataFrameView: column " + colNames[j]
+			       + " is not stored as double");
+    return ColumnSpan<const double>(col.doubles, nrow);
+}
+
+ColumnSpan<const int> DataFrameView::getInts(int j) const {
+    const Column& col = column(j);
+    if(col.ints == 0)
+	throw std::range_error("DataFrameView: column " + colNames[j]
+			       + " is not stored as integer");
+    return ColumnSpan<const int>(col.ints, nrow);
+}
+
+ColumnSpan<double> DataFrameView::mutableDoubles(int j) {
+    ColumnSpan<const double> values = getDoubles(j);
+    Column& col = cols[j];
+    if(!col.copied) {
+	col.ownDoubles.assign(values.begin(), values.end());
+	col.doubles = nrow > 0 ? &col.ownDoubles[0] : col.doubles;
+	col.copied = true;
+    }
+    return ColumnSpan<double>(nrow > 0 ? &col.ownDoubles[0] : 0, nrow);
+}
+
+ColumnSpan<int> DataFrameView::mutableInts(int j) {
+    ColumnSpan<const int> values = getInts(j);
+    Column& col = cols[j];
+    if(!col.copied) {
+	col.ownInts.assign(values.begin(), values.end());
+	col.ints = nrow > 0 ? &col.ownInts[0] : col.ints;
+	col.copied = true;
+    }
+    return ColumnSpan<int>(nrow > 0 ? &col.ownInts[0] : 0, nrow);
+}
+
+FinDate DataFrameView::getFinDate(int i, int j) const {
+    const Column& col = column(j);
+    if(col.type != FrameColumn::COLTYPE_FINDATE)
+	throw std::range_error("DataFrameView: column " + colNames[j]
+			       + " is not a Date column");
+    if(i < 0 || i >= nrow)
+	throw std::range_error("Row index out of range in DataFrameView");
+    return FinDate(col.doubles != 0 ? (int)col.doubles[i] : col.ints[i]);
+}
+
+std::string DataFrameView::getString(int i, int j) const {
+    const Column& col = column(j);
+    if(i < 0 || i >= nrow)
+	throw std::range_error("Row index out of range in DataFrameView");
+    if(col.type == FrameColumn::COLTYPE_STRING)
+	return CHAR(STRING_ELT(col.sexp, i));
+    if(col.type == FrameColumn::COLTYPE_FACTOR) {
+	int level = col.ints[i];
+	if(level < 1 || level > (int)col.levels.size())
+	    throw std::range_error("DataFrameView: factor value is NA or out of range");
+	return col.levels[level-1];
+    }
+    throw std::range_error("DataFrameView: column " + colNames[j]
+			   + " is not a string or factor column");
+}
+
+const std::vector<std::string>& DataFrameView::getLevels(int j) const {
+    const Column& col = column(j);
+    if(col.type != FrameColumn::COLTYPE_FACTOR)
+	throw std::range_error("DataFrameView: column " + colNames[j]
+			       + " is not a factor");
+    return col.levels;
+}
+
+} // end cxxPack namespace
+
+// Copies a span to a new R vector.
+template <class V, class T>
+static SEXP spanToR(const cxxPack::ColumnSpan<T>& span) {
+    V out(span.size());
+    for(int i = 0; i < span.size(); ++i)
+	out[i] = span[i];
+    return out;
+}
+
+/**
+ * R interface used by the unit tests. For each column j of frame returns
+ * a list with its type ("Double", "Int", "String", "Factor", "Logical",
+ * "FinDate" or "RcppDatetime"), the values read through the view
+ * (doubles, ints, strings, levels and dates, each NULL where it does not
+ * apply), and for columns stored as doubles or integers:
+ *
+ * - shared: the span was R's storage before mutableDoubles() or
+ *   mutableInts() was called.
+ * - mutated: the values read back after adding delta to each one of
+ *   the mutable span.
+ * - copiedOnce: a second call gave the same copy, and isCopied() is true.
+ */
+RcppExport SEXP dataFrameView_(SEXP frame, SEXP delta) {
+    BEGIN_RCPP
+    using cxxPack::FrameColumn;
+    using cxxPack::ColumnSpan;
+    static const char* typeNames[] = {
+	"Double", "Int", "String", "Factor", "Logical", "FinDate",
+	"RcppDate", "RcppDatetime", "FinDatetime"
+    };
+    static const char* fieldNames[] = {
+	"type", "doubles", "ints", "strings", "levels", "dates", "shared",
+	"mutated", "copiedOnce"
+    };
+    const int numFields = 9;
+    double d = Rcpp::as<double>(delta);
+    cxxPack::DataFrameView view(frame);
+    int nrow = view.numRows(), ncol = view.numCols();
+    Rcpp::GenericVector result(ncol);
+    for(int j = 0; j < ncol; ++j) {
+	FrameColumn::ColType type = view.getType(j);
+	SEXP sexp = VECTOR_ELT(frame, j);
+	Rcpp::GenericVector col(numFields);
+	Rcpp::CharacterVector names(numFields);
+	for(int f = 0; f < numFields; ++f) {
+	    names[f] = fieldNames[f];
+	    col[f] = R_NilValue;
+	}
+	col[0] = std::string(typeNames[type]);
+	if(type == FrameColumn::COLTYPE_STRING
+	   || type == FrameColumn::COLTYPE_FACTOR) {
+	    Rcpp::CharacterVector strings(nrow);
+	    for(int i = 0; i < nrow; ++i)
+		strings[i] = view.getString(i, j);
+	    col[3] = strings;
+	}
+	if(type == FrameColumn::COLTYPE_FACTOR) {
+	    const std::vector<std::string>& levels = view.getLevels(j);
+	    Rcpp::CharacterVector levelNames(levels.size());
+	    for(int k = 0; k < (int)levels.size(); ++k)
+		levelNames[k] = levels[k];
+	    col[4] = levelNames;
+	}
+	if(type == FrameColumn::COLTYPE_FINDATE) {
+	    Rcpp::NumericVector dates(nrow);
+	    for(int i = 0; i < nrow; ++i)
+		dates[i] = view.getFinDate(i, j).getRValue();
+	    col[5] = dates;
+	}
+	if(Rf_isReal(sexp)) {
+	    ColumnSpan<const double> values = view.getDoubles(j);
+	    col[1] = spanToR<Rcpp::NumericVector>(values);
+	    col[6] = Rcpp::wrap(values.data() == REAL(sexp));
+	    ColumnSpan<double> copy = view.mutableDoubles(j);
+	    for(int i = 0; i < nrow; ++i)
+		copy[i] += d;
+	    ColumnSpan<const double> after = view.getDoubles(j);
+	    col[7] = spanToR<Rcpp::NumericVector>(after);
+	    col[8] = Rcpp::wrap(view.mutableDoubles(j).data() == copy.data()
+				&& after.data() == copy.data()
+				&& view.isCopied(j));
+	}
+	else if(type != FrameColumn::COLTYPE_STRING) {
+	    ColumnSpan<const int> values = view.getInts(j);
+	    col[2] = spanToR<Rcpp::IntegerVector>(values);
+	    const int* storage = Rf_isLogical(sexp) ? LOGICAL(sexp)
+		: INTEGER(sexp);
+	    col[6] = Rcpp::wrap(values.data() == storage);
+	    ColumnSpan<int> copy = view.mutableInts(j);
+	    for(int i = 0; i < nrow; ++i)
+		copy[i] += (int)d;
+	    ColumnSpan<const int> after = view.getInts(j);
+	    col[7] = spanToR<Rcpp::IntegerVector>(after);
+	    col[8] = Rcpp::wrap(view.mutableInts(j).data() == copy.data()
+				&& after.data() == copy.data()
+				&& view.isCopied(j));
+	}
+	col.attr("names") = names;
+	result[j] = col;
+    }
+    result.attr("names") = Rcpp::wrap(view.getColNames());
+    return result;
+    END_RCPP
+}
@@ -0,0 +1,446 @@
+// DateIO.cpp: fast date parsing and formatting
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <climits>
+#include <cstring>
+#include <cmath>
+
+#include <DateIO.hpp>
+
+namespace cxxPack {
+
+const int DateIO::badJdn = INT_MIN;
+
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Reads between minDigits and maxDigits digits starting at s, advancing
+// s. Returns -1 if there are too few or too many digits.
+static inline int readNumber(const char*& s, const char* end,
+			     int minDigits, int maxDigits) {
+    int value = 0, digits = 0;
+    while(s < end && isDigit(*s)) {
+	if(++digits > maxDigits)
+	    return -1;
+	value = 10*value + (*s++ - '0');
+    }
+    return digits < minDigits ? -1 : value;
+}
+
+// Weekday abbreviations, 3 characters each, indexed by (jdn+1) % 7.
+static const char weekdayAbbrev[] = "SunMonTueWedThuFriSat";
+
+static inline int weekdayOf(int jdn) {
+    int weekday = (jdn+1) % 7;
+    return weekday < 0 ? weekday + 7 : weekday;
+}
+
+static inline bool validMDY(int m, int d, int y) {
+    return m >= 1 && m <= 12 && d >= 1 && d <= FinDate::daysInMonth(m, y);
+}
+
+bool DateIO::parse(const char* s, const char* end, int& jdn,
+		   DateFormat fmt) {
+    while(s < end && isBlank(*s))
+	s++;
+    while(end > s && isBlank(end[-1]))
+	end--;
+    const char* weekdayName = 0;
+    if(fmt == WeekdayUSFormat) { // checked against the date below
+	if(end - s < 4 || s[3] != ' ')
+	    return false;
+	weekdayName = s;
+	s += 4;
+	fmt = USFormat;
+    }
+    if(end - s < 8) // shortest is 1/1/2010
+	return false;
+    if(fmt == AnyFormat)
+	fmt = (s[4] == '-') ? ISOFormat : USFormat;
+    int m, d, y;
+    if(fmt == ISOFormat) {
+	if(end - s != 10 || s[4] != '-' || s[7] != '-')
+	    return false;
+	y = readNumber(s, end, 4, 4); s++;
+	m = readNumber(s, end, 2, 2); s++;
+	d = readNumber(s, end, 2, 2);
+    }
+    else {
+	m = readNumber(s, end, 1, 2);
+	if(m < 0 || s == end || *s++ != '/')
+	    return false;
+	d = readNumber(s, end, 1, 2);
+	if(d < 0 || s == end || *s++ != '/')
+	    return false;
+	y = readNumber(s, end, 4, 4);
+    }
+    if(s != end || y < 0 || m < 0 || d < 0 || !validMDY(m, d, y))
+	return false;
+    int result = FinDate::mdy2jdn(m, d, y);
+    if(weekdayName != 0
+       && std::memcmp(weekdayName, weekdayAbbrev + 3*weekdayOf(result), 3) != 0)
+	return false;
+    jdn = result;
+    return true;
+}
+
+int DateIO::countRows(const char* buf, std::size_t len, char delim) {
+    if(len == 0)
+	return 0;
+    int rows = 1;
+    for(const char* p = buf; (p = (const char*)std::memchr(p, delim,
+					buf+len-p)) != 0; ++p)
+	rows++;
+    if(buf[len-1] == delim)
+	rows--;
+    return rows;
+}
+
+// Common loop for the batch parsers. Stops at the first bad row when
+// badRows is null, otherwise records it.
+static int parseRows(const char* buf, std::size_t len, char delim,
+		     int* out, int maxRows, std::vector<int>* badRows,
+		     DateIO::DateFormat fmt) {
+    const char* end = buf + len;
+    const char* field = buf;
+    int row = 0;
+    while(field < end) {
+	const char* stop = (const char*)std::memchr(field, delim, end-field);
+	if(stop == 0)
+	    stop = end;
+	if(row >= maxRows)
+	    throw std::range_error("DateIO::parse: more than "
+				   + to_string(maxRows) + " rows");
+	if(!DateIO::parse(field, stop, out[row], fmt)) {
+	    if(badRows == 0)
+		throw std::range_error("DateIO::parse: invalid date in row "
+				       + to_string(row) + ": "
+				       + std::string(field, stop));
+	    out[row] = DateIO::badJdn;
+	    badRows->push_back(row);
+	}
+	row++;
+	field = stop+1;
+    }
+    return row;
+}
+
+int DateIO::parse(const char* buf, std::size_t len, char delim,
+		  int* out, int maxRows, DateFormat fmt) {
+    return parseRows(buf, len, delim, out, maxRows, 0, fmt);
+}
+
+int DateIO::parse(const char* buf, std::size_t len, char delim,
+		  int* out, int maxRows, std::vector<int>& badRows,
+		  DateFormat fmt) {
+    return parseRows(buf, len, delim, out, maxRows, &badRows, fmt);
+}
+
+std::vector<int> DateIO::parse(const std::string& buf, char delim,
+			       DateFormat fmt) {
+    std::vector<int> jdns(countRows(buf.data(), buf.size(), delim));
+    if(jdns.size() > 0)
+	parse(buf.data(), buf.size(), delim, &jdns[0], (int)jdns.size(), fmt);
+    return jdns;
+}
+
+// Writes n >= 0 with at least width digits (zero padded), returns the
+// position after the last digit.
+static inline char* putNumber(char* p, int n, int width) {
+    char digits[12];
+    int len = 0;
+    do {
+	digits[len++] = (char)('0' + n % 10);
+	n /= 10;
+    } while(n > 0);
+    while(len < width)
+	digits[len++] = '0';
+    while(len > 0)
+	*p++ = digits[--len];
+    return p;
+}
+
+static inline char* putYear(char* p, int year, int width) {
+    if(year < 0) {
+	*p++ = '-';
+	year = -year;
+    }
+    return putNumber(p, year, width);
+}
+
+static char* putDate(char* p, int jdn, DateIO::DateFormat fmt) {
+    DateMDY mdy = FinDate::jdn2mdy(jdn);
+    switch(fmt) {
+    case DateIO::WeekdayUSFormat: {
+	std::memcpy(p, weekdayAbbrev + 3*weekdayOf(jdn), 3);
+	p[3] = ' ';
+	p += 4;
+	p = putNumber(p, mdy.month, 1);
+	*p++ = '/';
+	p = putNumber(p, mdy.day, 1);
+	*p++ = '/';
+	return putYear(p, mdy.year, 1);
+    }
+    case DateIO::USFormat:
+	p = putNumber(p, mdy.month, 2);
+	*p++ = '/';
+	p = putNumber(p, mdy.day, 2);
+	*p++ = '/';
+	return putYear(p, mdy.year, 4);
+    default: // ISO
+	p = putYear(p, mdy.year, 4);
+	*p++ = '-';
+	p = putNumber(p, mdy.month, 2);
+	*p++ = '-';
+	return putNumber(p, mdy.day, 2);
+    }
+}
+
+static char* putDatetime(char* p, double secs, DateIO::DateFormat fmt) {
+    if(!(std::fabs(secs) < 1.0e14)) // also catches NaN
+	throw std::range_error("DateIO::formatDatetime: time out of range");
+    double whole = std::floor(secs);
+    double micros = std::floor((secs - whole)*1.0e6 + 0.5);
+    if(micros >= 1.0e6) {
+	whole += 1;
+	micros -= 1.0e6;
+    }
+    double days = std::floor(whole/86400.0);
+    int daySecs = (int)(whole - 86400.0*days);
+    p = putDate(p, (int)days + FinDate::R_Offset, fmt);
+    *p++ = ' ';
+    p = putNumber(p, daySecs/3600, 2);
+    *p++ = ':';
+    p = putNumber(p, daySecs/60 % 60, 2);
+    *p++ = ':';
+    p = putNumber(p, daySecs % 60, 2);
+    *p++ = '.';
+    return putNumber(p, (int)micros, 6);
+}
+
+static char* putNanos(char* p, int64_t nanos, DateIO::DateFormat fmt) {
+    const int64_t nanosPerDay = (int64_t)86400*1000000000;
+    int64_t days = nanos / nanosPerDay;
+    int64_t dayNanos = nanos % nanosPerDay;
+    if(dayNanos < 0) {
+	days--;
+	dayNanos += nanosPerDay;
+    }
+    int daySecs = (int)(dayNanos / 1000000000);
+    p = putDate(p, (int)days + FinDate::R_Offset, fmt);
+    *p++ = ' ';
+    p = putNumber(p, daySecs/3600, 2);
+    *p++ = ':';
+    p = putNumber(p, daySecs/60 % 60, 2);
+    *p++ = ':';
+    p = putNumber(p, daySecs % 60, 2);
+    *p++ = '.';
+    return putNumber(p, (int)(dayNanos % 1000000000), 9);
+}
+
+int DateIO::format(int jdn, char* buf, DateFormat fmt) {
+    char* end = putDate(buf, jdn, fmt);
+    *end = '\0';
+    return (int)(end - buf);
+}
+
+int DateIO::formatDatetime(double secs, char* buf, DateFormat fmt) {
+    char* end = putDatetime(buf, secs, fmt);
+    *end = '\0';
+    return (int)(end - buf);
+}
+
+int DateIO::formatNanos(int64_t nanos, char* buf, DateFormat fmt) {
+    char* end = putNanos(buf, nanos, fmt);
+    *end = '\0';
+    return (int)(end - buf);
+}
+
+std::size_t DateIO::format(const int* jdns, int n, char* buf,
+			   DateFormat fmt, char sep) {
+    char* p = buf;
+    for(int i = 0; i < n; ++i) {
+	p = putDate(p, jdns[i], fmt);
+	*p++ = sep;
+    }
+    return p - buf;
+}
+
+std::size_t DateIO::formatDatetime(const double* secs, int n, char* buf,
+				   DateFormat fmt, char sep) {
+    char* p = buf;
+    for(int i = 0; i < n; ++i) {
+	p = putDatetime(p, secs[i], fmt);
+	*p++ = sep;
+    }
+    return p - buf;
+}
+
+} // end cxxPack namespace
+
+namespace {
+
+    cxxPack::DateIO::DateFormat dateFormatFor(const std::string& name) {
+	if(name == "Any")
+	    return cxxPack::DateIO::AnyFormat;
+	if(name == "ISO")
+	    return cxxPack::DateIO::ISOFormat;
+	if(name == "US")
+	    return cxxPack::DateIO::USFormat;
+	if(name == "WeekdayUS")
+	    return cxxPack::DateIO::WeekdayUSFormat;
+	throw std::range_error("invalid date format: " + name);
+    }
+
+}
+
+/**
+ * R interface used by the unit tests: parse the fields of text separated
+ * by delim (a single character) in format ("Any", "ISO", "US" or
+ * "WeekdayUS"). With strict, the parse() that throws on the first bad
+ * row is used, else bad rows are NA. maxRows < 0 means countRows().
+ * Returns a list with the number of rows from countRows() (rows), the R
+ * dates (dates) and the 1-based bad rows (bad).
+ */
+RcppExport SEXP dateParse_(SEXP text, SEXP delim, SEXP format, SEXP strict,
+			   SEXP maxRows) {
+    BEGIN_RCPP
+    using cxxPack::DateIO;
+    std::string buf = Rcpp::as<std::string>(text);
+    std::string sep = Rcpp::as<std::string>(delim);
+    if(sep.size() != 1)
+	throw std::range_error("dateParse_: delim must be one character");
+    DateIO::DateFormat fmt = dateFormatFor(Rcpp::as<std::string>(format));
+    int rows = DateIO::countRows(buf.data(), buf.size(), sep[0]);
+    int limit = Rcpp::as<int>(maxRows);
+    if(limit < 0)
+	limit = rows;
+    std::vector<int> jdns(limit > 0 ? limit : 1);
+    std::vector<int> badRows;
+    int n;
+    if(Rcpp::as<bool>(strict))
+	n = DateIO::parse(buf.data(), buf.size(), sep[0], &jdns[0], limit, fmt);
+    else
+	n = DateIO::parse(buf.data(), buf.size(), sep[0], &jdns[0], limit,
+			  badRows, fmt);
+
+    Rcpp::NumericVector dates(n);
+    for(int i = 0; i < n; ++i)
+	dates[i] = jdns[i] == DateIO::badJdn ? NA_REAL
+	    : jdns[i] - cxxPack::FinDate::R_Offset;
+    Rcpp::IntegerVector bad(badRows.size());
+    for(std::size_t i = 0; i < badRows.size(); ++i)
+	bad[i] = badRows[i] + 1;
+
+    Rcpp::GenericVector result(3);
+    result[0] = Rcpp::wrap(rows);
+    result[1] = dates;
+    result[2] = bad;
+    Rcpp::CharacterVector names(3);
+    names[0] = "rows";
+    names[1] = "dates";
+    names[2] = "bad";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
+
+/**
+ * R interface used by the unit tests: the R dates and the datetimes secs
+ * (POSIXct) written in format by the single and the batch versions of
+ * DateIO::format() and DateIO::formatDatetime(). Returns a list with the
+ * strings (date, dateBatch, datetime, datetimeBatch), the lengths
+ * returned by the single versions (dateLength, datetimeLength) and, for
+ * ISO and US, the dates read at buf + 11*i from the batch written with
+ * sep = '\0' (fixed).
+ */
+RcppExport SEXP dateFormat_(SEXP dates, SEXP secs, SEXP format) {
+    BEGIN_RCPP
+    using cxxPack::DateIO;
+    DateIO::DateFormat fmt = dateFormatFor(Rcpp::as<std::string>(format));
+    Rcpp::NumericVector d(dates), s(secs);
+    int n = d.size(), m = s.size();
+    std::vector<int> jdns(n);
+    for(int i = 0; i < n; ++i)
+	jdns[i] = (int)d[i] + cxxPack::FinDate::R_Offset;
+    char buf[DateIO::maxDateLength];
+
+    Rcpp::CharacterVector date(n), datetime(m);
+    Rcpp::IntegerVector dateLength(n), datetimeLength(m);
+    for(int i = 0; i < n; ++i) {
+	dateLength[i] = DateIO::format(jdns[i], buf, fmt);
+	date[i] = std::string(buf);
+    }
+    for(int i = 0; i < m; ++i) {
+	datetimeLength[i] = DateIO::formatDatetime(s[i], buf, fmt);
+	datetime[i] = std::string(buf);
+    }
+
+    // The batch output is split at the newlines.
+    std::vector<char> batch((n > m ? n : m)*DateIO::maxDateLength + 1);
+    Rcpp::CharacterVector dateBatch(n), datetimeBatch(m), fixed(0);
+    std::size_t len = 0;
+    if(n > 0)
+	len = DateIO::format(&jdns[0], n, &batch[0], fmt);
+    const char* p = &batch[0];
+    for(int i = 0; i < n; ++i) {
+	const char* stop = (const char*)std::memchr(p, '\n',
+						    &batch[0] + len - p);
+	dateBatch[i] = std::string(p, stop);
+	p = stop + 1;
+    }
+    len = 0;
+    if(m > 0)
+	len = DateIO::formatDatetime(REAL(s), m, &batch[0], fmt);
+    p = &batch[0];
+    for(int i = 0; i < m; ++i) {
+	const char* stop = (const char*)std::memchr(p, '\n',
+						    &batch[0] + len - p);
+	datetimeBatch[i] = std::string(p, stop);
+	p = stop + 1;
+    }
+    if(n > 0 && (fmt == DateIO::ISOFormat || fmt == DateIO::USFormat)) {
+	DateIO::format(&jdns[0], n, &batch[0], fmt, '\0');
+	fixed = Rcpp::CharacterVector(n);
+	for(int i = 0; i < n; ++i)
+	    fixed[i] = std::string(&batch[11*i]);
+    }
+
+    Rcpp::GenericVector result(7);
+    result[0] = date;
+    result[1] = dateBatch;
+    result[2] = dateLength;
+    result[3] = datetime;
+    result[4] = datetimeBatch;
+    result[5] = datetimeLength;
+    result[6] = fixed;
+    Rcpp::CharacterVector names(7);
+    names[0] = "date";
+    names[1] = "dateBatch";
+    names[2] = "dateLength";
+    names[3] = "datetime";
+    names[4] = "datetimeBatch";
+    names[5] = "datetimeLength";
+    names[6] = "fixed";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
@@ -0,0 +1,271 @@
+// DayCount.cpp: batch day count calculations
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <DayCount.hpp>
+
+namespace cxxPack {
+
+template <FinEnum::DayCountConvention DC>
+static void countDays(const int* start, const int* end, int n, int* out) {
+    for(int i = 0; i < n; ++i)
+	out[i] = DayCountPolicy<DC>::days(start[i], end[i]);
+}
+
+template <FinEnum::DayCountConvention DC>
+static void countFrac(const int* start, const int* end, int n,
+		      const int* extraDays, double* out) {
+    if(extraDays == 0)
+	for(int i = 0; i < n; ++i)
+	    out[i] = DayCountPolicy<DC>::yearFrac(start[i], end[i]);
+    else
+	for(int i = 0; i < n; ++i)
+	    out[i] = DayCountPolicy<DC>::yearFrac(start[i], end[i],
+						  extraDays[i]);
+}
+
+// Validates a batch for yearFrac() before anything is written.
+static void checkPeriods(const int* start, const int* end, int n,
+			 const double* out) {
+    if(n > 0 && (start == 0 || end == 0 || out == 0))
+	throw std::range_error("DayCount::yearFrac: null array");
+    for(int i = 0; i < n; ++i)
+	if(start[i] >= end[i])
+	    throw std::range_error("DayCount::yearFrac: start >= end at index "
+				   + to_string(i));
+}
+
+void DayCount::diffDays(const int* start, const int* end, int n,
+			FinEnum::DayCountConvention dc, int* out) {
+    if(n > 0 && (start == 0 || end == 0 || out == 0))
+	throw std::range_error("DayCount::diffDays: null array");
+    switch(dc) {
+    case FinEnum::DCA360NL:
+    case FinEnum::DCA365NL:
+	countDays<FinEnum::DCA365NL>(start, end, n, out);
+	break;
+    case FinEnum::DC30360I:
+	countDays<FinEnum::DC30360I>(start, end, n, out);
+	break;
+    case FinEnum::DC30360E:
+	countDays<FinEnum::DC30360E>(start, end, n, out);
+	break;
+    case FinEnum::DC30360P1:
+	countDays<FinEnum::DC30360P1>(start, end, n, out);
+	break;
+    case FinEnum::DC30360P2:
+	countDays<FinEnum::DC30360P2>(start, end, n, out);
+	break;
+    case FinEnum::DCB252:
+	countDays<FinEnum::DCB252>(start, end, n, out);
+	break;
+    default: // DCAA, DCA360, DCA365, DCA252
+	countDays<FinEnum::DCA365>(start, end, n, out);
+	break;
+    }
+}
+
+void DayCount::yearFrac(const int* start, const int* end, int n,
+			FinEnum::DayCountConvention dc, double* out,
+			const int* extraDays) {
+    checkPeriods(start, end, n, out);
+    switch(dc) {
+    case FinEnum::DCAA:
+	countFrac<FinEnum::DCAA>(start, end, n, extraDays, out);
+	break;
+    case FinEnum::DCA365:
+	countFrac<FinEnum::DCA365>(start, end, n, extraDays, out);
+	break;
+    case FinEnum::DCA252:
+	countFrac<FinEnum::DCA252>(start, end, n, extraDays, out);
+	break;
+    case FinEnum::DCA360NL:
+	countFrac<FinEnum::DCA360NL>(start, end, n, extraDays, out);
+	break;
+    case FinEnum::DCA365NL:
+	countFrac<FinEnum::DCA365NL>(start, end, n, extraDays, out);
+	break;
+    case FinEnum::DC30360I:
+	countFrac<FinEnum::DC30360I>(start, end, n, extraDays, out);
+	break;
+    case FinEnum::DC30360E:
+	countFrac<FinEnum::DC30360E>(start, end, n, extraDays, out);
+	break;
+    case FinEnum::DC30360P1:
+	countFrac<FinEnum::DC30360P1>(start, end, n, extraDays, out);
+	break;
+    case FinEnum::DC30360P2:
+	countFrac<FinEnum::DC30360P2>(start, end, n, extraDays, out);
+	break;
+    case FinEnum::DCB252:
+	countFrac<FinEnum::DCB252>(start, end, n, extraDays, out);
+	break;
+    case FinEnum::DCA360:
+    default:
+	countFrac<FinEnum::DCA360>(start, end, n, extraDays, out);
+	break;
+    }
+}
+
+std::vector<int> DayCount::diffDays(const std::vector<int>& start,
+				    const std::vector<int>& end,
+				    FinEnum::DayCountConvention dc) {
+    if(start.size() != end.size())
+	throw std::range_error("DayCount::diffDays: size mismatch");
+    std::vector<int> out(start.size());
+    if(out.size() > 0)
+	diffDays(&start[0], &end[0], (int)out.size(), dc, &out[0]);
+    return out;
+}
+
+std::vector<double> DayCount::yearFrac(const std::vector<int>& start,
+				       const std::vector<int>& end,
+				       FinEnum::DayCountConvention dc) {
+    if(start.size() != end.size())
+	throw std::range_error("DayCount::yearFrac: size mismatch");
+    std::vector<double> out(start.size());
+    if(out.size() > 0)
+	yearFrac(&start[0], &end[0], (int)out.size(), dc, &out[0]);
+    return out;
+}
+
+std::vector<double> DayCount::yearFrac(const std::vector<int>& start,
+				       const std::vector<int>& end,
+				       FinEnum::DayCountConvention dc,
+				       const std::vector<int>& extraDays) {
+    if(start.size() != end.size() || start.size() != extraDays.size())
+	throw std::range_error("DayCount::yearFrac: size mismatch");
+    std::vector<double> out(start.size());
+    if(out.size() > 0)
+	yearFrac(&start[0], &end[0], (int)out.size(), dc, &out[0],
+		 &extraDays[0]);
+    return out;
+}
+
+void DayCount::diffDays(const int* start, const int* end, int n,
+			FinEnum::DayCountConvention dc, const Calendar& cal,
+			int* out) {
+    if(dc != FinEnum::DCB252) {
+	diffDays(start, end, n, dc, out);
+	return;
+    }
+    if(n > 0 && (start == 0 || end == 0 || out == 0))
+	throw std::range_error("DayCount::diffDays: null array");
+    for(int i = 0; i < n; ++i)
+	out[i] = cal.busDaysBetween(start[i], end[i]);
+}
+
+void DayCount::yearFrac(const int* start, const int* end, int n,
+			FinEnum::DayCountConvention dc, const Calendar& cal,
+			double* out, const int* extraDays) {
+    if(dc != FinEnum::DCB252) {
+	yearFrac(start, end, n, dc, out, extraDays);
+	return;
+    }
+    checkPeriods(start, end, n, out);
+    typedef DayCountPolicy<FinEnum::DCB252> Bus252;
+    if(extraDays == 0)
+	for(int i = 0; i < n; ++i)
+	    out[i] = Bus252::yearFrac(start[i], end[i], cal);
+    else
+	for(int i = 0; i < n; ++i)
+	    out[i] = Bus252::yearFrac(start[i], end[i], cal, extraDays[i]);
+}
+
+std::vector<double> DayCount::yearFrac(const std::vector<int>& start,
+				       const std::vector<int>& end,
+				       FinEnum::DayCountConvention dc,
+				       const Calendar& cal) {
+    if(start.size() != end.size())
+	throw std::range_error("DayCount::yearFrac: size mismatch");
+    std::vector<double> out(start.size());
+    if(out.size() > 0)
+	yearFrac(&start[0], &end[0], (int)out.size(), dc, cal, &out[0]);
+    return out;
+}
+
+} // end cxxPack namespace
+
+/**
+ * R interface used by the unit tests: day counts and year fractions for
+ * the R dates in start and end, computed with the batch DayCount
+ * functions and with the FinDate functions one pair at a time. When
+ * calendar is not empty the calendar versions are used with the
+ * registered calendar of that name. Returns a list with components
+ * batchDays, scalarDays, batchFrac and scalarFrac.
+ */
+RcppExport SEXP dayCount_(SEXP start, SEXP end, SEXP dc, SEXP extraDays,
+			  SEXP calendar) {
+    BEGIN_RCPP
+    using cxxPack::FinDate;
+    Rcpp::NumericVector startDates(start), endDates(end);
+    Rcpp::IntegerVector extra(extraDays);
+    int n = startDates.size();
+    if(endDates.size() != n || extra.size() != n)
+	throw std::range_error("dayCount_: length mismatch");
+    cxxPack::FinEnum::DayCountConvention conv
+	= cxxPack::FinEnum::DayCountConvention_for(Rcpp::as<std::string>(dc));
+    std::string calName = Rcpp::as<std::string>(calendar);
+    const cxxPack::Calendar& cal = cxxPack::Calendar::get(
+	calName.empty() ? std::string("WeekendsOnly") : calName);
+
+    std::vector<int> jdn1(n), jdn2(n), extraVec(n);
+    for(int i = 0; i < n; ++i) {
+	jdn1[i] = (int)startDates[i] + FinDate::R_Offset;
+	jdn2[i] = (int)endDates[i] + FinDate::R_Offset;
+	extraVec[i] = extra[i];
+    }
+
+    Rcpp::IntegerVector batchDays(n), scalarDays(n);
+    Rcpp::NumericVector batchFrac(n), scalarFrac(n);
+    if(n > 0) {
+	if(calName.empty()) {
+	    cxxPack::DayCount::diffDays(&jdn1[0], &jdn2[0], n, conv,
+					INTEGER(batchDays));
+	    cxxPack::DayCount::yearFrac(&jdn1[0], &jdn2[0], n, conv,
+					REAL(batchFrac), &extraVec[0]);
+	}
+	else {
+	    cxxPack::DayCount::diffDays(&jdn1[0], &jdn2[0], n, conv, cal,
+					INTEGER(batchDays));
+	    cxxPack::DayCount::yearFrac(&jdn1[0], &jdn2[0], n, conv, cal,
+					REAL(batchFrac), &extraVec[0]);
+	}
+    }
+    for(int i = 0; i < n; ++i) {
+	FinDate d1(jdn1[i] - FinDate::R_Offset), d2(jdn2[i] - FinDate::R_Offset);
+	if(calName.empty()) {
+	    scalarDays[i] = FinDate::diffDays(d1, d2, conv);
+	    scalarFrac[i] = FinDate::yearFrac(d1, d2, conv, extraVec[i]);
+	}
+	else {
+	    scalarDays[i] = FinDate::diffDays(d1, d2, conv, cal);
+	    scalarFrac[i] = FinDate::yearFrac(d1, d2, conv, cal, extraVec[i]);
+	}
+    }
+    Rcpp::GenericVector result(4);
+    result[0] = batchDays;
+    result[1] = scalarDays;
+    result[2] = batchFrac;
+    result[3] = scalarFrac;
+    Rcpp::CharacterVector names(4);
+    names[0] = "batchDays";
+    names[1] = "scalarDays";
+    names[2] = "batchFrac";
+    names[3] = "scalarFrac";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
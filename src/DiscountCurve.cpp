@@ -0,0 +1,475 @@
+// DiscountCurve.cpp: interpolated discount factor curves
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#include <DiscountCurve.hpp>
+#include <DayCount.hpp>
+
+namespace cxxPack {
+
+// Monotone convex segment types (the cases of Hagan and West).
+enum { MCZero, MCQuadratic, MCFlatLeft, MCFlatRight, MCTwoQuadratics };
+
+// Cursor steps tried before falling back to a binary search.
+static const int maxCursorSteps = 4;
+
+DiscountCurve::DiscountCurve(FinDate refDate_,
+			     const std::vector<FinDate>& pillars,
+			     const std::vector<double>& discounts,
+			     FinEnum::Interpolation interp_,
+			     FinEnum::DayCountConvention dc_)
+    : refDate(refDate_.serialJulian()), interp(interp_), dc(dc_) {
+    if(pillars.size() != discounts.size())
+	throw std::range_error("DiscountCurve: need one discount factor per pillar");
+    std::vector<int> jdns(pillars.size());
+    for(size_t i = 0; i < pillars.size(); ++i)
+	jdns[i] = pillars[i].serialJulian();
+    build(jdns.empty() ? 0 : &jdns[0],
+	  discounts.empty() ? 0 : &discounts[0], jdns.size());
+}
+
+DiscountCurve::DiscountCurve(int refJDN, const int* pillars,
+			     const double* discounts, int n,
+			     FinEnum::Interpolation interp_,
+			     FinEnum::DayCountConvention dc_)
+    : refDate(refJDN), interp(interp_), dc(dc_) {
+    build(pillars, discounts, n);
+}
+
+void DiscountCurve::build(const int* dates, const double* discounts, int n) {
+    if(n < 1 || dates == 0 || discounts == 0)
+	throw std::range_error("DiscountCurve: need at least one pillar");
+    if(interp < 0 || interp >= FinEnum::numInterpolation)
+	throw std::range_error("DiscountCurve: invalid interpolation");
+    switch(dc) {
+    case FinEnum::DCA360:
+    case FinEnum::DCA365:
+    case FinEnum::DCA252:
+	timeScale = 1/FinDate::divisor(dc);
+	break;
+    default:
+	timeScale = 0;
+    }
+    std::vector<double> x(n+1);
+    pillarDates.assign(dates, dates + n);
+    pillarTimes.resize(n+1);
+    pillarTimes[0] = x[0] = 0;
+    for(int i = 0; i < n; ++i) {
+	if(dates[i] <= (i == 0 ? refDate : dates[i-1]))
+	    throw std::range_error("DiscountCurve: pillar dates must follow the reference date and increase");
+	if(!(discounts[i] > 0))
+	    throw std::range_error("DiscountCurve: discount factors must be positive");
+	pillarTimes[i+1] = time(dates[i]);
+	// Distinct dates can have the same time under 30/360 conventions
+	// (the 30th and 31st of a month).
+	if(!(pillarTimes[i+1] > pillarTimes[i]))
+	    throw std::range_error("DiscountCurve: pillar times must increase under the day count convention");
+	x[i+1] = -std::log(discounts[i]);
+    }
+    segs.resize(n);
+    for(int i = 0; i < n; ++i) {
+	Segment& s = segs[i];
+	s.t0 = pillarTimes[i];
+	s.h = pillarTimes[i+1] - pillarTimes[i];
+	s.x0 = x[i];
+	s.c1 = s.c2 = s.c3 = 0;
+	s.fd = s.g0 = s.g1 = s.eta = s.A = 0;
+	s.type = MCZero;
+    }
+    switch(interp) {
+    case FinEnum::LogLinear:
+	buildLinear(x);
+	break;
+    case FinEnum::CubicSpline:
+	buildCubic(x);
+	break;
+    case FinEnum::MonotoneConvex:
+	buildMonotoneConvex(x);
+	break;
+    }
+    xEnd = x[n];
+}
+
+void DiscountCurve::buildLinear(const std::vector<double>& x) {
+    int n = segs.size();
+    for(int i = 0; i < n; ++i)
+	segs[i].c1 = (x[i+1] - x[i])/segs[i].h;
+    fStart = segs[0].c1;
+    fEnd = segs[n-1].c1;
+}
+
+/**
+ * Natural cubic spline: solves the tridiagonal system for the second
+ * derivatives M at the nodes, with M = 0 at both ends.
+ */
+void DiscountCurve::buildCubic(const std::vector<double>& x) {
+    int n = segs.size(); // nodes 0..n
+    std::vector<double> M(n+1, 0.0);
+    if(n > 1) {
+	std::vector<double> diag(n+1), rhs(n+1);
+	for(int i = 1; i < n; ++i) {
+	    double h0 = segs[i-1].h, h1 = segs[i].h;
+	    diag[i] = 2*(h0 + h1);
+	    rhs[i] = 6*((x[i+1] - x[i])/h1 - (x[i] - x[i-1])/h0);
+	}
+	for(int i = 2; i < n; ++i) { // forward elimination
+	    double m = segs[i-1].h/diag[i-1];
+	    diag[i] -= m*segs[i-1].h;
+	    rhs[i] -= m*rhs[i-1];
+	}
+	for(int i = n-1; i >= 1; --i)
+	    M[i] = (rhs[i] - segs[i].h*M[i+1])/diag[i];
+    }
+    for(int i = 0; i < n; ++i) {
+	Segment& s = segs[i];
+	s.c1 = (x[i+1] - x[i])/s.h - s.h*(2*M[i] + M[i+1])/6;
+	s.c2 = M[i]/2;
+	s.c3 = (M[i+1] - M[i])/(6*s.h);
+    }
+    fStart = segs[0].c1;
+    const Segment& last = segs[n-1];
+    fEnd = last.c1 + last.h*(2*last.c2 + 3*last.c3*last.h);
+}
+
+/**
+ * Hagan and West, "Interpolation Methods for Curve Construction",
+ * Applied Mathematical Finance 13 (2006). The forwards at the nodes are
+ * weighted averages of the neighboring discrete forwards fd, and g is
+ * the forward less fd on a segment, as a function of u in [0,1].
+ */
+void DiscountCurve::buildMonotoneConvex(const std::vector<double>& x) {
+    int n = segs.size();
+    for(int i = 0; i < n; ++i)
+	segs[i].fd = (x[i+1] - x[i])/segs[i].h;
+    std::vector<double> f(n+1);
+    if(n == 1)
+	f[0] = f[1] = segs[0].fd;
+    else {
+	for(int i = 1; i < n; ++i) {
+	    double h0 = segs[i-1].h, h1 = segs[i].h;
+	    f[i] = (h0*segs[i].fd + h1*segs[i-1].fd)/(h0 + h1);
+	}
+	f[0] = segs[0].fd - 0.5*(f[1] - segs[0].fd);
+	f[n] = segs[n-1].fd - 0.5*(f[n-1] - segs[n-1].fd);
+    }
+    for(int i = 0; i < n; ++i) {
+	Segment& s = segs[i];
+	double g0 = s.g0 = f[i] - s.fd;
+	double g1 = s.g1 = f[i+1] - s.fd;
+	if(g0 == 0 && g1 == 0)
+	    s.type = MCZero;
+	else if((g0 < 0 && -0.5*g0 <= g1 && g1 <= -2*g0)
+		|| (g0 > 0 && -0.5*g0 >= g1 && g1 >= -2*g0))
+	    s.type = MCQuadratic;
+	else if((g0 < 0 && g1 > -2*g0) || (g0 > 0 && g1 < -2*g0)) {
+	    s.type = MCFlatLeft;
+	    s.eta = (g1 + 2*g0)/(g1 - g0);
+	}
+	else if((g0 > 0 && g1 < 0 && g1 > -0.5*g0)
+		|| (g0 < 0 && g1 > 0 && g1 < -0.5*g0)) {
+	    s.type = MCFlatRight;
+	    s.eta = 3*g1/(g1 - g0);
+	}
+	else { // g0 and g1 have the same sign
+	    s.type = MCTwoQuadratics;
+	    s.eta = g1/(g1 + g0);
+	    s.A = -g0*g1/(g0 + g1);
+	}
+    }
+    fStart = f[0];
+    fEnd = f[n];
+}
+
+/**
+ * Monotone convex g(u) and its integral G(u) from 0 to u.
+ */
+static inline void monotoneConvex(int type, double g0, double g1, double eta,
+				  double A, double u, double& g, double& G) {
+    switch(type) {
+    case MCQuadratic:
+	g = g0*(1 - 4*u + 3*u*u) + g1*(-2*u + 3*u*u);
+	G = g0*(u - 2*u*u + u*u*u) + g1*(-u*u + u*u*u);
+	break;
+    case MCFlatLeft:
+	if(u <= eta) {
+	    g = g0;
+	    G = g0*u;
+	}
+	else {
+	    double r = (u - eta)/(1 - eta);
+	    g = g0 + (g1 - g0)*r*r;
+	    G = g0*u + (g1 - g0)*r*r*(u - eta)/3;
+	}
+	break;
+    case MCFlatRight:
+	if(u < eta) {
+	    double r = (eta - u)/eta;
+	    g = g1 + (g0 - g1)*r*r;
+	    G = g1*u + (g0 - g1)*eta*(1 - r*r*r)/3;
+	}
+	else {
+	    g = g1;
+	    G = g1*u + (g0 - g1)*eta/3;
+	}
+	break;
+    case MCTwoQuadratics:
+	if(u < eta) {
+	    double r = (eta - u)/eta;
+	    g = A + (g0 - A)*r*r;
+	    G = A*u + (g0 - A)*eta*(1 - r*r*r)/3;
+	}
+	else {
+	    G = A*u + (g0 - A)*eta/3;
+	    if(eta < 1) {
+		double r = (u - eta)/(1 - eta);
+		g = A + (g1 - A)*r*r;
+		G += (g1 - A)*r*r*(u - eta)/3;
+	    }
+	    else
+		g = g1;
+	}
+	break;
+    default: // MCZero
+	g = G = 0;
+    }
+}
+
+double DiscountCurve::time(int jdn) const {
+    if(timeScale != 0)
+	return (jdn - refDate)*timeScale;
+    if(jdn == refDate)
+	return 0;
+    if(jdn > refDate)
+	return FinDate::yearFrac(FinDate(refDate, true), FinDate(jdn, true), dc);
+    return -FinDate::yearFrac(FinDate(jdn, true), FinDate(refDate, true), dc);
+}
+
+/**
+ * Segment that contains t, or -1 before the reference date, or
+ * numPillars() past the last pillar. Tries a few steps forward from
+ * cursor before a binary search, and leaves cursor on the segment found.
+ */
+int DiscountCurve::findSegment(double t, int& cursor) const {
+    int n = segs.size();
+    if(t < 0)
+	return -1;
+    if(t >= pillarTimes[n])
+	return n;
+    int k = cursor;
+    if(t >= pillarTimes[k]) {
+	for(int step = 0; step < maxCursorSteps; ++step) {
+	    if(t < pillarTimes[k+1]) {
+		cursor = k;
+		return k;
+	    }
+	    ++k;
+	}
+    }
+    k = std::upper_bound(pillarTimes.begin(), pillarTimes.begin() + n, t)
+	- pillarTimes.begin() - 1;
+    cursor = k;
+    return k;
+}
+
+template <FinEnum::Interpolation I>
+inline double DiscountCurve::minusLogDiscount(int k, double t) const {
+    if(k < 0)
+	return fStart*t;
+    if(k == (int)segs.size())
+	return xEnd + fEnd*(t - pillarTimes[k]);
+    const Segment& s = segs[k];
+    double dt = t - s.t0;
+    if(I == FinEnum::MonotoneConvex) {
+	double g, G;
+	monotoneConvex(s.type, s.g0, s.g1, s.eta, s.A, dt/s.h, g, G);
+	return s.x0 + dt*s.fd + s.h*G;
+    }
+    return s.x0 + dt*(s.c1 + dt*(s.c2 + dt*s.c3));
+}
+
+template <FinEnum::Interpolation I>
+inline double DiscountCurve::instForward(int k, double t) const {
+    if(k < 0)
+	return fStart;
+    if(k == (int)segs.size())
+	return fEnd;
+    const Segment& s = segs[k];
+    double dt = t - s.t0;
+    if(I == FinEnum::MonotoneConvex) {
+	double g, G;
+	monotoneConvex(s.type, s.g0, s.g1, s.eta, s.A, dt/s.h, g, G);
+	return s.fd + g;
+    }
+    return s.c1 + dt*(2*s.c2 + 3*dt*s.c3);
+}
+
+template <FinEnum::Interpolation I>
+void DiscountCurve::batchDiscount(const int* dates, int n, double* out) const {
+    int cursor = 0;
+    for(int i = 0; i < n; ++i) {
+	double t = time(dates[i]);
+	out[i] = std::exp(-minusLogDiscount<I>(findSegment(t, cursor), t));
+    }
+}
+
+template <FinEnum::Interpolation I>
+void DiscountCurve::batchForward(const int* dates, int n, double* out) const {
+    int cursor = 0;
+    for(int i = 0; i < n; ++i) {
+	double t = time(dates[i]);
+	out[i] = instForward<I>(findSegment(t, cursor), t);
+    }
+}
+
+void DiscountCurve::discount(const int* dates, int n, double* out) const {
+    if(n > 0 && (dates == 0 || out == 0))
+	throw std::range_error("DiscountCurve::discount: null array");
+    switch(interp) {
+    case FinEnum::LogLinear:
+	batchDiscount<FinEnum::LogLinear>(dates, n, out);
+	break;
+    case FinEnum::CubicSpline:
+	batchDiscount<FinEnum::CubicSpline>(dates, n, out);
+	break;
+    case FinEnum::MonotoneConvex:
+	batchDiscount<FinEnum::MonotoneConvex>(dates, n, out);
+	break;
+    }
+}
+
+void DiscountCurve::forward(const int* dates, int n, double* out) const {
+    if(n > 0 && (dates == 0 || out == 0))
+	throw std::range_error("DiscountCurve::forward: null array");
+    switch(interp) {
+    case FinEnum::LogLinear:
+	batchForward<FinEnum::LogLinear>(dates, n, out);
+	break;
+    case FinEnum::CubicSpline:
+	batchForward<FinEnum::CubicSpline>(dates, n, out);
+	break;
+    case FinEnum::MonotoneConvex:
+	batchForward<FinEnum::MonotoneConvex>(dates, n, out);
+	break;
+    }
+}
+
+void DiscountCurve::forwardRate(const int* start, const int* end, int n,
+				FinEnum::DayCountConvention dc_,
+				double* out) const {
+    if(n <= 0)
+	return;
+    if(start == 0 || end == 0 || out == 0)
+	throw std::range_error("DiscountCurve::forwardRate: null array");
+    std::vector<double> frac(n), endDiscount(n);
+    DayCount::yearFrac(start, end, n, dc_, &frac[0]); // checks start < end
+    discount(start, n, out);
+    discount(end, n, &endDiscount[0]);
+    for(int i = 0; i < n; ++i)
+	out[i] = (out[i]/endDiscount[i] - 1)/frac[i];
+}
+
+double DiscountCurve::discount(int jdn) const {
+    double out;
+    discount(&jdn, 1, &out);
+    return out;
+}
+
+double DiscountCurve::discount(FinDate date) const {
+    return discount(date.serialJulian());
+}
+
+double DiscountCurve::forward(int jdn) const {
+    double out;
+    forward(&jdn, 1, &out);
+    return out;
+}
+
+double DiscountCurve::forwardRate(int start, int end,
+				  FinEnum::DayCountConvention dc_) const {
+    double out;
+    forwardRate(&start, &end, 1, dc_, &out);
+    return out;
+}
+
+std::vector<double> DiscountCurve::discount(const std::vector<int>& dates) const {
+    std::vector<double> out(dates.size());
+    if(!dates.empty())
+	discount(&dates[0], dates.size(), &out[0]);
+    return out;
+}
+
+std::vector<double> DiscountCurve::forward(const std::vector<int>& dates) const {
+    std::vector<double> out(dates.size());
+    if(!dates.empty())
+	forward(&dates[0], dates.size(), &out[0]);
+    return out;
+}
+
+} // end cxxPack namespace
+
+/**
+ * R interface used by the unit tests: the discount factors and forward
+ * rates of the curve through the pillars (R dates) at each of dates, as
+ * list(discount, forward) computed by the batch functions, and as
+ * list(singleDiscount, singleForward) computed one date at a time.
+ */
+RcppExport SEXP discountCurve_(SEXP refDate, SEXP pillars, SEXP discounts,
+			       SEXP interp, SEXP dc, SEXP dates) {
+    BEGIN_RCPP
+    using cxxPack::FinDate;
+    using cxxPack::FinEnum;
+    Rcpp::NumericVector pillarDates(pillars), pillarDiscounts(discounts);
+    Rcpp::NumericVector lookupDates(dates);
+    int np = pillarDates.size(), n = lookupDates.size();
+    if(pillarDiscounts.size() != np)
+	throw std::range_error("discountCurve_: length mismatch");
+    std::vector<int> pillarJDN(np), jdns(n);
+    std::vector<double> df(np);
+    for(int i = 0; i < np; ++i) {
+	pillarJDN[i] = (int)pillarDates[i] + FinDate::R_Offset;
+	df[i] = pillarDiscounts[i];
+    }
+    for(int j = 0; j < n; ++j)
+	jdns[j] = (int)lookupDates[j] + FinDate::R_Offset;
+    cxxPack::DiscountCurve curve(
+	(int)Rcpp::as<double>(refDate) + FinDate::R_Offset,
+	np > 0 ? &pillarJDN[0] : 0, np > 0 ? &df[0] : 0, np,
+	FinEnum::Interpolation_for(Rcpp::as<std::string>(interp)),
+	FinEnum::DayCountConvention_for(Rcpp::as<std::string>(dc)));
+
+    std::vector<double> discount = curve.discount(jdns);
+    std::vector<double> forward = curve.forward(jdns);
+    Rcpp::NumericVector batchDiscount(n), batchForward(n);
+    Rcpp::NumericVector singleDiscount(n), singleForward(n);
+    for(int j = 0; j < n; ++j) {
+	batchDiscount[j] = discount[j];
+	batchForward[j] = forward[j];
+	singleDiscount[j] = curve.discount(jdns[j]);
+	singleForward[j] = curve.forward(jdns[j]);
+    }
+    Rcpp::GenericVector result(4);
+    Rcpp::CharacterVector names(4);
+    result[0] = batchDiscount;  names[0] = "discount";
+    result[1] = batchForward;   names[1] = "forward";
+    result[2] = singleDiscount; names[2] = "singleDiscount";
+    result[3] = singleForward;  names[3] = "singleForward";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
@@ -0,0 +1,176 @@
+// Expiry.cpp: expiration dates for listed futures and options
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <map>
+
+#include <Expiry.hpp>
+
+namespace cxxPack {
+
+int ExpiryRule::compute(int month, int year) const {
+    if(function != 0)
+	return function(month, year);
+    return compute(month, year, Calendar::get(calendar));
+}
+
+int ExpiryRule::compute(int month, int year, const Calendar& cal) const {
+    if(function != 0)
+	return function(month, year);
+    int jdn;
+    if(nth < 0) { // last weekday of the month
+	int last = FinDate::mdy2jdn(month, FinDate::daysInMonth(month, year),
+				    year);
+	jdn = last - ((last+1)%7 - weekday + 7) % 7;
+    }
+    else
+	jdn = FinDate::nthWeekday(nth, weekday, month, year);
+    jdn += calendarDays;
+    for(int i = 0; i < businessDays; ++i)
+	jdn = cal.nextBusDay(jdn);
+    for(int i = 0; i > businessDays; --i)
+	jdn = cal.prevBusDay(jdn);
+    return jdn;
+}
+
+ExpiryTable::ExpiryTable(const ExpiryRule& rule_, int firstYear_,
+			 int lastYear_)
+    : rule(rule_), firstYear(firstYear_), lastYear(lastYear_) {
+    if(firstYear > lastYear)
+	throw std::range_error("ExpiryTable: firstYear > lastYear");
+    const Calendar& cal = Calendar::get(rule.calendar);
+    table.resize(12*(lastYear - firstYear + 1));
+    for(int year = firstYear; year <= lastYear; ++year)
+	for(int month = 1; month <= 12; ++month)
+	    table[12*(year - firstYear) + month - 1]
+		= rule.compute(month, year, cal);
+}
+
+int ExpiryTable::nextExpiry(int jdn) const {
+    DateMDY mdy = FinDate::jdn2mdy(jdn);
+    int month = mdy.month, year = mdy.year;
+    // Start a month early in case a rule moves expirations into the
+    // following month.
+    if(--month == 0) {
+	month = 12;
+	year--;
+    }
+    int next;
+    while((next = expiry(month, year)) < jdn)
+	if(++month > 12) {
+	    month = 1;
+	    year++;
+	}
+    return next;
+}
+
+void ExpiryTable::expiries(int month, int year, int n, int* out) const {
+    if(month < 1 || month > 12)
+	throw std::range_error("ExpiryTable::expiries: invalid month");
+    for(int i = 0; i < n; ++i) {
+	out[i] = expiry(month, year);
+	if(++month > 12) {
+	    month = 1;
+	    year++;
+	}
+    }
+}
+
+// The registry is created on first use (no static constructors).
+typedef std::map<std::string, ExpiryTable> ExpiryMap;
+static ExpiryMap& registry() {
+    static ExpiryMap tables;
+    return tables;
+}
+
+const ExpiryTable& ExpiryTable::add(const ExpiryRule& rule, int firstYear,
+				    int lastYear) {
+    ExpiryMap& reg = registry();
+    ExpiryTable table(rule, firstYear, lastYear);
+    ExpiryMap::iterator it = reg.find(rule.getName());
+    if(it != reg.end()) {
+	it->second = table;
+	return it->second;
+    }
+    return reg.insert(std::make_pair(rule.getName(), table)).first->second;
+}
+
+const ExpiryTable& ExpiryTable::get(std::string name) {
+    ExpiryMap& reg = registry();
+    ExpiryMap::iterator it = reg.find(name);
+    if(it != reg.end())
+	return it->second;
+    if(name == "SPX")
+	return add(ExpiryRule(name, 3, cxxPack::Fri, 1));
+    if(name == "IMM")
+	return add(ExpiryRule(name, 3, cxxPack::Wed, 0, -2));
+    if(name == "ThirdFriday")
+	return add(ExpiryRule(name, 3, cxxPack::Fri));
+    throw std::range_error("ExpiryTable::get: unknown expiry rule: " + name);
+}
+
+} // end cxxPack namespace
+
+/**
+ * R interface used by the unit tests: the expirations of the registered
+ * table name for each month/year (expiry), the same from
+ * FinDate::spxDate() or FinDate::immDate() for "SPX" and "IMM" (direct,
+ * NA for other tables), the chain of 12 monthly contracts that starts
+ * with the first month/year (chain), and the first expiration on or after
+ * each of the R dates (next). Dates are R dates.
+ */
+RcppExport SEXP expiry_(SEXP name, SEXP months, SEXP years, SEXP dates) {
+    BEGIN_RCPP
+    using cxxPack::FinDate;
+    std::string tableName = Rcpp::as<std::string>(name);
+    const cxxPack::ExpiryTable& table = cxxPack::ExpiryTable::get(tableName);
+    Rcpp::IntegerVector month(months), year(years);
+    Rcpp::NumericVector from(dates);
+    int n = month.size(), m = from.size();
+    Rcpp::NumericVector expiry(n), direct(n), chain(12), next(m);
+    for(int i = 0; i < n; ++i) {
+	expiry[i] = table.expiry(month[i], year[i]) - FinDate::R_Offset;
+	FinDate first((cxxPack::Month)month[i], 1, year[i]);
+	if(tableName == "SPX")
+	    direct[i] = first.spxDate().getRValue();
+	else if(tableName == "IMM")
+	    direct[i] = first.immDate().getRValue();
+	else
+	    direct[i] = NA_REAL;
+    }
+    if(n > 0) {
+	int jdns[12];
+	table.expiries(month[0], year[0], 12, jdns);
+	for(int i = 0; i < 12; ++i)
+	    chain[i] = jdns[i] - FinDate::R_Offset;
+    }
+    for(int j = 0; j < m; ++j)
+	next[j] = table.nextExpiry((int)from[j] + FinDate::R_Offset)
+	    - FinDate::R_Offset;
+
+    Rcpp::GenericVector result(4);
+    result[0] = expiry;
+    result[1] = direct;
+    result[2] = chain;
+    result[3] = next;
+    Rcpp::CharacterVector names(4);
+    names[0] = "expiry";
+    names[1] = "direct";
+    names[2] = "chain";
+    names[3] = "next";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
@@ -15,6 +15,9 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <FinDate.hpp>
+#include <Calendar.hpp>
+#include <DayCount.hpp>
+#include <DateIO.hpp>
 
 #include <ostream>
 
@@ -31,141 +34,37 @@ FinDate::FinDate(SEXP dateSEXP) {
     if(std::string(classAttr[0]) != "Date")
 	throw std::range_error("Invalid class in FinDate constr");
     jdn = (int)(Rcpp::as<double>(dateSEXP) + R_Offset);
-    parsed = false;
 }
 
+// FinDate must stay a plain julian day number (see class comment).
+typedef char FinDate_must_be_one_int[sizeof(FinDate) == sizeof(int) ? 1 : -1];
+
 /**
  * Returns the number of days between the dates specified, using the
- * specified day count convention.
+ * specified day count convention (see DayCountPolicy in DayCount.hpp for
+ * the conventions).
  */
 int FinDate::diffDays(FinDate date1, FinDate date2, 
 		      FinEnum::DayCountConvention dc){
-    int result = (int)(date2 - date1);
-    FinEnum::DayCountConvention dateCount = dc;
-
-    if(result == 0
-       || dateCount == FinEnum::DCAA
-       || dateCount == FinEnum::DCA360
-       || dateCount == FinEnum::DCA365
-       || dateCount == FinEnum::DCA252)
-	return result;
-    
-    int d1, d2, m1, m2, y1, y2;
-    if(result > 0) {
-	m1 = date1.getMonth();
-	m2 = date2.getMonth();
-	d1 = date1.getDay();
-	d2 = date2.getDay();
-	y1 = date1.getYear();
-	y2 = date2.getYear();
-    }
-    else {
-	m1 = date2.getMonth();
-	m2 = date1.getMonth();
-	d1 = date2.getDay();
-	d2 = date1.getDay();
-	y1 = date2.getYear();
-	y2 = date1.getYear();
-    }
-    
-    FinDate leapDate;
-    switch (dateCount){
-	
+    int jdn1 = date1.jdn, jdn2 = date2.jdn;
+    switch(dc) {
     case FinEnum::DCA360NL:
+	return DayCountPolicy<FinEnum::DCA360NL>::days(jdn1, jdn2);
     case FinEnum::DCA365NL:
-	
-	// Do not count leap days between date1 and date2.
-	// We assume that |year1 - year2| <= 1, so one of the dates
-	// must fall in a leap year if there is a leap day between
-	// the dates.
-	if(FinDate::isLeapYear(y1))
-	    leapDate = FinDate(Month(2), 29, y1);
-	else if(FinDate::isLeapYear(y2))
-	    leapDate = FinDate(Month(2), 29, y2);
-	else
-	    break;
-	
-	if(date1 <= leapDate
-	   && date2 >= leapDate)
-	    result--;
-	else if(date1 >= leapDate
-		&& date2 <= leapDate)
-	    result++;
-	break;
-	
-    case FinEnum::DC30360I: // 30/360 ISDA --- Standard
-	
-	// ISDA 30/360 convention (most often used).
-	// If d1 = min(d1,30); if d2 == 31 and d1 == 30, d2 = 30.
-	if(d1 == 31) d1 = 30;
-	if(d1 == 30 && d2 == 31) 
-	    d2 = 30;
-	if (result > 0 )
-	    result = (y2-y1)*360 + (m2-m1)*30 + d2-d1;
-	else 
-	    result = -((y2-y1)*360 + (m2-m1)*30 + d2-d1);
-	break;
-	
-    case FinEnum::DC30360E: // 30E/360 --- Symmetric
-	
-	// Eurobond convention (or Symmetric 30/360 convention)
-	// d1 = min(d1,30); d2 = min(d2,30);
-	if(d1 == 31) d1 = 30;
-	if(d2 == 31) d2 = 30;
-	if (result > 0 )
-	    result = (y2-y1)*360 + (m2-m1)*30 + d2-d1;
-	else 
-	    result = -((y2-y1)*360 + (m2-m1)*30 + d2-d1);
-	break;
-	
-    case FinEnum::DC30360P1: // 30/360 PSA, Feb. adjust for d1
-	
-	// Bond basis or PSA 30/360 convention. 
-	// If d1 == 31 or d1 == last day of Feb., d1 = 30;
-	// If d2 == 31 and d1 (adjusted) == 30, d2 = 30.
-	// SIA modification: Don't adjust d1 in case
-	// d1 = last day of Feb. unless there is a coupon on this day.
-	if ((m1 == cxxPack::Feb) && adjustFebruary) {
-	    if((isLeapYear(y1) && d1 == 29) || d1 == 28)
-		d1 = 30;
-	}
-	else if(d1 > 30) 
-	    d1 = 30;
-	if(d1 == 30 && d2 == 31)
-	    d2 = 30;
-	if(result > 0)
-	    result = (y2-y1)*360 + (m2-m1)*30 + d2-d1;
-	else 
-	    result = -((y2-y1)*360 + (m2-m1)*30 + d2-d1);
-	break;
-	
-    case FinEnum::DC30360P2: // 30/360 PSA, Feb. adjust for d1 and d2
-	
-	// This is a kind of symmetric PSA convention where Feb. is
-	// given special treatment for both d1 and d2, with an optional
-	// SIA modification applied to d2. (See previous case.)
-	if (m1 == cxxPack::Feb) {
-	    if((isLeapYear(y1) && d1 == 29) || d1 == 28)
-		d1 = 30;
-	}
-	else if(d1 == 31) 
-	    d1 = 30;
-	if ((m2 == cxxPack::Feb) && adjustFebruary) {
-	    if((isLeapYear(y2) && d2 == 29) || d2 == 28)
-		d2 = 30;
-	}
-	else if(d2 == 31) 
-	    d2 = 30;
-	if (result > 0)
-	    result = (y2-y1)*360 + (m2-m1)*30 + d2-d1;
-	else 
-	    result = -((y2-y1)*360 + (m2-m1)*30 + d2-d1);
-	break;
-	
-    default:
-	break;
+	return DayCountPolicy<FinEnum::DCA365NL>::days(jdn1, jdn2);
+    case FinEnum::DC30360I:
+	return DayCountPolicy<FinEnum::DC30360I>::days(jdn1, jdn2);
+    case FinEnum::DC30360E:
+	return DayCountPolicy<FinEnum::DC30360E>::days(jdn1, jdn2);
+    case FinEnum::DC30360P1:
+	return DayCountPolicy<FinEnum::DC30360P1>::days(jdn1, jdn2);
+    case FinEnum::DC30360P2:
+	return DayCountPolicy<FinEnum::DC30360P2>::days(jdn1, jdn2);
+    case FinEnum::DCB252: // weekends only (no calendar)
+	return DayCountPolicy<FinEnum::DCB252>::days(jdn1, jdn2);
+    default: // DCAA, DCA360, DCA365, DCA252
+	return jdn2 - jdn1;
     }
-    return result;
 }
 
 
@@ -178,56 +77,90 @@ int FinDate::diffDays(FinDate date1, FinDate date2,
 double FinDate::yearFrac(FinDate date1, FinDate date2, 
 			 FinEnum::DayCountConvention dc, 
 			 int extraDays) {
-    double frac = 0.;
     if(date1 >= date2) { // Should throw an exception here...
 	throw std::range_error("Error: date1 >= date2 in yearfrac");
     }
-    int diff = diffDays(date1, date2, dc);
-    if (dc != FinEnum::DCAA) {
-	switch(dc) {
-	case FinEnum::DCAA:        
-	    break;
-	case FinEnum::DCA365:
-	case FinEnum::DCA365NL:
-	    frac = (diff+extraDays) / 365.0;
-	    break;
-	case FinEnum::DCA252:
-	    frac = (diff+extraDays) / 252.0;
-	    break;
-	case FinEnum::DCA360:
-	case FinEnum::DC30360I:
-	case FinEnum::DC30360E:
-	case FinEnum::DC30360P1:
-	case FinEnum::DC30360P2:
-	case FinEnum::DCA360NL:
-	default:
-	    frac = (diff+extraDays) / 360.0;
-	    break;
-	}
-    }
-    else { /* DCAA */
-	  
-	// Actual number of days divided by the actual number 
-	// of days in the year(s) where the interval between 
-	// date1 and date2 falls.The algorithm here permits the two dates to
-	// be separated by two or more years, and each subinterval is
-	// divided by the approriate number based on leap year status.
-	if(date1.getYear() == date2.getYear())
-	    return diff/(date1.isLeapYear()?366.0:365.0);
-	
-	FinDate eoy1 = FinDate(Month(12), 31, date1.getYear());
-	FinDate eoy2 = FinDate(Month(12), 31, date1.getYear()+1);
-	frac += diffDays(date1, eoy1)/(date1.isLeapYear()?366.0:365.0);
-	while(date2 > eoy2) {
-	    frac += diffDays(eoy1,eoy2)/(eoy2.isLeapYear()?366.0:365.0);
-	    eoy1 = eoy2;
-	    eoy2 = FinDate(Month(12),31,eoy1.getYear()+1);
-	}
-	frac += diffDays(eoy1, date2)/(date2.isLeapYear()?366.0:365.0);
+    int jdn1 = date1.jdn, jdn2 = date2.jdn;
+    switch(dc) {
+    case FinEnum::DCAA:
+	return DayCountPolicy<FinEnum::DCAA>::yearFrac(jdn1, jdn2);
+    case FinEnum::DCA365:
+	return DayCountPolicy<FinEnum::DCA365>::yearFrac(jdn1, jdn2, extraDays);
+    case FinEnum::DCA252:
+	return DayCountPolicy<FinEnum::DCA252>::yearFrac(jdn1, jdn2, extraDays);
+    case FinEnum::DCA360NL:
+	return DayCountPolicy<FinEnum::DCA360NL>::yearFrac(jdn1, jdn2,
+							   extraDays);
+    case FinEnum::DCA365NL:
+	return DayCountPolicy<FinEnum::DCA365NL>::yearFrac(jdn1, jdn2,
+							   extraDays);
+    case FinEnum::DC30360I:
+	return DayCountPolicy<FinEnum::DC30360I>::yearFrac(jdn1, jdn2,
+							   extraDays);
+    case FinEnum::DC30360E:
+	return DayCountPolicy<FinEnum::DC30360E>::yearFrac(jdn1, jdn2,
+							   extraDays);
+    case FinEnum::DC30360P1:
+	return DayCountPolicy<FinEnum::DC30360P1>::yearFrac(jdn1, jdn2,
+							    extraDays);
+    case FinEnum::DC30360P2:
+	return DayCountPolicy<FinEnum::DC30360P2>::yearFrac(jdn1, jdn2,
+							    extraDays);
+    case FinEnum::DCB252:
+	return DayCountPolicy<FinEnum::DCB252>::yearFrac(jdn1, jdn2, extraDays);
+    case FinEnum::DCA360:
+    default:
+	return DayCountPolicy<FinEnum::DCA360>::yearFrac(jdn1, jdn2, extraDays);
     }
-    return(frac);
 }    
 
+/**
+ * Day count using a holiday calendar for the business day conventions
+ * (BUS/252). The calendar is ignored for the other conventions.
+ */
+int FinDate::diffDays(FinDate date1, FinDate date2,
+		      FinEnum::DayCountConvention dc, const Calendar& cal) {
+    if(dc == FinEnum::DCB252)
+	return DayCountPolicy<FinEnum::DCB252>::days(date1.jdn, date2.jdn, cal);
+    return diffDays(date1, date2, dc);
+}
+
+/**
+ * Year fraction using a holiday calendar for the business day
+ * conventions (BUS/252). The calendar is ignored for the other
+ * conventions.
+ */
+double FinDate::yearFrac(FinDate date1, FinDate date2,
+			 FinEnum::DayCountConvention dc, const Calendar& cal,
+			 int extraDays) {
+    if(dc != FinEnum::DCB252)
+	return yearFrac(date1, date2, dc, extraDays);
+    if(date1 >= date2)
+	throw std::range_error("Error: date1 >= date2 in yearfrac");
+    return DayCountPolicy<FinEnum::DCB252>::yearFrac(date1.jdn, date2.jdn,
+						     cal, extraDays);
+}
+
+/**
+ * Days per year used by yearFrac() for the specified convention (1 for
+ * ACT/ACT, where it depends on the dates).
+ */
+double FinDate::divisor(FinEnum::DayCountConvention dc) {
+    switch(dc) {
+    case FinEnum::DCAA:
+	return DayCountPolicy<FinEnum::DCAA>::divisor();
+    case FinEnum::DCA365:
+    case FinEnum::DCA365NL:
+	return DayCountPolicy<FinEnum::DCA365>::divisor();
+    case FinEnum::DCA252:
+	return DayCountPolicy<FinEnum::DCA252>::divisor();
+    case FinEnum::DCB252:
+	return DayCountPolicy<FinEnum::DCB252>::divisor();
+    default: // DCA360, DCA360NL and the 30/360 conventions
+	return DayCountPolicy<FinEnum::DCA360>::divisor();
+    }
+}
+
 /**
  * True if not Sat or Sun, false otherwise.
  */
@@ -243,24 +176,18 @@ bool FinDate::isBusDay() const { // no holiday calendar support yet.
  * Return next business day (no holiday support).
  */
 FinDate FinDate::nextBusDay() const {
-    int jdn = serialJulian();
-    FinDate temp = FinDate(++jdn);
-    while(!temp.isBusDay())
-	temp = FinDate(++jdn);
-    temp.parsed = false;
-    return temp;
+    int weekday = getWeekday();
+    int step = weekday == cxxPack::Fri ? 3 : (weekday == cxxPack::Sat ? 2 : 1);
+    return FinDate(serialJulian()+step, true);
 }
 
 /**
  * Returns previous business date.
  */
 FinDate FinDate::prevBusDay() const {
-    int jdn = serialJulian();
-    FinDate temp = FinDate(--jdn);
-    while(!temp.isBusDay())
-	temp = FinDate(--jdn);
-    temp.parsed = false;
-    return temp;
+    int weekday = getWeekday();
+    int step = weekday == cxxPack::Mon ? 3 : (weekday == cxxPack::Sun ? 2 : 1);
+    return FinDate(serialJulian()-step, true);
 }
 
 /**
@@ -272,34 +199,73 @@ FinDate FinDate::modNextBusDay() const {
     FinDate temp = nextBusDay();
     if(temp.getMonth() != getMonth())
 	temp = prevBusDay();
-    temp.parsed = false;
     return temp;
 }
 
+/**
+ * True if this date is a business day in the specified calendar.
+ */
+bool FinDate::isBusDay(const Calendar& cal) const {
+    return cal.isBusDay(serialJulian());
+}
+
+FinDate FinDate::nextBusDay(const Calendar& cal) const {
+    return FinDate(cal.nextBusDay(serialJulian()), true);
+}
+
+FinDate FinDate::prevBusDay(const Calendar& cal) const {
+    return FinDate(cal.prevBusDay(serialJulian()), true);
+}
+
+FinDate FinDate::modNextBusDay(const Calendar& cal) const {
+    return FinDate(cal.modNextBusDay(serialJulian()), true);
+}
+
+FinDate FinDate::adjust(const Calendar& cal,
+			FinEnum::BusDayConvention conv) const {
+    return FinDate(cal.adjust(serialJulian(), conv), true);
+}
+
+FinDate FinDate::addBusDays(int n, const Calendar& cal) const {
+    return FinDate(cal.advance(serialJulian(), n), true);
+}
+
+int FinDate::busDaysBetween(FinDate date1, FinDate date2,
+			    const Calendar& cal) {
+    return cal.busDaysBetween(date1.serialJulian(), date2.serialJulian());
+}
+
 /**
  * Returns the expiration date of an S&P 500 index option that
  * expires in the current month and year. This is the Saturday
  * immediately following the third Friday.
  */
 FinDate FinDate::spxDate() const {
-    FinDate expiry(Month(getMonth()),1,getYear());
-    expiry = expiry.nthWeekday(3, cxxPack::Fri);
-    expiry = FinDate(expiry.serialJulian()+1);
-    expiry.parsed = false;
-    return expiry;
+    DateMDY mdy = jdn2mdy(jdn);
+    return FinDate(nthWeekday(3, cxxPack::Fri, mdy.month, mdy.year) + 1, true);
 }
 
 /**
  * Returns the expiration date of a Eurodollar futures contract
  * in the current month and year. This is the second London business day
- * before the third Wednesday. TODO: Support for London holidays.
+ * before the third Wednesday. London holidays are not taken into
+ * account here, see immDate(const Calendar&).
  */
 FinDate FinDate::immDate() const {
-    FinDate expiry(Month(getMonth()),1,getYear());
-    expiry = expiry.nthWeekday(3, cxxPack::Wed);// Third Wednesday.
-    expiry = expiry.prevBusDay().prevBusDay();// Two business days prior.
-    expiry.parsed = false;
-    return expiry;
+    // Two weekdays before a Wednesday is the Monday.
+    DateMDY mdy = jdn2mdy(jdn);
+    return FinDate(nthWeekday(3, cxxPack::Wed, mdy.month, mdy.year) - 2, true);
+}
+
+/**
+ * Eurodollar expiration using the specified calendar for the business
+ * day roll, for example, Calendar::get("London"), or a joint calendar
+ * like Calendar::joint("NYSE", "London").
+ */
+FinDate FinDate::immDate(const Calendar& cal) const {
+    FinDate expiry = nthWeekday(3, cxxPack::Wed);// Third Wednesday.
+    return FinDate(cal.prevBusDay(cal.prevBusDay(expiry.serialJulian())),
+		   true);
 }
 
 /**
@@ -309,16 +275,17 @@ FinDate FinDate::immDate() const {
  * the starting date is the last day of the starting month.
  */
 FinDate FinDate::addMonths(int n, bool adjustEOM) const {
-    int m1, d1, y1, m2=0, d2=0, y2=0;
-
-    m1 = getMonth(), d1 = getDay(), y1 = getYear();
+    int m2=0, d2=0, y2=0;
 
     if(n == 0)
 	return *this;
 
+    DateMDY mdy = getMDY();
+    int m1 = mdy.month, d1 = mdy.day, y1 = mdy.year;
+
     // Force target date to EOM if starting date is EOM.
     bool forceEOM = adjustEOM
-	&& (d1 == daysInMonthTable[this->isLeapYear()?1:0][m1]);
+	&& (d1 == daysInMonthTable[isLeapYear(y1)?1:0][m1]);
 	
     if(m1-1+n >= 0) {
 	m2 = 1+(m1-1+n)%12;
@@ -329,8 +296,7 @@ FinDate FinDate::addMonths(int n, bool adjustEOM) const {
 	y2 = y1-((12-m1-n)/12);
     }
     
-    FinDate targetYear(Month(1),1,y2);
-    int numDays2 = daysInMonthTable[targetYear.isLeapYear()?1:0][m2];
+    int numDays2 = daysInMonthTable[isLeapYear(y2)?1:0][m2];
     if(numDays2 >= d1)
 	d2 = d1; // no adjustment
     else
@@ -342,12 +308,9 @@ FinDate FinDate::addMonths(int n, bool adjustEOM) const {
 
 // Print an FinDate.
 std::ostream& operator<<(std::ostream& os, const FinDate& date) {
-    int weekday = date.getWeekday();
-    if(weekday < 0 || weekday > 6)
-	throw std::range_error("weekday out of range");
-    os << FinDate::weekdayName[weekday] << " "
-       << date.getMonth() << "/" << date.getDay() << "/" << date.getYear();
-    return os;
+    char buf[DateIO::maxDateLength];
+    DateIO::format(date.jdn, buf, DateIO::WeekdayUSFormat);
+    return os << buf;
 }
     
 double operator-(const FinDate& date2, const FinDate& date1) {
@@ -357,39 +320,32 @@ double operator-(const FinDate& date2, const FinDate& date1) {
 FinDate operator+(const FinDate& date, int offsetDays) {
     FinDate temp(date);
     temp.jdn += offsetDays;
-    temp.parsed = false;
     return temp;
 }
 FinDate& FinDate::operator+=(int offsetDays) {
     jdn += offsetDays;
-    parsed = false;
     return *this;
 }
 FinDate& FinDate::operator-=(int offsetDays) {
     jdn -= offsetDays;
-    parsed = false;
     return *this;
 }
 FinDate& FinDate::operator++() { // prefix
     jdn++;
-    parsed = false;
     return *this;
 }
 FinDate FinDate::operator++(int) { // postfix
     FinDate temp(*this);
     jdn++;
-    parsed = false;
     return temp;
 }
 FinDate& FinDate::operator--() { // prefix
     jdn--;
-    parsed = false;
     return *this;
 }
 FinDate FinDate::operator--(int) { // postfix
     FinDate temp(*this);
     jdn--;
-    parsed = false;
     return temp;
 }
 
@@ -429,6 +385,7 @@ std::string FinDate::getWeekdayName() const {
     return FinDate::weekdayName[weekday];
 }
 std::string FinDate::getMonthName() const {
+    int month = getMonth();
     if(month < 1 || month > 12)
 	throw std::range_error(std::string("getMonthName: invalid month")
 			  +to_string(month));
@@ -441,6 +398,9 @@ const int FinDate::Excel1900_Offset = 2415019; // JDN(1/1/1900) - 2
 const int FinDate::Excel1904_Offset = 2416481; // JDN(1/1/1904)
 const int FinDate::IsdaCds_Offset   = 2305814; // JDN(1/1/1601)
 const int FinDate::DAYS2SECS = 60*60*24;
+const int FinDate::dateTableFirstYear = 1900;
+const int FinDate::dateTableLastYear = 2200;
+const int FinDate::dateTableFirstJdn; // initialized in class
     const int FinDate::serialOffsets[] = { 0, // NULL
 				       FinDate::R_Offset,         // R
 				       FinDate::Excel1900_Offset, // PC
@@ -452,9 +412,9 @@ const int FinDate::daysInMonthTable[2][13] = {
 	    {0,31,28,31,30,31,30,31,31,30,31,30,31},
 	    {0,31,29,31,30,31,30,31,31,30,31,30,31}
 };
-const std::string FinDate::weekdayName[] = { "Sun", "Mon", "Tue", "Wed", 
+const char* const FinDate::weekdayName[] = { "Sun", "Mon", "Tue", "Wed", 
 					     "Thu", "Fri", "Sat", "Sun" };
-const std::string FinDate::monthName[] = { "Jan", "Feb", "Mar", "Apr",
+const char* const FinDate::monthName[] = { "Jan", "Feb", "Mar", "Apr",
 					   "May", "Jun", "Jul", "Aug", "Sep",
 					   "Oct", "Nov", "Dec" };
 
@@ -503,9 +463,7 @@ FinDate FinDate::nextWeekday(int dayNum) const {
     int offset = (dayNum - weekday + 7) % 7;
     if(offset == 0)
 	offset += 7;
-    FinDate tmp(jdn+offset, true);
-    tmp.parsed = false;
-    return tmp;
+    return FinDate(jdn+offset, true);
 }
 
 /**
@@ -514,29 +472,25 @@ FinDate FinDate::nextWeekday(int dayNum) const {
  * counted if it happens to be the specified weekday.
  */
 FinDate FinDate::nthWeekday(int n, int dayNum) const {
-    int count = 0;
-    FinDate date(Month(getMonth()), 1, getYear());
-    if(date.getWeekday() != dayNum)
-	date = date.nextWeekday(dayNum);
-    for(count = 1; count < n; count++)
-	date = FinDate(date.serialJulian()+7,true);
-    date.parsed = false;
-    return date;
+    DateMDY mdy = getMDY();
+    return FinDate(nthWeekday(n, dayNum, mdy.month, mdy.year), true);
 }
 
 /**
- * Returns true if the current date falls in a leap year.
+ * Julian day number of the nth occurrence of weekday dayNum in the
+ * specified month and year (n < 1 is treated as 1).
  */
-bool FinDate::isLeapYear() const {
-    int year = getYear();
-    return ((year%4 == 0)||(year%400 == 0)) && !(year%100 == 0);
+int FinDate::nthWeekday(int n, int dayNum, int month, int year) {
+    int first = mdy2jdn(month, 1, year);
+    int offset = (dayNum - (first+1)%7 + 7) % 7;
+    return first + offset + 7*(n > 1 ? n-1 : 0);
 }
 
 /**
- * Corresponding static function.
+ * Returns true if the current date falls in a leap year.
  */
-bool FinDate::isLeapYear(int year) {
-    return ((year%4 == 0)||(year%400 == 0)) && !(year%100 == 0);
+bool FinDate::isLeapYear() const {
+    return isLeapYear(getYear());
 }
 
 /**
@@ -548,73 +502,48 @@ int FinDate::daysInMonth(int month, int year) {
     return daysInMonthTable[isLeapYear(year)?1:0][month];
 }
 
-// The Julian day number (jdn) is the number of days since Monday,
-// Jan 1, 4713BC (year = -4712). Here 1BC is year 0, 2BC is year -1, etc.
-// On the other hand, R measures days since Jan 1, 1970, and these dates are
-// converted to jdn's by adding Jan1970Offset.
-//
-// mdy2jdn and jdn2mdy are inverse functions for dates back to 
-// year = -4799 (4800BC).
-//
-// See the Wikipedia entry on Julian day number for more information 
-// on these algorithms.
-//
-
 /**
- * Transform month/day/year to Julian day number.
+ * Transform from Julian day number to month/day/year. This counts days
+ * from 3/1/0000 so that leap days fall at the end of each (shifted)
+ * year, and it only uses division by constants, which compilers
+ * replace with multiplications. The only branch handles dates before
+ * 3/1/0000.
  */
-void FinDate::mdy2jdn() {
-    int m = month, d = day, y = year;
-    int a = (14 - m)/12;
-    y += 4800 - a;
-    m += 12*a - 3;
-    jdn = (d + (153*m + 2)/5 + 365*y
-	   + y/4 - y/100 + y/400 - 32045);
-}
-
-// Transform from Julian day number to month/day/year.
-void FinDate::jdn2mdy() const {
-    int jul = jdn + 32044;
-    int g = jul/146097;
-    int dg = jul % 146097;
-    int c = (dg/36524 + 1)*3/4;
-    int dc = dg - c*36524;
-    int b = dc/1461;
-    int db = dc % 1461;
-    int a = (db/365 + 1)*3/4;
-    int da = db - a*365;
-    int y = g*400 + c*100 + b*4 + a;
-    int m = (da*5 + 308)/153 - 2;
-    int d = da - (m + 4)*153 /5 + 122;
-    y = y - 4800 + (m + 2)/12;
-    m = (m + 2) % 12 + 1;
-    d = d + 1;
-    month = m;
-    day   = d;
-    year  = y;
+DateMDY FinDate::civilFromJdn(int jdn) {
+    int z = jdn - 1721120; // days since 3/1/0000
+    int era = (z >= 0 ? z : z - 146096) / 146097; // 400 year cycles
+    int doe = z - era * 146097;                   // [0, 146096]
+    int yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365; // [0, 399]
+    int doy = doe - (365*yoe + yoe/4 - yoe/100);  // [0, 365]
+    int mp = (5*doy + 2)/153;                     // [0, 11], 0 = March
+    int d = doy - (153*mp + 2)/5 + 1;
+    int m = mp < 10 ? mp + 3 : mp - 9;
+    int y = yoe + era*400 + (m <= 2);
+    return DateMDY(m,d,y);
 }
 
-/**
- * Transform from Julian day number to month/day/year.
- * (More useful than above.)
- */
-DateMDY FinDate::jdn2mdy(int jdn) {
-    int jul = jdn + 32044;
-    int g = jul/146097;
-    int dg = jul % 146097;
-    int c = (dg/36524 + 1)*3/4;
-    int dc = dg - c*36524;
-    int b = dc/1461;
-    int db = dc % 1461;
-    int a = (db/365 + 1)*3/4;
-    int da = db - a*365;
-    int y = g*400 + c*100 + b*4 + a;
-    int m = (da*5 + 308)/153 - 2;
-    int d = da - (m + 4)*153 /5 + 122;
-    y = y - 4800 + (m + 2)/12;
-    m = (m + 2) % 12 + 1;
-    d = d + 1;
-    return DateMDY(m,d,y);
+uint32_t* FinDate::dateTable = 0;
+unsigned int FinDate::dateTableSize = 0;
+
+void FinDate::useDateTable(bool flag) {
+    if(!flag) {
+	delete [] dateTable;
+	dateTable = 0;
+	dateTableSize = 0;
+	return;
+    }
+    if(dateTableSize > 0)
+	return;
+    int lastJdn = mdy2jdn(12, 31, dateTableLastYear);
+    unsigned int size = lastJdn - dateTableFirstJdn + 1;
+    uint32_t* table = new uint32_t[size];
+    int off = 0;
+    for(int y = dateTableFirstYear; y <= dateTableLastYear; ++y)
+	for(int m = 1; m <= 12; ++m)
+	    for(int d = 1; d <= daysInMonth(m, y); ++d)
+		table[off++] = ((uint32_t)y << 9) | (m << 5) | d;
+    dateTable = table;
+    dateTableSize = size;
 }
 
     double serialNumber(cxxPack::FinDate& d, cxxPack::SerialType type) {
@@ -648,6 +577,64 @@ DateMDY FinDate::jdn2mdy(int jdn) {
 	return val;
     }
 
+    static int checkedOffset(cxxPack::SerialType type) {
+	if(type < 1 || type > cxxPack::Julian)
+	    throw std::range_error("Invalid serial number type");
+	return FinDate::serialOffsets[type];
+    }
+
+    void serialNumberConvert(const double* in, int n, cxxPack::SerialType from,
+			     cxxPack::SerialType to, double* out) {
+	double fromOffset = checkedOffset(from), toOffset = checkedOffset(to);
+	for(int i = 0; i < n; ++i)
+	    out[i] = in[i] + fromOffset - toOffset;
+    }
+
+    void serialNumberConvert(const int* in, int n, cxxPack::SerialType from,
+			     cxxPack::SerialType to, int* out) {
+	int shift = checkedOffset(from) - checkedOffset(to);
+	for(int i = 0; i < n; ++i)
+	    out[i] = in[i] + shift;
+    }
+
+    void serialNumberFromSeconds(const double* secs, int n,
+				 cxxPack::SerialType to, double* out) {
+	double Roffset = FinDate::R_Offset, toOffset = checkedOffset(to);
+	double days2secs = FinDate::DAYS2SECS;
+	for(int i = 0; i < n; ++i)
+	    out[i] = secs[i]/days2secs + Roffset - toOffset;
+    }
+
+    static const char* serialTypeNames[] = { "None", "R", "Excel1900",
+					     "Excel1904", "QuantLib",
+					     "IsdaCds", "Julian" };
+
+    cxxPack::SerialType serialTypeFor(const std::string& name) {
+	for(int t = cxxPack::R; t <= cxxPack::Julian; ++t)
+	    if(name == serialTypeNames[t])
+		return (cxxPack::SerialType)t;
+	throw std::range_error("invalid serial number type: " + name);
+    }
+
+/**
+ * R interface to serialNumberConvert(). from may also be "POSIXct", in
+ * which case x is in seconds (see serialNumberFromSeconds()).
+ */
+RcppExport SEXP serialNumberConvert_(SEXP x, SEXP from, SEXP to) {
+    BEGIN_RCPP
+    Rcpp::NumericVector in(x);
+    Rcpp::NumericVector out(in.size());
+    std::string fromName = Rcpp::as<std::string>(from);
+    cxxPack::SerialType toType = serialTypeFor(Rcpp::as<std::string>(to));
+    if(fromName == "POSIXct")
+	serialNumberFromSeconds(REAL(in), in.size(), toType, REAL(out));
+    else
+	serialNumberConvert(REAL(in), in.size(), serialTypeFor(fromName),
+			    toType, REAL(out));
+    return out;
+    END_RCPP
+}
+
 FinDate::operator SEXP() {
     Rcpp::NumericVector value(1);
     value[0] = getRValue();
@@ -668,3 +655,98 @@ template<> SEXP wrap<cxxPack::FinDate>(const cxxPack::FinDate& x) {
 }
 
 }
+
+/**
+ * R interface used by the unit tests: the n-th weekday (Sun=0, ..., Sat=6)
+ * of each month/year, from the static FinDate::nthWeekday() and from the
+ * member function called on the 15th of the month. Returns a list with
+ * the two (closed, member) as R dates.
+ */
+RcppExport SEXP nthWeekday_(SEXP n, SEXP weekday, SEXP months, SEXP years) {
+    BEGIN_RCPP
+    using cxxPack::FinDate;
+    Rcpp::IntegerVector nth(n), day(weekday), month(months), year(years);
+    int len = nth.size();
+    Rcpp::NumericVector closed(len), member(len);
+    for(int i = 0; i < len; ++i) {
+	closed[i] = FinDate::nthWeekday(nth[i], day[i], month[i], year[i])
+	    - FinDate::R_Offset;
+	member[i] = FinDate((cxxPack::Month)month[i], 15, year[i])
+	    .nthWeekday(nth[i], day[i]).getRValue();
+    }
+    Rcpp::GenericVector result(2);
+    result[0] = closed;
+    result[1] = member;
+    Rcpp::CharacterVector names(2);
+    names[0] = "closed";
+    names[1] = "member";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
+
+namespace {
+
+    SEXP mdyList(const std::vector<cxxPack::DateMDY>& mdy) {
+	int n = (int)mdy.size();
+	Rcpp::IntegerVector month(n), day(n), year(n);
+	for(int i = 0; i < n; ++i) {
+	    month[i] = mdy[i].month;
+	    day[i] = mdy[i].day;
+	    year[i] = mdy[i].year;
+	}
+	Rcpp::GenericVector result(3);
+	result[0] = month;
+	result[1] = day;
+	result[2] = year;
+	Rcpp::CharacterVector names(3);
+	names[0] = "month";
+	names[1] = "day";
+	names[2] = "year";
+	result.attr("names") = names;
+	return result;
+    }
+
+}
+
+/**
+ * R interface used by the unit tests: FinDate::jdn2mdy() of the R dates
+ * with the date table (table) and without it (arithmetic), each a list
+ * of month, day and year. The table is left as it was (see the
+ * usingDateTable results before and after).
+ */
+RcppExport SEXP jdn2mdy_(SEXP dates) {
+    BEGIN_RCPP
+    using cxxPack::FinDate;
+    struct TableReset {
+	bool flag;
+	TableReset() : flag(FinDate::usingDateTable()) {}
+	~TableReset() { FinDate::useDateTable(flag); }
+    } reset;
+    Rcpp::NumericVector d(dates);
+    int n = d.size();
+    std::vector<int> jdns(n);
+    for(int i = 0; i < n; ++i)
+	jdns[i] = (int)d[i] + FinDate::R_Offset;
+    std::vector<cxxPack::DateMDY> table, arithmetic;
+    table.reserve(n);
+    arithmetic.reserve(n);
+    FinDate::useDateTable(true);
+    for(int i = 0; i < n; ++i)
+	table.push_back(FinDate::jdn2mdy(jdns[i]));
+    FinDate::useDateTable(false);
+    for(int i = 0; i < n; ++i)
+	arithmetic.push_back(FinDate::jdn2mdy(jdns[i]));
+
+    Rcpp::GenericVector result(3);
+    result[0] = mdyList(table);
+    result[1] = mdyList(arithmetic);
+    result[2] = Rcpp::wrap(reset.flag);
+    Rcpp::CharacterVector names(3);
+    names[0] = "table";
+    names[1] = "arithmetic";
+    names[2] = "tableWasUsed";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
@@ -0,0 +1,167 @@
+// FinDatetime.cpp: nanosecond resolution datetimes
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cmath>
+#include <limits>
+
+#include <FinDatetime.hpp>
+#include <DateIO.hpp>
+
+namespace cxxPack {
+
+const int64_t FinDatetime::NANOS_PER_SEC = 1000000000;
+const int64_t FinDatetime::NANOS_PER_DAY = (int64_t)86400*1000000000;
+const int64_t FinDatetime::NA_NANOS = std::numeric_limits<int64_t>::min();
+
+FinDatetime::FinDatetime(SEXP datetimeSEXP) {
+    nanos = fromSeconds(Rcpp::as<double>(datetimeSEXP)).nanos;
+}
+
+FinDatetime::FinDatetime(const RcppDatetime& datetime) {
+    nanos = secondsToNanos(datetime.getFractionalTimestamp());
+}
+
+FinDatetime::FinDatetime(const FinDate& date, int hour, int minute,
+			 int second, int nanosecond) {
+    if(hour < 0 || hour > 23 || minute < 0 || minute > 59
+       || second < 0 || second > 59
+       || nanosecond < 0 || nanosecond >= NANOS_PER_SEC)
+	throw std::range_error("FinDatetime: invalid time of day");
+    nanos = (int64_t)(date.serialJulian() - FinDate::R_Offset)*NANOS_PER_DAY
+	+ (int64_t)(3600*hour + 60*minute + second)*NANOS_PER_SEC
+	+ nanosecond;
+}
+
+/**
+ * The whole seconds and the fraction are converted separately, so the
+ * result is as accurate as secs itself (secs*1e9 would lose the last
+ * few hundred nanoseconds for current dates).
+ */
+int64_t FinDatetime::secondsToNanos(double secs) {
+    if(!(std::fabs(secs) < 9.2e9)) // also catches NaN
+	throw std::range_error("FinDatetime: time out of range");
+    double whole = std::floor(secs);
+    return (int64_t)whole*NANOS_PER_SEC
+	+ (int64_t)std::floor((secs - whole)*1.0e9 + 0.5);
+}
+
+FinDatetime::operator SEXP() const {
+    Rcpp::NumericVector value(1);
+    value[0] = getSeconds();
+    Rcpp::CharacterVector classname(2);
+    classname[0] = Rcpp::datetimeClass[0];
+    classname[1] = Rcpp::datetimeClass[1];
+    Rcpp::RObject(value).attr("class") = classname;
+    return value;
+}
+
+void FinDatetime::fromSeconds(const double* secs, int n, FinDatetime* out) {
+    for(int i = 0; i < n; ++i)
+	out[i].nanos = ISNAN(secs[i]) ? NA_NANOS : secondsToNanos(secs[i]);
+}
+
+void FinDatetime::toSeconds(const FinDatetime* datetimes, int n, double* out) {
+    for(int i = 0; i < n; ++i)
+	out[i] = datetimes[i].getSeconds();
+}
+
+void FinDatetime::toJulianDays(const FinDatetime* datetimes, int n, int* out) {
+    for(int i = 0; i < n; ++i) {
+	if(datetimes[i].isNA())
+	    throw std::range_error("FinDatetime::toJulianDays: NA has no date");
+	out[i] = datetimes[i].julianDay();
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const FinDatetime& datetime) {
+    if(datetime.isNA())
+	return os << "NA";
+    char buf[DateIO::maxDateLength];
+    DateIO::formatNanos(datetime.nanos, buf);
+    return os << buf;
+}
+
+std::string to_string(const FinDatetime& datetime) {
+    if(datetime.isNA())
+	return "NA";
+    char buf[DateIO::maxDateLength];
+    int len = DateIO::formatNanos(datetime.getNanos(), buf);
+    return std::string(buf, len);
+}
+
+} // end cxxPack namespace
+
+namespace Rcpp {
+
+template<> SEXP wrap<cxxPack::FinDatetime>(const cxxPack::FinDatetime& x) {
+    return (SEXP)x;
+}
+
+}
+
+/**
+ * R interface used by the unit tests. Converts each of the POSIXct times
+ * secs to a FinDatetime, one at a time through FinDatetime(SEXP) and
+ * operator SEXP() and in a batch, and gives each as text and its
+ * difference from the first in seconds (with operator- and with
+ * diffNanos()). Returns these as list(single, batch, text, diff,
+ * diffNanos), with datetimeText, the text of FinDatetime(dates[i]) plus
+ * nanos[i] nanoseconds (dates are R Dates).
+ */
+RcppExport SEXP finDatetime_(SEXP secs, SEXP dates, SEXP nanos) {
+    BEGIN_RCPP
+    using cxxPack::FinDatetime;
+    Rcpp::NumericVector in(secs), days(dates), extra(nanos);
+    int n = in.size(), m = days.size();
+    if(extra.size() != m)
+	throw std::range_error("finDatetime_: length mismatch");
+    std::vector<FinDatetime> datetimes(n);
+    if(n > 0)
+	FinDatetime::fromSeconds(REAL(in), n, &datetimes[0]);
+
+    Rcpp::NumericVector single(n), batch(n), diff(n), diffNanos(n);
+    Rcpp::CharacterVector text(n), datetimeText(m);
+    if(n > 0)
+	FinDatetime::toSeconds(&datetimes[0], n, REAL(batch));
+    for(int i = 0; i < n; ++i) {
+	FinDatetime datetime(Rcpp::wrap(in[i]));
+	single[i] = Rcpp::as<double>((SEXP)datetime);
+	text[i] = cxxPack::to_string(datetimes[i]);
+	if(datetimes[i].isNA() || datetimes[0].isNA()) {
+	    diff[i] = diffNanos[i] = NA_REAL;
+	    continue;
+	}
+	diff[i] = datetimes[i] - datetimes[0];
+	diffNanos[i] = FinDatetime::diffNanos(datetimes[i], datetimes[0])*1.0e-9;
+    }
+    for(int i = 0; i < m; ++i) {
+	FinDatetime datetime(cxxPack::FinDate((int)days[i]));
+	datetime.addNanos((int64_t)extra[i]);
+	datetimeText[i] = cxxPack::to_string(datetime);
+    }
+
+    Rcpp::GenericVector result(6);
+    Rcpp::CharacterVector names(6);
+    result[0] = single;       names[0] = "single";
+    result[1] = batch;        names[1] = "batch";
+    result[2] = text;         names[2] = "text";
+    result[3] = diff;         names[3] = "diff";
+    result[4] = diffNanos;    names[4] = "diffNanos";
+    result[5] = datetimeText; names[5] = "datetimeText";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
@@ -16,102 +16,362 @@
 
 #include <string>
 #include <vector>
+#include <cstring>
 #include <stdexcept>
 
+#include <Rcpp.h>
+
 #include "FinEnum.hpp"
 
 namespace cxxPack {
 
-std::string FinEnum::BondFeatureStr[] = { "None", "Maturity Anchor", 
-    "Odd First Coupon", "Odd Last Coupon", "Odd First and Last", 
-    "Moosmuller Conv.", "Braess-Fangmeyer Conv."
+#define FINENUM_NAME(s) { s, sizeof(s)-1 }
+#define FINENUM_COUNT(table) ((int)(sizeof(table)/sizeof(FinEnum::Name)))
+
+// The _for() lookups hash the length and three characters of a string
+// into FINENUM_SLOTS slots. The xxxSlot tables give the index of the name
+// in each slot (-1 if none), and must be updated when names are added or
+// changed: the names of a table must hash to distinct slots, and be at
+// least two characters long.
+#define FINENUM_SLOTS 32
+
+static inline unsigned hash(const char* s, std::size_t len) {
+    const unsigned char* u = (const unsigned char*)s;
+    return (unsigned)(len + u[len-1] + 2*u[len/2] + 4*u[len/2-1])
+	& (FINENUM_SLOTS-1);
+}
+
+const FinEnum::Name FinEnum::BondFeatureStr[] = {
+    FINENUM_NAME("None"),
+    FINENUM_NAME("Maturity Anchor"),
+    FINENUM_NAME("Odd First Coupon"),
+    FINENUM_NAME("Odd Last Coupon"),
+    FINENUM_NAME("Odd First and Last"),
+    FINENUM_NAME("Moosmuller Conv."),
+    FINENUM_NAME("Braess-Fangmeyer Conv.")
 };
-int FinEnum::numBondFeature = sizeof(BondFeatureStr)/sizeof(std::string);
-    
-std::string FinEnum::DayCountConventionStr[] = {
-    "ACT/ACT", "ACT/360", "ACT/365", 
-    "ACT/252","30/360 ISDA", "30/360 Euro",
-    "30/360 PSA1", "30/360 PSA2", 
-    "ACT/365 No Leap",
-    "ACT/360 No Leap"
+const int FinEnum::numBondFeature = FINENUM_COUNT(BondFeatureStr);
+static const signed char BondFeatureSlot[FINENUM_SLOTS] = {
+    -1, 0, -1, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 3, 2, -1, -1, -1, 4, -1, 5, -1, 6, -1, -1, -1, -1, -1
 };
-int FinEnum::numDayCountConvention = sizeof(DayCountConventionStr)/sizeof(std::string);
 
-std::string FinEnum::MonthEndAdjustmentStr[] = { "None", "Adjust if EOM" };
-int FinEnum::numMonthEndAdjustment = sizeof(MonthEndAdjustmentStr)/sizeof(std::string);
+const FinEnum::Name FinEnum::DayCountConventionStr[] = {
+    FINENUM_NAME("ACT/ACT"),
+    FINENUM_NAME("ACT/360"),
+    FINENUM_NAME("ACT/365"),
+    FINENUM_NAME("ACT/252"),
+    FINENUM_NAME("30/360 ISDA"),
+    FINENUM_NAME("30/360 Euro"),
+    FINENUM_NAME("30/360 PSA1"),
+    FINENUM_NAME("30/360 PSA2"),
+    FINENUM_NAME("ACT/360 No Leap"),
+    FINENUM_NAME("ACT/365 No Leap"),
+    FINENUM_NAME("BUS/252")
+};
+const int FinEnum::numDayCountConvention = FINENUM_COUNT(DayCountConventionStr);
+static const signed char DayCountConventionSlot[FINENUM_SLOTS] = {
+    -1, -1, -1, 10, 4, 1, -1, 3, -1, 0, 2, -1, -1, -1, -1, -1,
+    -1, -1, 5, 9, 6, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, 8
+};
 
-std::string FinEnum::AccrualConventionStr[] = { "Standard",
-						"Year Fraction",
-						"Year Fraction Plus 1" };
-int FinEnum::numAccrualConvention = sizeof(AccrualConventionStr)/sizeof(std::string);
+const FinEnum::Name FinEnum::MonthEndAdjustmentStr[] = {
+    FINENUM_NAME("None"),
+    FINENUM_NAME("Adjust if EOM")
+};
+const int FinEnum::numMonthEndAdjustment = FINENUM_COUNT(MonthEndAdjustmentStr);
+static const signed char MonthEndAdjustmentSlot[FINENUM_SLOTS] = {
+    -1, 0, -1, -1, -1, -1, -1, -1, -1, -1, 1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
 
-std::string FinEnum::CashFlowTypeStr[] = { "FX", "SETTLE", "COUPON", 
-					   "PRINCIPAL", "OTHER" };
-int FinEnum::numCashFlowType = sizeof(CashFlowTypeStr)/sizeof(std::string);
+const FinEnum::Name FinEnum::AccrualConventionStr[] = {
+    FINENUM_NAME("Standard"),
+    FINENUM_NAME("Year Fraction"),
+    FINENUM_NAME("Year Fraction Plus 1")
+};
+const int FinEnum::numAccrualConvention = FINENUM_COUNT(AccrualConventionStr);
+static const signed char AccrualConventionSlot[FINENUM_SLOTS] = {
+    -1, -1, -1, -1, -1, -1, -1, 2, -1, -1, -1, -1, 0, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, 1, -1, -1, -1, -1, -1, -1, -1, -1
+};
 
-std::string FinEnum::CalcModeStr[] = { "Fixed Price", "Fixed Yield" };
-int FinEnum::numCalcMode = sizeof(CalcModeStr)/sizeof(std::string);
+const FinEnum::Name FinEnum::CashFlowTypeStr[] = {
+    FINENUM_NAME("FX"),
+    FINENUM_NAME("SETTLE"),
+    FINENUM_NAME("COUPON"),
+    FINENUM_NAME("PRINCIPAL"),
+    FINENUM_NAME("OTHER")
+};
+const int FinEnum::numCashFlowType = FINENUM_COUNT(CashFlowTypeStr);
+static const signed char CashFlowTypeSlot[FINENUM_SLOTS] = {
+    -1, -1, 0, 1, -1, -1, -1, -1, 2, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, 3, -1, -1, -1, 4, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+const FinEnum::Name FinEnum::CalcModeStr[] = {
+    FINENUM_NAME("Fixed Price"),
+    FINENUM_NAME("Fixed Yield")
+};
+const int FinEnum::numCalcMode = FINENUM_COUNT(CalcModeStr);
+static const signed char CalcModeSlot[FINENUM_SLOTS] = {
+    0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1
+};
 
+const FinEnum::Name FinEnum::BusDayConventionStr[] = {
+    FINENUM_NAME("Unadjusted"),
+    FINENUM_NAME("Following"),
+    FINENUM_NAME("Modified Following"),
+    FINENUM_NAME("Preceding"),
+    FINENUM_NAME("Modified Preceding"),
+    FINENUM_NAME("End of Month")
+};
+const int FinEnum::numBusDayConvention = FINENUM_COUNT(BusDayConventionStr);
+static const signed char BusDayConventionSlot[FINENUM_SLOTS] = {
+    0, -1, -1, -1, -1, 2, 3, -1, -1, -1, -1, -1, 5, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, 4, -1, -1, -1, -1, 1, -1
+};
+
+const FinEnum::Name FinEnum::InterpolationStr[] = {
+    FINENUM_NAME("Log-Linear"),
+    FINENUM_NAME("Monotone Convex"),
+    FINENUM_NAME("Cubic Spline")
+};
+const int FinEnum::numInterpolation = FINENUM_COUNT(InterpolationStr);
+static const signed char InterpolationSlot[FINENUM_SLOTS] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, 2, -1, -1, -1, -1, -1, -1, 0, -1
+};
+
+// Index of s[0,len) in names, or -1. slot maps hash() to the only
+// name that can match, so a lookup is one hash and one comparison.
+static int lookup(const FinEnum::Name* names, const signed char* slot,
+		  const char* s, std::size_t len) {
+    if(len < 2)
+	return -1;
+    int i = slot[hash(s, len)];
+    if(i < 0 || names[i].length != len
+       || std::memcmp(names[i].str, s, len) != 0)
+	return -1;
+    return i;
+}
 
 std::string FinEnum::BondFeature_str(BondFeature t) {
-    return BondFeatureStr[t];
+    return BondFeature_name(t);
 }
-FinEnum::BondFeature FinEnum::BondFeature_for(std::string s) {
-    for(int i = 0; i < FinEnum::numBondFeature; ++i)
-	if(s == FinEnum::BondFeatureStr[i])
-	    return (FinEnum::BondFeature)i;
-    throw std::range_error("Invalid string in BondFeature_for");
+const char* FinEnum::BondFeature_name(BondFeature t) {
+    if(t < 0 || t >= numBondFeature)
+	throw std::range_error("Invalid value in BondFeature_name");
+    return BondFeatureStr[t].str;
+}
+FinEnum::BondFeature FinEnum::BondFeature_for(const char* s, std::size_t len) {
+    int i = lookup(BondFeatureStr, BondFeatureSlot, s, len);
+    if(i < 0)
+	throw std::range_error("Invalid string in BondFeature_for");
+    return (FinEnum::BondFeature)i;
 }
 
 std::string FinEnum::DayCountConvention_str(DayCountConvention t) {
-    return DayCountConventionStr[t];
+    return DayCountConvention_name(t);
+}
+const char* FinEnum::DayCountConvention_name(DayCountConvention t) {
+    if(t < 0 || t >= numDayCountConvention)
+	throw std::range_error("Invalid value in DayCountConvention_name");
+    return DayCountConventionStr[t].str;
 }
-FinEnum::DayCountConvention FinEnum::DayCountConvention_for(std::string s) {
-    for(int i = 0; i < FinEnum::numDayCountConvention; ++i)
-	if(s == FinEnum::DayCountConventionStr[i])
-	    return (FinEnum::DayCountConvention)i;
-    throw std::range_error("Invalid string in DayCountConvention_for");
+FinEnum::DayCountConvention FinEnum::DayCountConvention_for(const char* s, std::size_t len) {
+    int i = lookup(DayCountConventionStr, DayCountConventionSlot, s, len);
+    if(i < 0)
+	throw std::range_error("Invalid string in DayCountConvention_for");
+    return (FinEnum::DayCountConvention)i;
 }
 
 std::string FinEnum::MonthEndAdjustment_str(MonthEndAdjustment t) {
-    return MonthEndAdjustmentStr[t];
+    return MonthEndAdjustment_name(t);
+}
+const char* FinEnum::MonthEndAdjustment_name(MonthEndAdjustment t) {
+    if(t < 0 || t >= numMonthEndAdjustment)
+	throw std::range_error("Invalid value in MonthEndAdjustment_name");
+    return MonthEndAdjustmentStr[t].str;
 }
-FinEnum::MonthEndAdjustment FinEnum::MonthEndAdjustment_for(std::string s) {
-    for(int i = 0; i < FinEnum::numMonthEndAdjustment; ++i)
-	if(s == FinEnum::MonthEndAdjustmentStr[i])
-	    return (FinEnum::MonthEndAdjustment)i;
-    throw std::range_error("Invalid string in MonthEndAdjustment_for");
+FinEnum::MonthEndAdjustment FinEnum::MonthEndAdjustment_for(const char* s, std::size_t len) {
+    int i = lookup(MonthEndAdjustmentStr, MonthEndAdjustmentSlot, s, len);
+    if(i < 0)
+	throw std::range_error("Invalid string in MonthEndAdjustment_for");
+    return (FinEnum::MonthEndAdjustment)i;
 }
 
 std::string FinEnum::AccrualConvention_str(AccrualConvention t) {
-    return AccrualConventionStr[t];
+    return AccrualConvention_name(t);
 }
-FinEnum::AccrualConvention FinEnum::AccrualConvention_for(std::string s) {
-    for(int i = 0; i < FinEnum::numAccrualConvention; ++i)
-	if(s == FinEnum::AccrualConventionStr[i])
-	    return (FinEnum::AccrualConvention)i;
-    throw std::range_error("Invalid string in AccrualConvention_for");
+const char* FinEnum::AccrualConvention_name(AccrualConvention t) {
+    if(t < 0 || t >= numAccrualConvention)
+	throw std::range_error("Invalid value in AccrualConvention_name");
+    return AccrualConventionStr[t].str;
+}
+FinEnum::AccrualConvention FinEnum::AccrualConvention_for(const char* s, std::size_t len) {
+    int i = lookup(AccrualConventionStr, AccrualConventionSlot, s, len);
+    if(i < 0)
+	throw std::range_error("Invalid string in AccrualConvention_for");
+    return (FinEnum::AccrualConvention)i;
 }
 
 std::string FinEnum::CashFlowType_str(CashFlowType t) {
-    return CashFlowTypeStr[t];
+    return CashFlowType_name(t);
+}
+const char* FinEnum::CashFlowType_name(CashFlowType t) {
+    if(t < 0 || t >= numCashFlowType)
+	throw std::range_error("Invalid value in CashFlowType_name");
+    return CashFlowTypeStr[t].str;
 }
-FinEnum::CashFlowType FinEnum::CashFlowType_for(std::string s) {
-    for(int i = 0; i < FinEnum::numCashFlowType; ++i)
-	if(s == FinEnum::CashFlowTypeStr[i])
-	    return (FinEnum::CashFlowType)i;
-    throw std::range_error("Invalid string in CashFlowType_for");
+FinEnum::CashFlowType FinEnum::CashFlowType_for(const char* s, std::size_t len) {
+    int i = lookup(CashFlowTypeStr, CashFlowTypeSlot, s, len);
+    if(i < 0)
+	throw std::range_error("Invalid string in CashFlowType_for");
+    return (FinEnum::CashFlowType)i;
 }
 
 std::string FinEnum::CalcMode_str(CalcMode t) {
-    return CalcModeStr[t];
+    return CalcMode_name(t);
+}
+const char* FinEnum::CalcMode_name(CalcMode t) {
+    if(t < 0 || t >= numCalcMode)
+	throw std::range_error("Invalid value in CalcMode_name");
+    return CalcModeStr[t].str;
 }
-FinEnum::CalcMode FinEnum::CalcMode_for(std::string s) {
-    for(int i = 0; i < FinEnum::numCalcMode; ++i)
-	if(s == FinEnum::CalcModeStr[i])
-	    return (FinEnum::CalcMode)i;
-    throw std::range_error("Invalid string in CalcMode_for");
+FinEnum::CalcMode FinEnum::CalcMode_for(const char* s, std::size_t len) {
+    int i = lookup(CalcModeStr, CalcModeSlot, s, len);
+    if(i < 0)
+	throw std::range_error("Invalid string in CalcMode_for");
+    return (FinEnum::CalcMode)i;
+}
+
+std::string FinEnum::BusDayConvention_str(BusDayConvention t) {
+    return BusDayConvention_name(t);
+}
+const char* FinEnum::BusDayConvention_name(BusDayConvention t) {
+    if(t < 0 || t >= numBusDayConvention)
+	throw std::range_error("Invalid value in BusDayConvention_name");
+    return BusDayConventionStr[t].str;
+}
+FinEnum::BusDayConvention FinEnum::BusDayConvention_for(const char* s, std::size_t len) {
+    int i = lookup(BusDayConventionStr, BusDayConventionSlot, s, len);
+    if(i < 0)
+	throw std::range_error("Invalid string in BusDayConvention_for");
+    return (FinEnum::BusDayConvention)i;
+}
+
+std::string FinEnum::Interpolation_str(Interpolation t) {
+    return Interpolation_name(t);
+}
+const char* FinEnum::Interpolation_name(Interpolation t) {
+    if(t < 0 || t >= numInterpolation)
+	throw std::range_error("Invalid value in Interpolation_name");
+    return InterpolationStr[t].str;
+}
+FinEnum::Interpolation FinEnum::Interpolation_for(const char* s, std::size_t len) {
+    int i = lookup(InterpolationStr, InterpolationSlot, s, len);
+    if(i < 0)
+	throw std::range_error("Invalid string in Interpolation_for");
+    return (FinEnum::Interpolation)i;
 }
 
 } // end cxxPack namespace
 
+namespace {
+
+    using cxxPack::FinEnum;
+
+    // The _name(), _str() and both _for() of one enum for the unit
+    // tests. The pointer and length _for() is given a copy of each string
+    // followed by another character, so it must not read past len.
+    template<typename E>
+    SEXP enumLookups(int count, const char* (*name)(E),
+		     std::string (*str)(E),
+		     E (*forChars)(const char*, std::size_t),
+		     E (*forString)(const std::string&),
+		     Rcpp::CharacterVector strings) {
+	Rcpp::CharacterVector names(count), strs(count);
+	for(int i = 0; i < count; ++i) {
+	    names[i] = std::string(name((E)i));
+	    strs[i] = str((E)i);
+	}
+	bool badValue = true;
+	try {
+	    name((E)count);
+	    badValue = false;
+	}
+	catch(std::range_error&) {}
+	try {
+	    name((E)-1);
+	    badValue = false;
+	}
+	catch(std::range_error&) {}
+
+	int n = strings.size();
+	Rcpp::IntegerVector index(n), indexString(n);
+	for(int j = 0; j < n; ++j) {
+	    std::string s = Rcpp::as<std::string>(strings[j]);
+	    std::vector<char> buf(s.begin(), s.end());
+	    buf.push_back('e');
+	    try {
+		index[j] = forChars(&buf[0], s.size());
+	    }
+	    catch(std::range_error&) {
+		index[j] = NA_INTEGER;
+	    }
+	    try {
+		indexString[j] = forString(s);
+	    }
+	    catch(std::range_error&) {
+		indexString[j] = NA_INTEGER;
+	    }
+	}
+
+	Rcpp::GenericVector result(5);
+	result[0] = names;
+	result[1] = strs;
+	result[2] = index;
+	result[3] = indexString;
+	result[4] = Rcpp::wrap(badValue);
+	Rcpp::CharacterVector resultNames(5);
+	resultNames[0] = "names";
+	resultNames[1] = "strs";
+	resultNames[2] = "index";
+	resultNames[3] = "indexString";
+	resultNames[4] = "badValue";
+	result.attr("names") = resultNames;
+	return result;
+    }
+
+}
+
+#define FINENUM_LOOKUPS(T) \
+    if(name == #T) \
+	return enumLookups<FinEnum::T>(FinEnum::num##T, FinEnum::T##_name, \
+				       FinEnum::T##_str, FinEnum::T##_for, \
+				       FinEnum::T##_for, values)
+
+/**
+ * R interface used by the unit tests: for the enum named type (for
+ * example "DayCountConvention"), the names of all of its values (names,
+ * strs), the value of each of strings from the two _for() lookups (index,
+ * indexString, NA where they throw), and whether _name() throws for
+ * values out of range (badValue).
+ */
+RcppExport SEXP finEnum_(SEXP type, SEXP strings) {
+    BEGIN_RCPP
+    std::string name = Rcpp::as<std::string>(type);
+    Rcpp::CharacterVector values(strings);
+    FINENUM_LOOKUPS(BondFeature);
+    FINENUM_LOOKUPS(DayCountConvention);
+    FINENUM_LOOKUPS(MonthEndAdjustment);
+    FINENUM_LOOKUPS(AccrualConvention);
+    FINENUM_LOOKUPS(CashFlowType);
+    FINENUM_LOOKUPS(CalcMode);
+    FINENUM_LOOKUPS(BusDayConvention);
+    FINENUM_LOOKUPS(Interpolation);
+    throw std::range_error("finEnum_: unknown enum " + name);
+    END_RCPP
+}
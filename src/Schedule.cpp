@@ -0,0 +1,203 @@
+// Schedule.cpp: coupon schedule generation
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <Schedule.hpp>
+#include <DayCount.hpp>
+
+namespace cxxPack {
+
+Schedule::Schedule(FinDate effective_, FinDate maturity_, int frequency,
+		   FinEnum::BondFeature feature,
+		   FinEnum::MonthEndAdjustment eomAdj,
+		   FinEnum::BusDayConvention roll_,
+		   FinEnum::DayCountConvention dc_, const Calendar& cal_)
+    : effective(effective_.serialJulian()), maturity(maturity_.serialJulian()),
+      adjustEOM(eomAdj == FinEnum::AdjustIfEOM), roll(roll_), dc(dc_),
+      cal(&cal_) {
+    if(effective >= maturity)
+	throw std::range_error("Schedule: effective date must precede maturity");
+    if(frequency < 1 || frequency > 12 || 12 % frequency != 0)
+	throw std::range_error("Schedule: frequency must be 1, 2, 3, 4, 6 or 12");
+    months = 12/frequency;
+    switch(feature) {
+    case FinEnum::NoFeature:
+    case FinEnum::MaturityAnchor:
+    case FinEnum::OddFirst:
+	forward = false;
+	break;
+    case FinEnum::OddLast:
+	forward = true;
+	break;
+    case FinEnum::OddBoth:
+	throw std::range_error("Schedule: OddBoth needs an anchor date");
+    default:
+	throw std::range_error("Schedule: "
+			       + FinEnum::BondFeature_str(feature)
+			       + " is not a schedule feature");
+    }
+    countRegular();
+}
+
+int Schedule::regularDate(int k) const {
+    if(forward)
+	return FinDate(effective, true).addMonths(k*months, adjustEOM)
+	    .serialJulian();
+    return FinDate(maturity, true).addMonths(-k*months, adjustEOM)
+	.serialJulian();
+}
+
+/**
+ * Counts the regular dates strictly between effective and maturity. The
+ * month difference gives the count to within one, so at most a couple of
+ * dates are computed here.
+ */
+void Schedule::countRegular() {
+    DateMDY mdy1 = FinDate::jdn2mdy(effective), mdy2 = FinDate::jdn2mdy(maturity);
+    int totalMonths = (mdy2.year - mdy1.year)*12 + mdy2.month - mdy1.month;
+    int k = totalMonths/months;
+    int end = forward ? maturity : effective;
+    if(forward) {
+	while(k > 0 && regularDate(k) >= maturity)
+	    k--;
+	while(regularDate(k+1) < maturity)
+	    k++;
+    }
+    else {
+	while(k > 0 && regularDate(k) <= effective)
+	    k--;
+	while(regularDate(k+1) > effective)
+	    k++;
+    }
+    // Merge a stub that vanishes when the dates are rolled.
+    if(k > 0 && cal->adjust(regularDate(k), roll) == cal->adjust(end, roll))
+	k--;
+    numRegular = k;
+}
+
+int Schedule::generate(int* unadjusted, int* adjusted, double* accrual) const {
+    int n = numDates();
+    unadjusted[0] = effective;
+    for(int i = 1; i <= numRegular; ++i)
+	unadjusted[i] = regularDate(forward ? i : numRegular+1-i);
+    unadjusted[n-1] = maturity;
+    for(int i = 0; i < n; ++i)
+	adjusted[i] = cal->adjust(unadjusted[i], roll);
+    DayCount::yearFrac(adjusted, adjusted+1, n-1, dc, *cal, accrual);
+    return n;
+}
+
+void Schedule::referencePeriods(int* start, int* end) const {
+    for(int i = 0; i < numPeriods(); ++i) {
+	if(forward) {
+	    start[i] = regularDate(i);
+	    end[i] = regularDate(i+1);
+	}
+	else {
+	    start[i] = regularDate(numRegular+1-i);
+	    end[i] = regularDate(numRegular-i);
+	}
+    }
+}
+
+void Schedule::couponFractions(double* frac) const {
+    int np = numPeriods();
+    std::vector<int> unadjusted(numDates()), adjusted(numDates());
+    std::vector<int> refStart(np), refEnd(np);
+    std::vector<double> accrual(np);
+    generate(&unadjusted[0], &adjusted[0], &accrual[0]);
+    referencePeriods(&refStart[0], &refEnd[0]);
+    for(int p = 0; p < np; ++p) {
+	frac[p] = 1.0;
+	if(refStart[p] == unadjusted[p] && refEnd[p] == unadjusted[p+1])
+	    continue;
+	FinDate start(refStart[p], true), end(refEnd[p], true);
+	int refDays = FinDate::diffDays(start, end, dc, *cal);
+	if(refDays > 0)
+	    frac[p] = (double)FinDate::diffDays(FinDate(unadjusted[p], true),
+						FinDate(unadjusted[p+1], true),
+						dc, *cal) / refDays;
+    }
+}
+
+void Schedule::generate(std::vector<int>& unadjusted,
+			std::vector<int>& adjusted,
+			std::vector<double>& accrual) const {
+    unadjusted.resize(numDates());
+    adjusted.resize(numDates());
+    accrual.resize(numPeriods());
+    generate(&unadjusted[0], &adjusted[0], &accrual[0]);
+}
+
+} // end cxxPack namespace
+
+/**
+ * R interface used by the unit tests: the Schedule from effective to
+ * maturity (R dates) with the weekends only calendar. Returns a list with
+ * the unadjusted and adjusted dates and the accrual fraction of each
+ * period (from generate()), the reference periods (refStart, refEnd) and
+ * the coupon fractions (frac). Dates are R dates.
+ */
+RcppExport SEXP schedule_(SEXP effective, SEXP maturity, SEXP frequency,
+			  SEXP feature, SEXP eomAdj, SEXP roll, SEXP dc) {
+    BEGIN_RCPP
+    using cxxPack::FinDate;
+    using cxxPack::FinEnum;
+    cxxPack::Schedule schedule(
+	FinDate((int)Rcpp::as<double>(effective)),
+	FinDate((int)Rcpp::as<double>(maturity)),
+	Rcpp::as<int>(frequency),
+	FinEnum::BondFeature_for(Rcpp::as<std::string>(feature)),
+	FinEnum::MonthEndAdjustment_for(Rcpp::as<std::string>(eomAdj)),
+	FinEnum::BusDayConvention_for(Rcpp::as<std::string>(roll)),
+	FinEnum::DayCountConvention_for(Rcpp::as<std::string>(dc)));
+    int n = schedule.numDates(), np = schedule.numPeriods();
+    std::vector<int> unadjusted, adjusted, refStart(np), refEnd(np);
+    std::vector<double> accrual, frac(np);
+    schedule.generate(unadjusted, adjusted, accrual);
+    schedule.referencePeriods(&refStart[0], &refEnd[0]);
+    schedule.couponFractions(&frac[0]);
+
+    Rcpp::NumericVector rUnadjusted(n), rAdjusted(n), rAccrual(np);
+    Rcpp::NumericVector rRefStart(np), rRefEnd(np), rFrac(np);
+    for(int i = 0; i < n; ++i) {
+	rUnadjusted[i] = unadjusted[i] - FinDate::R_Offset;
+	rAdjusted[i] = adjusted[i] - FinDate::R_Offset;
+    }
+    for(int p = 0; p < np; ++p) {
+	rAccrual[p] = accrual[p];
+	rRefStart[p] = refStart[p] - FinDate::R_Offset;
+	rRefEnd[p] = refEnd[p] - FinDate::R_Offset;
+	rFrac[p] = frac[p];
+    }
+
+    Rcpp::GenericVector result(6);
+    result[0] = rUnadjusted;
+    result[1] = rAdjusted;
+    result[2] = rAccrual;
+    result[3] = rRefStart;
+    result[4] = rRefEnd;
+    result[5] = rFrac;
+    Rcpp::CharacterVector names(6);
+    names[0] = "unadjusted";
+    names[1] = "adjusted";
+    names[2] = "accrual";
+    names[3] = "refStart";
+    names[4] = "refEnd";
+    names[5] = "frac";
+    result.attr("names") = names;
+    return result;
+    END_RCPP
+}
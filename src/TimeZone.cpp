@@ -0,0 +1,601 @@
+// TimeZone.cpp: conversion between UTC and local time
+//
+// Copyright (C) 2010 Dominick Samperi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License Version 3 as
+// published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <cmath>
+#include <cstdlib>
+
+#include <TimeZone.hpp>
+
+namespace cxxPack {
+
+static const int64_t SECS_PER_DAY = 86400;
+
+static inline int64_t floorDiv(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b < 0) ? q - 1 : q;
+}
+
+// UTC seconds at midnight starting the julian day jdn.
+static inline int64_t jdnToSecs(int jdn) {
+    return (int64_t)(jdn - FinDate::R_Offset)*SECS_PER_DAY;
+}
+
+static inline int yearOf(int64_t secs) {
+    return FinDate::jdn2mdy((int)floorDiv(secs, SECS_PER_DAY)
+			    + FinDate::R_Offset).year;
+}
+
+TimeZone::TimeZone(std::string name_, int firstYear_, int lastYear_)
+    : name(name_), firstYear(firstYear_), lastYear(lastYear_),
+      initialType(0) {
+    typeOffset.push_back(0);
+    typeDst.push_back(false);
+    typeAbbrev.push_back("UTC");
+    buildIndex();
+}
+
+TimeZone::TimeZone(std::string name_, std::string fileName,
+		   int firstYear_, int lastYear_)
+    : name(name_), firstYear(firstYear_), lastYear(lastYear_),
+      initialType(0) {
+    readTZif(fileName);
+    buildIndex();
+}
+
+// Big-endian integers from the TZif file.
+static int32_t get32(const unsigned char* p) {
+    return (int32_t)(((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+		     | ((uint32_t)p[2] << 8) | (uint32_t)p[3]);
+}
+
+static int64_t get64(const unsigned char* p) {
+    return (int64_t)(((uint64_t)(uint32_t)get32(p) << 32)
+		     | (uint64_t)(uint32_t)get32(p+4));
+}
+
+/**
+ * Reads the file format described in RFC 8536 (tzfile(5)). For version
+ * 2 and later files the 64-bit data block that follows the 32-bit one is
+ * used, together with the POSIX TZ string footer.
+ */
+void TimeZone::readTZif(const std::string& fileName) {
+    std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+    if(!in)
+	throw std::range_error("TimeZone: cannot open " + fileName);
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    std::string data = contents.str();
+    const unsigned char* buf = (const unsigned char*)data.data();
+    std::size_t size = data.size();
+
+    std::size_t pos = 0;
+    int timeSize = 4;
+    for(;;) {
+	if(size < pos + 44 || data.compare(pos, 4, "TZif") != 0)
+	    throw std::range_error("TimeZone: not a TZif file: " + fileName);
+	char version = data[pos+4];
+	const unsigned char* h = buf + pos + 20;
+	int isutcnt = get32(h), isstdcnt = get32(h+4), leapcnt = get32(h+8),
+	    timecnt = get32(h+12), typecnt = get32(h+16),
+	    charcnt = get32(h+20);
+	if(isutcnt < 0 || isstdcnt < 0 || leapcnt < 0 || timecnt < 0
+	   || typecnt <= 0 || charcnt < 0)
+	    throw std::range_error("TimeZone: corrupt TZif header: "
+				   + fileName);
+	std::size_t blockSize = (std::size_t)timecnt*timeSize + timecnt
+	    + 6*typecnt + charcnt + (std::size_t)leapcnt*(timeSize+4)
+	    + isstdcnt + isutcnt;
+	pos += 44;
+	if(size < pos + blockSize)
+	    throw std::range_error("TimeZone: truncated TZif file: "
+				   + fileName);
+	if(timeSize == 4 && version >= '2') { // skip to the 64-bit block
+	    pos += blockSize;
+	    timeSize = 8;
+	    continue;
+	}
+
+	const unsigned char* p = buf + pos;
+	transitions.resize(timecnt);
+	transitionType.resize(timecnt);
+	for(int i = 0; i < timecnt; ++i, p += timeSize)
+	    transitions[i] = timeSize == 8 ? get64(p) : get32(p);
+	for(int i = 0; i < timecnt; ++i, ++p) {
+	    if(*p >= typecnt)
+		throw std::range_error("TimeZone: corrupt TZif file: "
+				       + fileName);
+	    transitionType[i] = *p;
+	}
+	const unsigned char* abbrevs = p + 6*typecnt;
+	for(int i = 0; i < typecnt; ++i, p += 6) {
+	    typeOffset.push_back(get32(p));
+	    typeDst.push_back(p[4] != 0);
+	    int idx = p[5] < charcnt ? p[5] : 0;
+	    const char* s = (const char*)abbrevs + idx;
+	    typeAbbrev.push_back(std::string(s, std::find(s,
+			   (const char*)abbrevs + charcnt, '\0')));
+	}
+	for(int i = 1; i < timecnt; ++i)
+	    if(transitions[i] <= transitions[i-1])
+		throw std::range_error("TimeZone: unsorted transitions in "
+				       + fileName);
+	pos += blockSize;
+	break;
+    }
+
+    // Footer: "\n" POSIX TZ string "\n".
+    if(timeSize == 8 && pos < size && data[pos] == '\n') {
+	std::string::size_type end = data.find('\n', pos+1);
+	if(end != std::string::npos)
+	    expandRule(data.substr(pos+1, end-pos-1));
+    }
+}
+
+// POSIX TZ string parsing (see tzset(3)). Each function advances s and
+// returns false on a syntax error.
+
+static bool readName(const char*& s, std::string& out) {
+    const char* start = s;
+    if(*s == '<') {
+	start = ++s;
+	while(*s != '\0' && *s != '>')
+	    s++;
+	if(*s != '>')
+	    return false;
+	out.assign(start, s++);
+	return true;
+    }
+    while((*s >= 'A' && *s <= 'Z') || (*s >= 'a' && *s <= 'z'))
+	s++;
+    out.assign(start, s);
+    return s - start >= 3;
+}
+
+static bool readNumber(const char*& s, int& out) {
+    if(*s < '0' || *s > '9')
+	return false;
+    out = 0;
+    while(*s >= '0' && *s <= '9' && out < 10000)
+	out = 10*out + (*s++ - '0');
+    return true;
+}
+
+// [+-]hh[:mm[:ss]] in seconds.
+static bool readTime(const char*& s, int& out) {
+    int sign = 1;
+    if(*s == '+' || *s == '-')
+	sign = (*s++ == '-') ? -1 : 1;
+    int hours, minutes = 0, seconds = 0;
+    if(!readNumber(s, hours))
+	return false;
+    if(*s == ':' && !readNumber(++s, minutes))
+	return false;
+    if(*s == ':' && !readNumber(++s, seconds))
+	return false;
+    out = sign*(3600*hours + 60*minutes + seconds);
+    return true;
+}
+
+// A DST start or end: Jn, n or Mm.w.d, optionally followed by /time.
+struct TransitionRule {
+    char kind; // 'J', 'D' (zero-based day) or 'M'
+    int day, week, month, time;
+
+    bool read(const char*& s) {
+	week = month = 0;
+	time = 7200; // default 02:00:00
+	if(*s == 'J') {
+	    kind = 'J';
+	    if(!readNumber(++s, day) || day < 1 || day > 365)
+		return false;
+	}
+	else if(*s == 'M') {
+	    kind = 'M';
+	    if(!readNumber(++s, month) || month < 1 || month > 12
+	       || *s != '.' || !readNumber(++s, week) || week < 1 || week > 5
+	       || *s != '.' || !readNumber(++s, day) || day > 6)
+		return false;
+	}
+	else {
+	    kind = 'D';
+	    if(!readNumber(s, day) || day > 365)
+		return false;
+	}
+	if(*s == '/' && !readTime(++s, time))
+	    return false;
+	return true;
+    }
+
+    // Local time (seconds) of the transition in the specified year.
+    int64_t localSecs(int year) const {
+	int jan1 = FinDate::mdy2jdn(1, 1, year), jdn;
+	switch(kind) {
+	case 'J': // Feb 29 is never counted
+	    jdn = jan1 + day - 1;
+	    if(FinDate::isLeapYear(year) && day >= 60)
+		jdn++;
+	    break;
+	case 'M': {
+	    jdn = FinDate::nthWeekday(week, day, month, year);
+	    int last = FinDate::mdy2jdn(month,
+					FinDate::daysInMonth(month, year), year);
+	    while(jdn > last) // week 5 means the last one
+		jdn -= 7;
+	    break;
+	}
+	default:
+	    jdn = jan1 + day;
+	}
+	return jdnToSecs(jdn) + time;
+    }
+};
+
+int TimeZone::findType(int offset, bool isDst, const std::string& abbrev) {
+    for(int i = 0; i < (int)typeOffset.size(); ++i)
+	if(typeOffset[i] == offset && typeDst[i] == isDst
+	   && typeAbbrev[i] == abbrev)
+	    return i;
+    typeOffset.push_back(offset);
+    typeDst.push_back(isDst);
+    typeAbbrev.push_back(abbrev);
+    return typeOffset.size() - 1;
+}
+
+/**
+ * Appends the transitions given by the POSIX TZ rule (for example,
+ * EST5EDT,M3.2.0,M11.1.0) that follow the last transition in the
+ * file, through the end of lastYear.
+ */
+void TimeZone::expandRule(const std::string& rule) {
+    if(rule.empty())
+	return;
+    const char* s = rule.c_str();
+    std::string stdName, dstName;
+    int stdOffset, dstOffset;
+    if(!readName(s, stdName) || !readTime(s, stdOffset))
+	throw std::range_error("TimeZone: invalid TZ rule: " + rule);
+    stdOffset = -stdOffset; // POSIX offsets are positive west of Greenwich
+    int stdType = findType(stdOffset, false, stdName);
+    if(*s == '\0') { // no DST
+	if(transitions.empty())
+	    initialType = stdType;
+	return;
+    }
+    if(!readName(s, dstName))
+	throw std::range_error("TimeZone: invalid TZ rule: " + rule);
+    dstOffset = stdOffset + 3600;
+    if(*s != ',' && *s != '\0') {
+	if(!readTime(s, dstOffset))
+	    throw std::range_error("TimeZone: invalid TZ rule: " + rule);
+	dstOffset = -dstOffset;
+    }
+    TransitionRule start, end;
+    if(*s != ',' || !start.read(++s) || *s != ',' || !end.read(++s)
+       || *s != '\0')
+	throw std::range_error("TimeZone: unsupported TZ rule: " + rule);
+    int dstType = findType(dstOffset, true, dstName);
+
+    int year = transitions.empty() ? firstYear : yearOf(transitions.back());
+    for(; year <= lastYear; ++year) {
+	int64_t dstStart = start.localSecs(year) - stdOffset;
+	int64_t dstEnd = end.localSecs(year) - dstOffset;
+	int64_t t[2] = { dstStart, dstEnd };
+	int type[2] = { dstType, stdType };
+	if(dstEnd < dstStart) { // southern hemisphere
+	    std::swap(t[0], t[1]);
+	    std::swap(type[0], type[1]);
+	}
+	for(int i = 0; i < 2; ++i)
+	    if(transitions.empty() || t[i] > transitions.back()) {
+		transitions.push_back(t[i]);
+		transitionType.push_back(type[i]);
+	    }
+    }
+}
+
+/**
+ * Indexes the interval that contains the start of each year, with one
+ * extra entry for the end of lastYear.
+ */
+void TimeZone::buildIndex() {
+    if(firstYear > lastYear)
+	throw std::range_error("TimeZone: firstYear > lastYear");
+    int numYears = lastYear - firstYear + 1;
+    yearStart.resize(numYears + 1);
+    yearInterval.resize(numYears + 1);
+    for(int i = 0; i <= numYears; ++i) {
+	yearStart[i] = jdnToSecs(FinDate::mdy2jdn(1, 1, firstYear + i));
+	yearInterval[i] = std::upper_bound(transitions.begin(),
+					   transitions.end(), yearStart[i])
+	    - transitions.begin();
+    }
+}
+
+double TimeZone::intervalStart(int k) const {
+    return k == 0 ? -HUGE_VAL : (double)transitions[k-1];
+}
+
+double TimeZone::intervalEnd(int k) const {
+    return k == (int)transitions.size() ? HUGE_VAL : (double)transitions[k];
+}
+
+int TimeZone::interval(int64_t t) const {
+    int last = yearStart.size() - 1;
+    if(t < yearStart[0] || t >= yearStart[last])
+	return std::upper_bound(transitions.begin(), transitions.end(), t)
+	    - transitions.begin();
+    // Estimate the year (146097 days per 400 years), then correct it.
+    int y = (int)floorDiv(floorDiv(t, SECS_PER_DAY)*400, 146097)
+	+ 1970 - firstYear;
+    if(y < 0)
+	y = 0;
+    else if(y >= last)
+	y = last - 1;
+    while(t < yearStart[y])
+	y--;
+    while(t >= yearStart[y+1])
+	y++;
+    int k = yearInterval[y], n = transitions.size();
+    while(k < n && transitions[k] <= t)
+	k++;
+    return k;
+}
+
+/**
+ * Interval k applies to local time L when L - offset(k) falls in
+ * interval k. Offsets are less than a day and transitions are more
+ * than a day apart, so only the neighbors of the interval that contains
+ * L (read as UTC) need to be checked.
+ */
+int TimeZone::localOffset(int64_t localSecs) const {
+    int k = interval(localSecs), n = transitions.size();
+    for(int j = std::max(k-1, 0); j <= std::min(k+1, n); ++j) {
+	double utc = (double)(localSecs - intervalOffset(j));
+	if(utc >= intervalStart(j) && utc < intervalEnd(j))
+	    return intervalOffset(j);
+    }
+    // Skipped local time: use the offset before the gap.
+    for(int j = std::max(k-1, 0); j < std::min(k+1, n); ++j)
+	if((double)(localSecs - intervalOffset(j)) >= intervalEnd(j)
+	   && (double)(localSecs - intervalOffset(j+1)) < intervalStart(j+1))
+	    return intervalOffset(j);
+    return intervalOffset(k);
+}
+
+// Whole seconds and shifts for the two timestamp representations.
+static inline double wholeSeconds(double secs) {
+    return std::floor(secs);
+}
+
+static inline double wholeSeconds(const FinDatetime& dt) {
+    return (double)floorDiv(dt.getNanos(), FinDatetime::NANOS_PER_SEC);
+}
+
+static inline double shift(double secs, int offset) {
+    return secs + offset;
+}
+
+static inline FinDatetime shift(const FinDatetime& dt, int offset) {
+    return FinDatetime::fromNanos(dt.getNanos()
+				  + offset*FinDatetime::NANOS_PER_SEC);
+}
+
+static inline int64_t toInt64(double secs) {
+    return (int64_t)std::max(-9.0e18, std::min(secs, 9.0e18));
+}
+
+/**
+ * The interval [lo, hi) of the previous timestamp is kept, so the table
+ * is only consulted when the offset may change.
+ */
+template<typename T>
+void TimeZone::batchToLocal(const T* in, int n, T* out) const {
+    double lo = 0, hi = 0; // empty
+    int offset = 0;
+    for(int i = 0; i < n; ++i) {
+	double t = wholeSeconds(in[i]);
+	if(t != t) { // NA
+	    out[i] = in[i];
+	    continue;
+	}
+	if(!(t >= lo && t < hi)) {
+	    int k = interval(toInt64(t));
+	    lo = intervalStart(k);
+	    hi = intervalEnd(k);
+	    offset = intervalOffset(k);
+	}
+	out[i] = shift(in[i], offset);
+    }
+}
+
+/**
+ * The cached range is the part of interval k (in local time) that does
+ * not overlap the neighboring intervals, where offset(k) is the only
+ * choice. A skipped local time uses the offset from before the gap,
+ * which is not that of its interval, and is not cached.
+ */
+template<typename T>
+void TimeZone::batchToUTC(const T* in, int n, T* out) const {
+    double lo = 0, hi = 0; // empty
+    int offset = 0, numTrans = transitions.size();
+    for(int i = 0; i < n; ++i) {
+	double t = wholeSeconds(in[i]);
+	if(t != t) { // NA
+	    out[i] = in[i];
+	    continue;
+	}
+	if(!(t >= lo && t < hi)) {
+	    int64_t local = toInt64(t);
+	    offset = localOffset(local);
+	    int k = interval(local - offset);
+	    if(offset == intervalOffset(k)) {
+		int prev = k > 0 ? intervalOffset(k-1) : offset;
+		int next = k < numTrans ? intervalOffset(k+1) : offset;
+		lo = intervalStart(k) + std::max(offset, prev);
+		hi = intervalEnd(k) + std::min(offset, next);
+	    }
+	    else
+		lo = hi = 0;
+	}
+	out[i] = shift(in[i], -offset);
+    }
+}
+
+double TimeZone::toLocal(double utcSecs) const {
+    double out;
+    batchToLocal(&utcSecs, 1, &out);
+    return out;
+}
+
+double TimeZone::toUTC(double localSecs) const {
+    double out;
+    batchToUTC(&localSecs, 1, &out);
+    return out;
+}
+
+FinDatetime TimeZone::toLocal(const FinDatetime& utc) const {
+    FinDatetime out;
+    batchToLocal(&utc, 1, &out);
+    return out;
+}
+
+FinDatetime TimeZone::toUTC(const FinDatetime& local) const {
+    FinDatetime out;
+    batchToUTC(&local, 1, &out);
+    return out;
+}
+
+void TimeZone::toLocal(const double* utcSecs, int n, double* out) const {
+    batchToLocal(utcSecs, n, out);
+}
+
+void TimeZone::toUTC(const double* localSecs, int n, double* out) const {
+    batchToUTC(localSecs, n, out);
+}
+
+void TimeZone::toLocal(const FinDatetime* utc, int n, FinDatetime* out) const {
+    batchToLocal(utc, n, out);
+}
+
+void TimeZone::toUTC(const FinDatetime* local, int n, FinDatetime* out) const {
+    batchToUTC(local, n, out);
+}
+
+// The registry is created on first use (no static constructors).
+typedef std::map<std::string, TimeZone> TimeZoneMap;
+static TimeZoneMap& registry() {
+    static TimeZoneMap zones;
+    return zones;
+}
+
+const TimeZone& TimeZone::add(const TimeZone& tz) {
+    TimeZoneMap& reg = registry();
+    TimeZoneMap::iterator it = reg.find(tz.getName());
+    if(it != reg.end()) {
+	it->second = tz;
+	return it->second;
+    }
+    return reg.insert(std::make_pair(tz.getName(), tz)).first->second;
+}
+
+const TimeZone& TimeZone::load(std::string name, std::string fileName,
+			       int firstYear, int lastYear) {
+    return add(TimeZone(name, fileName, firstYear, lastYear));
+}
+
+/**
+ * Zoneinfo file for name, or "" if there is none. R on Windows ships
+ * its own copy of the database under R_HOME/share/zoneinfo.
+ */
+static std::string zoneinfoFile(const std::string& name) {
+    if(name.empty() || name[0] == '/' || name.find("..") != std::string::npos)
+	return "";
+    std::vector<std::string> dirs;
+    const char* env = std::getenv("TZDIR");
+    if(env != 0 && *env != '\0')
+	dirs.push_back(env);
+    env = std::getenv("R_SHARE_DIR");
+    if(env != 0 && *env != '\0')
+	dirs.push_back(std::string(env) + "/zoneinfo");
+    dirs.push_back("/usr/share/zoneinfo");
+    dirs.push_back("/usr/lib/zoneinfo");
+    dirs.push_back("/usr/share/lib/zoneinfo");
+    for(int i = 0; i < (int)dirs.size(); ++i) {
+	std::string file = dirs[i] + "/" + name;
+	std::ifstream in(file.c_str(), std::ios::in | std::ios::binary);
+	if(in)
+	    return file;
+    }
+    return "";
+}
+
+bool TimeZone::has(std::string name) {
+    return name == "UTC" || registry().count(name) > 0
+	|| !zoneinfoFile(name).empty();
+}
+
+const TimeZone& TimeZone::get(std::string name) {
+    TimeZoneMap& reg = registry();
+    TimeZoneMap::iterator it = reg.find(name);
+    if(it != reg.end())
+	return it->second;
+    if(name == "UTC")
+	return add(TimeZone(name));
+    std::string file = zoneinfoFile(name);
+    if(file.empty())
+	throw std::range_error("TimeZone::get: unknown time zone: " + name);
+    return load(name, file);
+}
+
+} // end cxxPack namespace
+
+/**
+ * R interface used by the unit tests: converts POSIXct seconds in the
+ * time zone named zone, to UTC when toUTC is TRUE and from UTC
+ * otherwise, with one batch call.
+ */
+RcppExport SEXP tzConvert_(SEXP zone, SEXP secs, SEXP toUTC) {
+    BEGIN_RCPP
+    const cxxPack::TimeZone& tz
+	= cxxPack::TimeZone::get(Rcpp::as<std::string>(zone));
+    Rcpp::NumericVector in(secs);
+    Rcpp::NumericVector out(in.size());
+    if(Rcpp::as<bool>(toUTC))
+	tz.toUTC(REAL(in), in.size(), REAL(out));
+    else
+	tz.toLocal(REAL(in), in.size(), REAL(out));
+    return out;
+    END_RCPP
+}
+
+/**
+ * Time zone abbreviations at the UTC times secs.
+ */
+RcppExport SEXP tzAbbreviation_(SEXP zone, SEXP secs) {
+    BEGIN_RCPP
+    const cxxPack::TimeZone& tz
+	= cxxPack::TimeZone::get(Rcpp::as<std::string>(zone));
+    Rcpp::NumericVector in(secs);
+    Rcpp::CharacterVector out(in.size());
+    for(int i = 0; i < in.size(); ++i)
+	out[i] = tz.abbreviation((int64_t)std::floor(in[i]));
+    return out;
+    END_RCPP
+}
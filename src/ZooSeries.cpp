@@ -16,10 +16,12 @@
 
 #include <Rcpp.h>
 #include <ZooSeries.hpp>
+#include <DateIO.hpp>
 
 namespace cxxPack {
 
 bool ZooSeries::useRcppDate_ = false;
+bool ZooSeries::useFinDatetime_ = false;
 
 void ZooSeries::print() { // For debugging purposes.
 
@@ -64,10 +66,12 @@ void ZooSeries::print() { // For debugging purposes.
 	break;
     }
     case ZooSeries::IND_FINDATE: {
+	char buf[DateIO::maxDateLength];
 	if(isMatrix_) {
 	    for(int i=0; i < nrows; ++i) {
-		std::string temp = to_string(indexFinDate(i));
-		Rprintf("%s ", temp.c_str());
+		DateIO::format(indexFinDate(i).serialJulian(), buf,
+			       DateIO::WeekdayUSFormat);
+		Rprintf("%s ", buf);
 		for(int j=0; j < ncols; ++j) {
 		    Rprintf("%lf ", matrixDouble(i,j));
 		}
@@ -76,8 +80,9 @@ void ZooSeries::print() { // For debugging purposes.
 	}
 	else {
 	    for(int i=0; i < nrows; ++i) {
-		std::string temp = to_string(indexFinDate(i));
-		Rprintf("%s ", temp.c_str());
+		DateIO::format(indexFinDate(i).serialJulian(), buf,
+			       DateIO::WeekdayUSFormat);
+		Rprintf("%s ", buf);
 	    }
 	    Rprintf("\n");
 	    for(int j=0; j < nrows; ++j)
@@ -131,6 +136,28 @@ void ZooSeries::print() { // For debugging purposes.
 	}
 	break;
     }
+    case ZooSeries::IND_FINDATETIME: {
+	if(isMatrix_) {
+	    for(int i=0; i < nrows; ++i) {
+		std::string temp = to_string(indexFinDatetime(i));
+		Rprintf("%s ", temp.c_str());
+		for(int j=0; j < ncols; ++j)
+		    Rprintf("%lf ", matrixDouble(i,j));
+		Rprintf("\n");
+	    }
+	}
+	else {
+	    for(int i=0; i < nrows; ++i) {
+		std::string temp = to_string(indexFinDatetime(i));
+		Rprintf("%s ", temp.c_str());
+	    }
+	    Rprintf("\n");
+	    for(int j=0; j < nrows; ++j)
+		Rprintf("%lf ", vectorDouble(j));
+	    Rprintf("\n");
+	}
+	break;
+    }
     }
 }
 
@@ -172,7 +199,7 @@ ZooSeries::ZooSeries(SEXP zoots) {
 	if(std::string(ind[0]) == "Date")
 	    indexType_ = useRcppDate_ ? IND_RCPPDATE : IND_FINDATE;
 	else if(std::string(ind[0]).substr(0,5) == "POSIX")
-	    indexType_ = IND_RCPPDATETIME;
+	    indexType_ = useFinDatetime_ ? IND_FINDATETIME : IND_RCPPDATETIME;
     }
 
     // Get low-level index type.
@@ -183,7 +210,8 @@ ZooSeries::ZooSeries(SEXP zoots) {
     else {
 	if(indexType_ != IND_FINDATE
 	   && indexType_ != IND_RCPPDATE
-	   && indexType_ != IND_RCPPDATETIME)
+	   && indexType_ != IND_RCPPDATETIME
+	   && indexType_ != IND_FINDATETIME)
 	    indexType_ = IND_DOUBLE;
     }
 
@@ -224,6 +252,13 @@ ZooSeries::ZooSeries(SEXP zoots) {
 	    indRcppDatetime[i] = RcppDatetime(nv(i));
         }
 	break;
+    case IND_FINDATETIME: {
+	Rcpp::NumericVector nv(indexAttr);
+	indFinDatetime.resize(indexLength);
+	for(int i = 0; i < indexLength; ++i)
+	    indFinDatetime[i] = FinDatetime::fromSeconds(nv(i));
+        }
+	break;
     default:
 	throw std::range_error("Invalid index type in ZooSeries constr");
     }
@@ -325,6 +360,12 @@ ZooSeries::ZooSeries(std::vector<double>& data, std::vector<RcppDatetime>& index
     indexType_ = IND_RCPPDATETIME; 
     nrows = data.size(); ncols = 1;
 }
+ZooSeries::ZooSeries(std::vector<double>& data, std::vector<FinDatetime>& index, 
+		 double freq)
+    : indFinDatetime(index), dataVec(data), frequency_(freq), isMatrix_(false) { 
+    indexType_ = IND_FINDATETIME; 
+    nrows = data.size(); ncols = 1;
+}
 ZooSeries::ZooSeries(std::vector<std::vector<double> >& data, std::vector<int>& index, double freq)
     : indInt(index), dataMat(data), frequency_(freq), isMatrix_(true) { 
     indexType_ = IND_INTEGER; 
@@ -350,6 +391,11 @@ ZooSeries::ZooSeries(std::vector<std::vector<double> >& data, std::vector<RcppDa
     indexType_ = IND_RCPPDATETIME; 
     nrows = index.size(); ncols = data[0].size();
 }
+ZooSeries::ZooSeries(std::vector<std::vector<double> >& data, std::vector<FinDatetime>& index,double freq)
+    : indFinDatetime(index), dataMat(data), frequency_(freq), isMatrix_(true) { 
+    indexType_ = IND_FINDATETIME; 
+    nrows = index.size(); ncols = data[0].size();
+}
 
 ZooSeries::operator SEXP() {
 
@@ -460,6 +506,22 @@ ZooSeries::operator SEXP() {
 		isRegular = true;
 	}
 	break;
+ case cxxPack::ZooSeries::IND_FINDATETIME:
+	if(isMatrix()) {
+	    cxxPack::ZooSeriesValidator<FinDatetime,std::vector<double> > 
+		v(indFinDatetime, dataMat);
+	    perm = v.getSortPermutation();
+	    if(freq > 0 && v.frequencyIsValid(freq))
+		isRegular = true;
+	}
+	else { // vector
+	    cxxPack::ZooSeriesValidator<FinDatetime,double> 
+		v(indFinDatetime, dataVec);
+	    perm = v.getSortPermutation();
+	    if(freq > 0 && v.frequencyIsValid(freq))
+		isRegular = true;
+	}
+	break;
     }
 
     // Add the class info at the top level (zoo, zooreg)
@@ -535,6 +597,13 @@ ZooSeries::operator SEXP() {
 	zoo.attr("index") = nv;
         } 
 	break;
+    case cxxPack::ZooSeries::IND_FINDATETIME: {
+	Rcpp::NumericVector nv(nrows);
+	for(int i = 0; i < nrows; ++i)
+	    nv(i) = indexFinDatetime(perm[i]).getSeconds();
+	zoo.attr("index") = nv;
+        } 
+	break;
     default:
 	throw std::range_error("Invalid index type in ZooSeries wrap");
     }
@@ -548,7 +617,8 @@ ZooSeries::operator SEXP() {
 	|| indexType_ == cxxPack::ZooSeries::IND_RCPPDATE) {
 	    indexObj.attr("class") = Rcpp::CharacterVector("Date");
 	}
-	else if(indexType_ == cxxPack::ZooSeries::IND_RCPPDATETIME) {
+	else if(indexType_ == cxxPack::ZooSeries::IND_RCPPDATETIME
+		|| indexType_ == cxxPack::ZooSeries::IND_FINDATETIME) {
 	    Rcpp::CharacterVector cv(2);
 	    cv[0] = Rcpp::datetimeClass[0];
 	    cv[1] = Rcpp::datetimeClass[1];
@@ -571,3 +641,23 @@ template<> SEXP wrap<cxxPack::ZooSeries>(const cxxPack::ZooSeries& x) {
 }
 
 }
+
+/**
+ * R interface used by the unit tests: converts zoo to a ZooSeries, with
+ * the useRcppDate and useFinDatetime flags set as requested (and reset to
+ * false afterwards), and back to R.
+ */
+RcppExport SEXP zooRoundTrip_(SEXP zoo, SEXP rcppDate, SEXP finDatetime) {
+    BEGIN_RCPP
+    struct FlagReset {
+	~FlagReset() {
+	    cxxPack::ZooSeries::useRcppDate(false);
+	    cxxPack::ZooSeries::useFinDatetime(false);
+	}
+    } reset;
+    cxxPack::ZooSeries::useRcppDate(Rcpp::as<bool>(rcppDate));
+    cxxPack::ZooSeries::useFinDatetime(Rcpp::as<bool>(finDatetime));
+    cxxPack::ZooSeries series(zoo);
+    return (SEXP)series;
+    END_RCPP
+}
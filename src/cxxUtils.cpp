@@ -15,9 +15,17 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <cxxUtils.hpp>
+#include <DateIO.hpp>
 
 namespace cxxPack {
 
+std::string to_string(const FinDate& date) {
+    char buf[DateIO::maxDateLength];
+    int len = DateIO::format(date.serialJulian(), buf,
+			     DateIO::WeekdayUSFormat);
+    return std::string(buf, len);
+}
+
 /**
  * Gets the dim attribute vector of a SEXP. This may be the only
  * place were we use R's low-level macros, and these functions
@@ -52,9 +60,9 @@ void setRDims(SEXP s, std::vector<int>& dims) {
 namespace Rcpp {
 
 #ifdef SWAP_POSIXt // For R versions >= 2.12
-    std::string datetimeClass[] = { "POSIXct", "POSIXt" };
+    const char* const datetimeClass[] = { "POSIXct", "POSIXt" };
 #else
-    std::string datetimeClass[] = { "POSIXt", "POSIXct" };
+    const char* const datetimeClass[] = { "POSIXt", "POSIXct" };
 #endif
 
     // Wrap() implementations for some objects in the Rcpp package.
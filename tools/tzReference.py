@@ -0,0 +1,83 @@
+# Generates inst/unitTests/tzReference.csv, the reference conversions
+# used by runit.timezone.R, with Python's zoneinfo module (Python 3.9 or
+# later). From the package directory:
+#
+#   python3 tools/tzReference.py > inst/unitTests/tzReference.csv
+#
+# Each row is zone,direction,input,expected[,abbreviation], in seconds
+# since the epoch. direction "local" converts UTC to local time (and
+# gives the abbreviation), "utc" converts local time to UTC, with fold=0:
+# a repeated local time maps to the earlier instant and a skipped one is
+# moved forward by the gap. The times include the seconds around
+# transitions.
+#
+# The results must not depend on the version of the tz database, so the
+# times are kept to 1990-2012, and zones whose rules for those years have
+# been revised (America/Santiago, America/Sao_Paulo, Europe/Moscow) are
+# left out. The abbreviations of the Australian zones (changed in 2014,
+# EST to AEST) and numeric ones (such as +0545, used since 2017) are
+# written as empty strings, and not checked.
+
+import random
+from datetime import datetime, timedelta, timezone
+from zoneinfo import ZoneInfo
+
+utcZones = ["America/New_York", "America/Chicago", "America/Denver",
+            "America/Los_Angeles", "Europe/London", "Europe/Paris",
+            "Asia/Tokyo", "Asia/Kolkata", "Asia/Shanghai", "Asia/Kathmandu",
+            "Australia/Sydney", "Australia/Lord_Howe", "Pacific/Auckland",
+            "Africa/Cairo"]
+localZones = ["America/New_York", "America/Chicago", "Europe/London",
+              "Europe/Paris", "Australia/Sydney", "Australia/Lord_Howe", "Pacific/Auckland"]
+
+start = int(datetime(1990, 1, 1, tzinfo=timezone.utc).timestamp())
+end = int(datetime(2013, 1, 1, tzinfo=timezone.utc).timestamp())
+epoch = datetime(1970, 1, 1, tzinfo=timezone.utc)
+
+def offset(zi, t):
+    local = (epoch + timedelta(seconds=t)).astimezone(zi)
+    return int(local.utcoffset().total_seconds())
+
+def transitions(zi):
+    out = []
+    t, prev = start, offset(zi, start)
+    while t < end:
+        u = t + 6*3600
+        cur = offset(zi, u)
+        if cur != prev:
+            lo, hi = t, u # offset(lo) = prev, offset(hi) = cur
+            while hi - lo > 1:
+                mid = (lo + hi)//2
+                if offset(zi, mid) == prev:
+                    lo = mid
+                else:
+                    hi = mid
+            out.append((hi, prev, cur))
+            prev = cur
+        t = u
+    return out
+
+random.seed(20100722)
+print("zone,direction,input,expected,abbreviation")
+for name in utcZones:
+    zi = ZoneInfo(name)
+    trans = transitions(zi)
+    times = set(random.randrange(start, end) for i in range(30))
+    for (t, a, b) in random.sample(trans, min(6, len(trans))):
+        times.update([t - 1, t, t + 1])
+    for t in sorted(times):
+        abbrev = (epoch + timedelta(seconds=t)).astimezone(zi).tzname()
+        if abbrev[0] in "+-" or name.startswith("Australia/"):
+            abbrev = ""
+        print("%s,local,%d,%d,%s" % (name, t, t + offset(zi, t), abbrev))
+for name in localZones:
+    zi = ZoneInfo(name)
+    trans = transitions(zi)
+    times = set(random.randrange(start, end) for i in range(30))
+    for (t, a, b) in random.sample(trans, min(6, len(trans))):
+        for d in (-3600, -1, 0, 1, 1800, 3599, 3600, 7200):
+            times.add(t + a + d)
+    for t in sorted(times):
+        naive = datetime(1970, 1, 1) + timedelta(seconds=t)
+        utc = int(naive.replace(tzinfo=zi, fold=0).timestamp())
+        print("%s,utc,%d,%d," % (name, t, utc))